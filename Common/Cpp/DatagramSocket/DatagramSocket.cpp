@@ -165,6 +165,40 @@ bool DatagramSocket::sendTo(const GenericAddr & addr,const void *buf,unsigned in
     return ((unsigned int)ret == buflen);
 }
 
+int DatagramSocket::pathMtu(const GenericAddr & addr)
+{
+#if defined(IP_MTU_DISCOVER) && defined(IP_MTU)
+    // Use a separate connected socket: the OS only reports the path MTU of a connected socket,
+    // and we don't want to restrict the main socket to a single destination
+    SOCKET s = socket(AF_INET,SOCK_DGRAM,0);
+    if (s == INVALID_SOCKET) {
+        return 0;
+    }
+
+    // Set DF bit so the OS tracks path MTU updates (ICMP fragmentation needed) for this destination
+    int discover = IP_PMTUDISC_DO;
+    setsockopt(s,IPPROTO_IP,IP_MTU_DISCOVER,&discover,sizeof(discover));
+
+    SOCKADDR_IN to;
+    memset(&to,0,sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(addr.ip);
+    to.sin_port = htons(addr.port);
+    int mtu = 0;
+    if (connect(s,(sockaddr*)&to,sizeof(to)) == 0) {
+        socklen_t len = sizeof(mtu);
+        if (getsockopt(s,IPPROTO_IP,IP_MTU,&mtu,&len) != 0) {
+            mtu = 0;
+        }
+    }
+    close(s);
+    return mtu;
+#else
+    (void)addr;
+    return 0;
+#endif
+}
+
 bool DatagramSocket::recvFrom(GenericAddr & addr,void * buf,unsigned int & buflen)
 {
     SOCKADDR_IN from;
@@ -410,6 +444,41 @@ bool DatagramSocket::sendTo(const GenericAddr & addr, const void *buf, unsigned
     return true;
 }
 
+int DatagramSocket::pathMtu(const GenericAddr & addr)
+{
+#if defined(IP_MTU_DISCOVER) && defined(IP_MTU)
+    // Use a separate connected socket: the OS only reports the path MTU of a connected socket,
+    // and we don't want to restrict the main socket to a single destination
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == INVALID_SOCKET) {
+        return 0;
+    }
+
+    // Set DF bit so the OS tracks path MTU updates (ICMP fragmentation needed) for this destination
+    DWORD discover = IP_PMTUDISC_DO;
+    setsockopt(s, IPPROTO_IP, IP_MTU_DISCOVER, (char*)&discover, sizeof(discover));
+
+    SOCKADDR_IN to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(addr.ip);
+    to.sin_port = htons(addr.port);
+    DWORD mtu = 0;
+    if (connect(s, (SOCKADDR*)&to, sizeof(to)) == 0) {
+        int len = sizeof(mtu);
+        if (getsockopt(s, IPPROTO_IP, IP_MTU, (char*)&mtu, &len) == SOCKET_ERROR) {
+            mtu = 0;
+        }
+    }
+    closesocket(s);
+    return static_cast<int>(mtu);
+#else
+    // IP_MTU requires Windows 10 1703 SDK
+    (void)addr;
+    return 0;
+#endif
+}
+
 bool DatagramSocket::recvFrom(GenericAddr& addr, void * buf, unsigned int & buflen)
 {
     SOCKADDR_IN source;
@@ -56,6 +56,10 @@ public:
     bool sendTo(const GenericAddr & addr,const void *buf,unsigned int buflen);
     bool recvFrom(GenericAddr & addr,void * buf,unsigned int & buflen);
 
+    // Path MTU to a unicast address as known by the OS (IP packet size, headers included),
+    // or 0 if it can't be discovered on this platform
+    static int pathMtu(const GenericAddr & addr);
+
     bool isInitialized();
 
 private:
@@ -93,6 +97,10 @@ public:
     bool sendTo(const GenericAddr & addr, const void *buf, unsigned int buflen);
     bool recvFrom(GenericAddr & addr, void * buf, unsigned int & buflen);
 
+    // Path MTU to a unicast address as known by the OS (IP packet size, headers included),
+    // or 0 if it can't be discovered on this platform
+    static int pathMtu(const GenericAddr & addr);
+
     bool isInitialized();
 
 private:
@@ -0,0 +1,132 @@
+#pragma once
+
+/*
+ *  Sender announcements, for senders using the compact header (protocol version 3)
+ *
+ *  The compact header doesn't carry the sender name: senders send a GeomUdpAnnouncement packet ("PONK-ANN")
+ *  on the same address and port as frames, about once per second and as soon as their name changes.
+ *  Receivers cache the name by sender identifier and use it for frames of that sender.
+ *
+ *  Sender usage:
+ *      Ponk::SenderAnnouncer announcer;
+ *      header.protocolVersion = 3;
+ *      if (announcer.update(header)) {
+ *          socket.sendTo(addr, announcer.packet().data(), announcer.packet().size());
+ *      }
+ *
+ *  Receiver usage (before readChunkHeader):
+ *      if (senderNames.readAnnouncement(buffer, size)) continue;
+ *      ...
+ *      senderNames.fillName(header);
+ */
+
+#include "PonkDefs.h"
+#include "PonkHeader.h"
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstring>
+
+namespace Ponk {
+
+// Write an announcement for this sender, returns written size (buffer must hold sizeof(GeomUdpAnnouncement))
+inline size_t writeAnnouncement(unsigned int senderIdentifier, const char (&senderName)[32], unsigned char* buffer) {
+    GeomUdpAnnouncement raw;
+    memcpy(raw.headerString, PONK_ANNOUNCEMENT_STRING, sizeof(raw.headerString));
+    raw.protocolVersion = 3;
+    raw.senderIdentifier = senderIdentifier;
+    memcpy(raw.senderName, senderName, sizeof(raw.senderName));
+    memcpy(buffer, &raw, sizeof(raw));
+    return sizeof(raw);
+}
+
+// Returns false if the buffer is not an announcement. Bytes after the sender name are ignored.
+inline bool readAnnouncement(const unsigned char* buffer, size_t size, unsigned int& senderIdentifier, char (&senderName)[32]) {
+    if (size < sizeof(GeomUdpAnnouncement) || strncmp(reinterpret_cast<const char*>(buffer), PONK_ANNOUNCEMENT_STRING, 8) != 0) {
+        return false;
+    }
+    GeomUdpAnnouncement raw;
+    memcpy(&raw, buffer, sizeof(raw));
+    senderIdentifier = raw.senderIdentifier;
+    memcpy(senderName, raw.senderName, sizeof(senderName));
+    senderName[31] = '\0';
+    return true;
+}
+
+// Sender side: decides when to send announcements and keeps the packet
+class SenderAnnouncer {
+public:
+    void setInterval(std::chrono::milliseconds interval) {
+        m_interval = interval;
+    }
+
+    // Returns true when an announcement should be sent for this header: first call, sender identifier
+    // or name changed, or interval elapsed since last one. packet() is then up to date.
+    bool update(const ChunkHeader& header) {
+        const auto now = std::chrono::steady_clock::now();
+        const bool changed = m_packet.empty()
+            || m_senderIdentifier != header.senderIdentifier
+            || memcmp(m_senderName, header.senderName, sizeof(m_senderName)) != 0;
+        if (!changed && now - m_lastTime < m_interval) {
+            return false;
+        }
+        m_senderIdentifier = header.senderIdentifier;
+        memcpy(m_senderName, header.senderName, sizeof(m_senderName));
+        m_packet.resize(sizeof(GeomUdpAnnouncement));
+        writeAnnouncement(m_senderIdentifier, m_senderName, m_packet.data());
+        m_lastTime = now;
+        return true;
+    }
+
+    const std::vector<unsigned char>& packet() const {
+        return m_packet;
+    }
+
+private:
+    std::chrono::milliseconds m_interval = std::chrono::milliseconds(1000);
+    std::chrono::steady_clock::time_point m_lastTime;
+    unsigned int m_senderIdentifier = 0;
+    char m_senderName[32] = {};
+    std::vector<unsigned char> m_packet;
+};
+
+// Receiver side: sender names received in announcements
+class SenderNameCache {
+public:
+    // Returns true if the packet is an announcement (it has then been handled, it is not a frame chunk)
+    bool readAnnouncement(const unsigned char* buffer, size_t size) {
+        unsigned int senderIdentifier;
+        Name name;
+        if (!Ponk::readAnnouncement(buffer, size, senderIdentifier, name.value)) {
+            return false;
+        }
+        m_names[senderIdentifier] = name;
+        return true;
+    }
+
+    // Set header sender name from cache if the header didn't carry it (compact header).
+    // Returns false if the name of this sender is not known yet (header name is then left empty).
+    bool fillName(ChunkHeader& header) const {
+        if (header.senderName[0] != '\0') {
+            return true;
+        }
+        const auto it = m_names.find(header.senderIdentifier);
+        if (it == m_names.end()) {
+            return false;
+        }
+        memcpy(header.senderName, it->second.value, sizeof(header.senderName));
+        return true;
+    }
+
+    void clear() {
+        m_names.clear();
+    }
+
+private:
+    struct Name {
+        char value[32] = {};
+    };
+    std::map<unsigned int, Name> m_names;
+};
+
+} // namespace Ponk
@@ -0,0 +1,262 @@
+#pragma once
+
+/*
+ *  Sender side: cut a frame in chunk packets (header + data) ready to be sent over UDP.
+ *
+ *  Usage:
+ *      Ponk::FrameChunker chunker;
+ *      Ponk::ChunkHeader header;           // fill senderIdentifier, senderName, frameNumber, flags
+ *      if (chunker.buildPackets(fullData, header)) {
+ *          for (size_t i = 0; i < chunker.packetCount(); i++) {
+ *              socket.sendTo(addr, chunker.packet(i).data(), chunker.packet(i).size());
+ *          }
+ *      }
+ *
+ *  maxPacketSize (UDP payload size) defaults to PONK_MAX_CHUNK_SIZE, use chunkSizeForMtu() with the path MTU
+ *  (DatagramSocket::pathMtu) or PONK_JUMBO_CHUNK_SIZE to send bigger chunks.
+ *  Chunk count, chunk numbers and data CRC are computed here. Packet buffers are kept between frames
+ *  to avoid reallocations.
+ *  When a parity ratio is set, PONK_FLAG_FEC is set and parity chunks are appended (see PonkFec.h).
+ *  Frames needing more than 255 chunks are sent with the extended header (protocol version 2).
+ *  When path alignment is on, chunks are cut on path boundaries and PONK_FLAG_PATH_ALIGNED is set, unless
+ *  the frame can't be cut this way (it is then sent as usual, see PonkPathAlignment.h).
+ */
+
+#include "PonkDefs.h"
+#include "PonkHeader.h"
+#include "PonkCompression.h"
+#include "PonkFec.h"
+#include "PonkPathAlignment.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+namespace Ponk {
+
+// Chunk size (UDP payload) for packets of mtu bytes (IPv4 and UDP headers excluded),
+// PONK_MAX_CHUNK_SIZE if the MTU is unknown (0)
+inline size_t chunkSizeForMtu(int mtu) {
+    if (mtu <= 0) {
+        return PONK_MAX_CHUNK_SIZE;
+    }
+    const int chunkSize = mtu - 20 - 8;
+    if (chunkSize < PONK_MIN_CHUNK_SIZE) {
+        return PONK_MIN_CHUNK_SIZE;
+    }
+    if (chunkSize > PONK_MAX_UDP_PAYLOAD_SIZE) {
+        return PONK_MAX_UDP_PAYLOAD_SIZE;
+    }
+    return static_cast<size_t>(chunkSize);
+}
+
+class FrameChunker {
+public:
+    // Parity chunks sent per data chunk (ie 0.25 = one parity chunk every 4 data chunks), 0 to disable FEC
+    void setParityRatio(float ratio) {
+        m_parityRatio = ratio < 0 ? 0 : (ratio > 1 ? 1 : ratio);
+    }
+
+    float parityRatio() const {
+        return m_parityRatio;
+    }
+
+    // Cut chunks on path boundaries so each chunk can be parsed on its own
+    void setPathAligned(bool pathAligned) {
+        m_pathAligned = pathAligned;
+    }
+
+    bool pathAligned() const {
+        return m_pathAligned;
+    }
+
+    // Returns false and sets error() if the frame can't be sent
+    bool buildPackets(const std::vector<unsigned char>& frameData, const ChunkHeader& header,
+                      size_t maxPacketSize = PONK_MAX_CHUNK_SIZE)
+    {
+        if (buildPacketsWithVersion(frameData, header, maxPacketSize)) {
+            return true;
+        }
+        // More than 255 chunks: retry with 16 bits chunk numbers
+        if (!m_tooManyChunks || chunkHeaderVersion(header) >= 2) {
+            return false;
+        }
+        ChunkHeader extendedHeader = header;
+        extendedHeader.protocolVersion = 2;
+        return buildPacketsWithVersion(frameData, extendedHeader, maxPacketSize);
+    }
+
+    size_t packetCount() const {
+        return m_packetCount;
+    }
+
+    const std::vector<unsigned char>& packet(size_t index) const {
+        return m_packets[index];
+    }
+
+    const std::string& error() const {
+        return m_error;
+    }
+
+private:
+    bool buildPacketsWithVersion(const std::vector<unsigned char>& frameData, const ChunkHeader& header,
+                                 size_t maxPacketSize)
+    {
+        ChunkHeader chunkHeader = header;
+        if (m_pathAligned && !frameData.empty()) {
+            chunkHeader.flags |= PONK_FLAG_PATH_ALIGNED;
+            if (cutFrame(frameData, chunkHeader, maxPacketSize, true)) {
+                return true;
+            }
+        }
+        chunkHeader.flags &= ~PONK_FLAG_PATH_ALIGNED;
+        return cutFrame(frameData, chunkHeader, maxPacketSize, false);
+    }
+
+    bool cutFrame(const std::vector<unsigned char>& frameData, const ChunkHeader& header,
+                  size_t maxPacketSize, bool pathAligned)
+    {
+        m_error.clear();
+        m_packetCount = 0;
+        m_tooManyChunks = false;
+
+        ChunkHeader chunkHeader = header;
+        // An empty frame is sent as a single empty chunk, nothing to compress
+        if (frameData.empty()) {
+            chunkHeader.flags &= ~PONK_FLAG_COMPRESSED;
+        }
+        if (m_parityRatio > 0) {
+            chunkHeader.flags |= PONK_FLAG_FEC;
+        } else {
+            chunkHeader.flags &= ~PONK_FLAG_FEC;
+        }
+
+        const size_t headerSize = chunkHeaderSize(chunkHeader);
+        if (maxPacketSize <= headerSize + 16) {
+            m_error = "Chunk size is too small";
+            return false;
+        }
+        // Parity chunks carry the payload size on top of the payload, keep room for it
+        const size_t maxDataSize = maxPacketSize - headerSize - ((chunkHeader.flags & PONK_FLAG_FEC) ? 2 : 0);
+
+        const bool compressed = (chunkHeader.flags & PONK_FLAG_COMPRESSED) != 0;
+        const std::vector<unsigned char>* data = &frameData;
+        if (pathAligned) {
+            // Compressed chunks: keep room for the uncompressed size and the worst case expansion of the block
+            const size_t maxRawSize = compressed ? (maxDataSize - 4) * 255 / 256 : maxDataSize;
+            if (!m_aligner.alignFrame(frameData, maxRawSize)) {
+                return false;
+            }
+            data = &m_aligner.data();
+        }
+
+        // Compute data CRC
+        chunkHeader.dataCrc = 0;
+        for (auto v: *data) {
+            chunkHeader.dataCrc += v;
+        }
+
+        if (pathAligned) {
+            size_t chunkStart = 0;
+            for (size_t chunkEnd: m_aligner.chunkEnds()) {
+                const size_t rawSize = chunkEnd - chunkStart;
+                if (compressed) {
+                    std::vector<unsigned char>& packet = nextPacket(maxPacketSize);
+                    unsigned char* payload = &packet[headerSize];
+                    size_t consumed = 0;
+                    const size_t compressedSize = compressBlock(&(*data)[chunkStart], rawSize, payload + 2, maxDataSize - 2, consumed);
+                    if (consumed != rawSize) {
+                        m_error = "Failed to compress frame data";
+                        return false;
+                    }
+                    payload[0] = static_cast<unsigned char>(rawSize & 0xFF);
+                    payload[1] = static_cast<unsigned char>((rawSize >> 8) & 0xFF);
+                    packet.resize(headerSize + 2 + compressedSize);
+                } else {
+                    std::vector<unsigned char>& packet = nextPacket(headerSize + rawSize);
+                    memcpy(&packet[headerSize], &(*data)[chunkStart], rawSize);
+                }
+                chunkStart = chunkEnd;
+            }
+        } else if (compressed) {
+            // Each chunk is an independent block: compress as much data as fits in the chunk
+            size_t written = 0;
+            while (written < frameData.size()) {
+                std::vector<unsigned char>& packet = nextPacket(maxPacketSize);
+                unsigned char* payload = &packet[headerSize];
+                size_t consumed = 0;
+                const size_t compressedSize = compressBlock(&frameData[written], frameData.size() - written,
+                                                            payload + 2, maxDataSize - 2, consumed);
+                if (consumed == 0) {
+                    m_error = "Failed to compress frame data";
+                    return false;
+                }
+                payload[0] = static_cast<unsigned char>(consumed & 0xFF);
+                payload[1] = static_cast<unsigned char>((consumed >> 8) & 0xFF);
+                packet.resize(headerSize + 2 + compressedSize);
+                written += consumed;
+            }
+        } else {
+            size_t written = 0;
+            do {
+                const size_t dataBytesForThisChunk = std::min<size_t>(frameData.size() - written, maxDataSize);
+                std::vector<unsigned char>& packet = nextPacket(headerSize + dataBytesForThisChunk);
+                if (dataBytesForThisChunk > 0) {
+                    memcpy(&packet[headerSize], &frameData[written], dataBytesForThisChunk);
+                }
+                written += dataBytesForThisChunk;
+            } while (written < frameData.size());
+        }
+
+        if (m_packetCount > maxChunkCount(chunkHeader)) {
+            m_error = "Protocol doesn't accept sending a packet that would be splitted in more than "
+                      + std::to_string(maxChunkCount(chunkHeader)) + " chunks";
+            m_tooManyChunks = true;
+            m_packetCount = 0;
+            return false;
+        }
+
+        // Parity chunks, limited so that chunk numbers still fit the header
+        const size_t dataChunkCount = m_packetCount;
+        chunkHeader.parityChunkCount = 0;
+        if (chunkHeader.flags & PONK_FLAG_FEC) {
+            chunkHeader.parityChunkCount = std::min<unsigned int>(
+                fecParityChunkCount(static_cast<unsigned int>(dataChunkCount), m_parityRatio),
+                static_cast<unsigned int>(maxChunkCount(chunkHeader) - dataChunkCount));
+            for (unsigned int p = 0; p < chunkHeader.parityChunkCount; p++) {
+                std::vector<unsigned char>& parity = nextPacket(headerSize);
+                for (size_t i = p; i < dataChunkCount; i += chunkHeader.parityChunkCount) {
+                    fecAccumulate(parity, headerSize, m_packets[i].data() + headerSize, m_packets[i].size() - headerSize);
+                }
+            }
+        }
+
+        // Now that chunk count is known, write headers
+        chunkHeader.chunkCount = static_cast<unsigned int>(dataChunkCount);
+        for (size_t i = 0; i < m_packetCount; i++) {
+            chunkHeader.chunkNumber = static_cast<unsigned int>(i);
+            writeChunkHeader(chunkHeader, &m_packets[i][0]);
+        }
+
+        return true;
+    }
+
+    std::vector<unsigned char>& nextPacket(size_t size) {
+        if (m_packets.size() <= m_packetCount) {
+            m_packets.resize(m_packetCount + 1);
+        }
+        std::vector<unsigned char>& packet = m_packets[m_packetCount++];
+        packet.resize(size);
+        return packet;
+    }
+
+    std::vector<std::vector<unsigned char>> m_packets;
+    size_t m_packetCount = 0;
+    std::string m_error;
+    float m_parityRatio = 0;
+    bool m_pathAligned = false;
+    bool m_tooManyChunks = false;
+    PathAligner m_aligner;
+};
+
+} // namespace Ponk
@@ -0,0 +1,159 @@
+#pragma once
+
+/*
+ *  Frame timestamps and clock sync (PONK_FLAG_TIMESTAMP and "PONK-SYN" messages)
+ *
+ *  Senders stamp frames with their capture time (clockMicroseconds() on sender clock). To compare it with
+ *  their own clock, receivers estimate the offset between both clocks with a PTP-like exchange:
+ *      - Receiver sends a request at T1 (receiver clock) to the source address of the sender frames
+ *      - Sender reads it at T2 and answers at T3 (sender clock), to the source address of the request
+ *      - Receiver reads the response at T4 (receiver clock)
+ *      - offset (sender - receiver) = ((T2 - T1) + (T3 - T4)) / 2, round trip = (T4 - T1) - (T3 - T2)
+ *  The exchange is repeated about once per second, and the offset of the sample with the shortest round
+ *  trip among the last ones is used (the least delayed by network queues or sender processing).
+ *  Senders typically read requests once per frame, so the time a request waits for the sender is not
+ *  measured: receivers should send requests at random times (ie not when receiving a frame, which would
+ *  always make the request wait about a frame) so that some requests are read right away.
+ *
+ *  Receivers can then compute each frame latency (receive time - capture time), and show frames at
+ *  capture time + a fixed delay: receivers synchronized to the same sender show its frames at the same time.
+ *
+ *  Sender usage (poll the sending socket, ie once per frame):
+ *      while (socket.recvFrom(addr, buffer, size) && size > 0) {
+ *          if (Ponk::answerClockSync(buffer, size, senderIdentifier, response))
+ *              socket.sendTo(addr, response.data(), response.size());
+ *      }
+ */
+
+#include "PonkDefs.h"
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+namespace Ponk {
+
+// Monotonic clock used for timestamps and clock sync, in microseconds
+inline unsigned long long clockMicroseconds() {
+    return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Returns false if the buffer is not a clock sync message
+inline bool readClockSync(const unsigned char* buffer, size_t size, GeomUdpClockSync& message) {
+    if (size < sizeof(GeomUdpClockSync) || strncmp(reinterpret_cast<const char*>(buffer), PONK_CLOCK_SYNC_STRING, 8) != 0) {
+        return false;
+    }
+    memcpy(&message, buffer, sizeof(message));
+    return true;
+}
+
+inline void writeClockSync(const GeomUdpClockSync& message, std::vector<unsigned char>& packet) {
+    packet.resize(sizeof(GeomUdpClockSync));
+    memcpy(packet.data(), &message, sizeof(message));
+}
+
+// Sender side: if buffer is a clock sync request for this sender, fill the response to send back to
+// the request source address and return true
+inline bool answerClockSync(const unsigned char* buffer, size_t size, unsigned int senderIdentifier,
+                            std::vector<unsigned char>& response) {
+    const unsigned long long receiveTime = clockMicroseconds();
+    GeomUdpClockSync message;
+    if (!readClockSync(buffer, size, message) || message.type != 0 || message.senderIdentifier != senderIdentifier) {
+        return false;
+    }
+    message.type = 1;
+    message.t2 = receiveTime;
+    message.t3 = clockMicroseconds();
+    writeClockSync(message, response);
+    return true;
+}
+
+// Receiver side: clock offset estimation for one sender
+class ClockSync {
+public:
+    // Returns true (and fills request) when a new request should be sent to the sender:
+    // a few quick ones to get a first estimation, then about once per second (with some jitter,
+    // so requests don't stay in phase with sender frames)
+    bool requestDue(unsigned int senderIdentifier, std::vector<unsigned char>& request) {
+        const unsigned long long now = clockMicroseconds();
+        if (now < m_nextRequestTime) {
+            return false;
+        }
+        const unsigned long long interval = m_sampleCount < kSampleCount / 2 ? 200000 : 1000000;
+        m_nextRequestTime = now + interval / 2 + (now * 2654435761ull) % interval;
+        GeomUdpClockSync message;
+        memcpy(message.headerString, PONK_CLOCK_SYNC_STRING, sizeof(message.headerString));
+        message.protocolVersion = 3;
+        message.type = 0;
+        message.senderIdentifier = senderIdentifier;
+        message.t1 = now;
+        message.t2 = 0;
+        message.t3 = 0;
+        writeClockSync(message, request);
+        m_lastRequestTime = now;
+        return true;
+    }
+
+    // Add a response, ignored if it doesn't answer our last request (ie response to another receiver
+    // sharing the port on the same computer)
+    void addResponse(const GeomUdpClockSync& response) {
+        const unsigned long long t4 = clockMicroseconds();
+        if (response.type != 1 || response.t1 != m_lastRequestTime || t4 < response.t1 || response.t3 < response.t2) {
+            return;
+        }
+        Sample& sample = m_samples[m_nextSample];
+        sample.roundTrip = static_cast<int64_t>(t4 - response.t1) - static_cast<int64_t>(response.t3 - response.t2);
+        sample.offset = (static_cast<int64_t>(response.t2 - response.t1) + static_cast<int64_t>(response.t3 - t4)) / 2;
+        m_nextSample = (m_nextSample + 1) % kSampleCount;
+        if (m_sampleCount < kSampleCount) {
+            m_sampleCount++;
+        }
+
+        // Keep the offset of the sample with the shortest round trip
+        int best = 0;
+        for (int i = 1; i < m_sampleCount; i++) {
+            if (m_samples[i].roundTrip < m_samples[best].roundTrip) {
+                best = i;
+            }
+        }
+        m_offset = m_samples[best].offset;
+        m_roundTrip = m_samples[best].roundTrip;
+    }
+
+    bool synchronized() const {
+        return m_sampleCount > 0;
+    }
+
+    // Sender clock - receiver clock, in microseconds
+    int64_t offset() const {
+        return m_offset;
+    }
+
+    int64_t roundTrip() const {
+        return m_roundTrip;
+    }
+
+    // Convert a sender clock time to receiver clock
+    unsigned long long toLocalTime(unsigned long long senderTime) const {
+        return static_cast<unsigned long long>(static_cast<int64_t>(senderTime) - m_offset);
+    }
+
+private:
+    static const int kSampleCount = 8;
+
+    struct Sample {
+        int64_t offset = 0;
+        int64_t roundTrip = 0;
+    };
+
+    Sample m_samples[kSampleCount];
+    int m_sampleCount = 0;
+    int m_nextSample = 0;
+    int64_t m_offset = 0;
+    int64_t m_roundTrip = 0;
+    unsigned long long m_lastRequestTime = 0;
+    unsigned long long m_nextRequestTime = 0;
+};
+
+} // namespace Ponk
@@ -0,0 +1,243 @@
+#pragma once
+
+/*
+ *  Fast LZ block codec used for PONK_FLAG_COMPRESSED frames
+ *
+ *  When a sender sets PONK_FLAG_COMPRESSED in the chunk header, the frame data is compressed before
+ *  chunking, with compression blocks aligned on chunks: each chunk payload is an independent block
+ *  that can be decompressed as soon as it arrives, without the other chunks of the frame.
+ *
+ *  Chunk payload layout:
+ *      - Uncompressed Size - unsigned short (16 bits)
+ *      - Compressed block
+ *
+ *  Block format (LZ77, byte oriented, no entropy coding):
+ *      - Sequence of:
+ *          - Token - unsigned char: high 4 bits = literal count, low 4 bits = match length - 4
+ *            (a nibble of 15 means more bytes follow: add each following byte, until a byte < 255)
+ *          - Literals
+ *          - Match offset - unsigned short (1..65535), only if the block is not finished
+ *          - Match length extra bytes if low nibble is 15
+ *      - The last sequence of a block has literals only
+ */
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+namespace Ponk {
+
+constexpr size_t kCompressionMinMatch = 4;
+constexpr size_t kCompressionHashBits = 12;
+constexpr size_t kCompressionMaxBlockSize = 65535;
+
+inline unsigned int compressionRead32(const unsigned char* p) {
+    unsigned int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline unsigned int compressionHash(unsigned int v) {
+    return (v * 2654435761u) >> (32 - kCompressionHashBits);
+}
+
+// Number of extension bytes needed to write a length whose nibble saturates at 15
+inline size_t compressionLengthExtraBytes(size_t length) {
+    return length < 15 ? 0 : 1 + (length - 15) / 255;
+}
+
+// Most literals a final sequence can hold in 'available' bytes (token, length extension bytes and literals)
+inline size_t compressionMaxFinalLiterals(size_t available) {
+    if (available < 17) {
+        return available == 0 ? 0 : (available - 1 < 14 ? available - 1 : 14);
+    }
+    // 15 or more literals take 2 + (count - 15) / 255 bytes besides them: 256 bytes hold 255 more literals
+    const size_t extra = available - 17;
+    return 15 + 255 * (extra / 256) + (extra % 256 < 254 ? extra % 256 : 254);
+}
+
+inline unsigned char* compressionWriteLength(unsigned char* op, size_t length) {
+    if (length < 15) {
+        return op;
+    }
+    length -= 15;
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<unsigned char>(length);
+    return op;
+}
+
+// Compress as much of src as fits in dstCapacity bytes.
+// Returns the compressed size and sets srcConsumed to the number of source bytes it represents
+// (at most kCompressionMaxBlockSize), so the caller can start the next block from there.
+inline size_t compressBlock(const unsigned char* src, size_t srcSize,
+                            unsigned char* dst, size_t dstCapacity,
+                            size_t& srcConsumed)
+{
+    if (srcSize > kCompressionMaxBlockSize) {
+        srcSize = kCompressionMaxBlockSize;
+    }
+
+    int hashTable[1 << kCompressionHashBits];
+    for (auto& v: hashTable) {
+        v = -1;
+    }
+
+    unsigned char* op = dst;
+    unsigned char* const opEnd = dst + dstCapacity;
+    size_t ip = 0;
+    size_t anchor = 0;
+
+    while (ip + kCompressionMinMatch <= srcSize) {
+        // Once pending literals don't fit anymore, no later match can be written: the final literals take what fits
+        const size_t pendingLiterals = ip - anchor;
+        if (1 + compressionLengthExtraBytes(pendingLiterals) + pendingLiterals + 1 > static_cast<size_t>(opEnd - op)) {
+            break;
+        }
+
+        const unsigned int sequence = compressionRead32(src + ip);
+        const unsigned int h = compressionHash(sequence);
+        const int ref = hashTable[h];
+        hashTable[h] = static_cast<int>(ip);
+
+        if (ref < 0 || compressionRead32(src + ref) != sequence) {
+            ip++;
+            continue;
+        }
+
+        size_t matchLength = kCompressionMinMatch;
+        while (ip + matchLength < srcSize && src[ref + matchLength] == src[ip + matchLength]) {
+            matchLength++;
+        }
+
+        // Keep at least one byte for the final literals token
+        const size_t literalCount = ip - anchor;
+        const size_t cost = 1 + compressionLengthExtraBytes(literalCount) + literalCount
+                            + 2 + compressionLengthExtraBytes(matchLength - kCompressionMinMatch);
+        if (static_cast<size_t>(opEnd - op) < cost + 1) {
+            break;
+        }
+
+        unsigned char* token = op++;
+        *token = static_cast<unsigned char>(((literalCount < 15 ? literalCount : 15) << 4)
+                                            | (matchLength - kCompressionMinMatch < 15 ? matchLength - kCompressionMinMatch : 15));
+        op = compressionWriteLength(op, literalCount);
+        memcpy(op, src + anchor, literalCount);
+        op += literalCount;
+        const size_t offset = ip - static_cast<size_t>(ref);
+        *op++ = static_cast<unsigned char>(offset & 0xFF);
+        *op++ = static_cast<unsigned char>((offset >> 8) & 0xFF);
+        op = compressionWriteLength(op, matchLength - kCompressionMinMatch);
+
+        ip += matchLength;
+        anchor = ip;
+    }
+
+    // Final literals: as many as still fit
+    const size_t available = static_cast<size_t>(opEnd - op);
+    const size_t maxLiteralCount = compressionMaxFinalLiterals(available);
+    const size_t literalCount = srcSize - anchor < maxLiteralCount ? srcSize - anchor : maxLiteralCount;
+    if (available == 0) {
+        srcConsumed = anchor;
+        return static_cast<size_t>(op - dst);
+    }
+    *op++ = static_cast<unsigned char>((literalCount < 15 ? literalCount : 15) << 4);
+    op = compressionWriteLength(op, literalCount);
+    memcpy(op, src + anchor, literalCount);
+    op += literalCount;
+
+    srcConsumed = anchor + literalCount;
+    return static_cast<size_t>(op - dst);
+}
+
+// Decompress a block into exactly dstSize bytes. Returns false if the block is corrupt.
+inline bool decompressBlock(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+{
+    const unsigned char* ip = src;
+    const unsigned char* const ipEnd = src + srcSize;
+    unsigned char* op = dst;
+    unsigned char* const opEnd = dst + dstSize;
+
+    while (ip < ipEnd) {
+        const unsigned char token = *ip++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15) {
+            unsigned char b;
+            do {
+                if (ip >= ipEnd) {
+                    return false;
+                }
+                b = *ip++;
+                literalCount += b;
+            } while (b == 255);
+        }
+        if (static_cast<size_t>(ipEnd - ip) < literalCount || static_cast<size_t>(opEnd - op) < literalCount) {
+            return false;
+        }
+        memcpy(op, ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+
+        // Last sequence has no match
+        if (ip == ipEnd) {
+            break;
+        }
+
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+            return false;
+        }
+
+        size_t matchLength = (token & 0x0F);
+        if (matchLength == 15) {
+            unsigned char b;
+            do {
+                if (ip >= ipEnd) {
+                    return false;
+                }
+                b = *ip++;
+                matchLength += b;
+            } while (b == 255);
+        }
+        matchLength += kCompressionMinMatch;
+        if (static_cast<size_t>(opEnd - op) < matchLength) {
+            return false;
+        }
+
+        const unsigned char* match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // Overlapping copy (repeated pattern)
+            for (size_t i = 0; i < matchLength; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == opEnd;
+}
+
+// Decompress a PONK_FLAG_COMPRESSED chunk payload (uncompressed size + block) into out
+inline bool decompressChunkPayload(const unsigned char* payload, size_t payloadSize, std::vector<unsigned char>& out)
+{
+    if (payloadSize < 2) {
+        return false;
+    }
+    const size_t rawSize = payload[0] | (payload[1] << 8);
+    out.resize(rawSize);
+    if (rawSize == 0) {
+        return payloadSize == 2;
+    }
+    return decompressBlock(payload + 2, payloadSize - 2, &out[0], rawSize);
+}
+
+} // namespace Ponk
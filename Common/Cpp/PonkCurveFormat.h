@@ -0,0 +1,313 @@
+#pragma once
+
+/*
+ *  PONK_DATA_FORMAT_CURVES encoder / evaluation
+ *
+ *  Smooth shapes sent as sampled points cost a lot (a circle of 4096 points is 45 KB in
+ *  PONK_DATA_FORMAT_XY_F32_RGB_U8) while the shape itself needs a few numbers. This format describes a path
+ *  as a start point followed by segments, the receiver samples them (see PonkCurveTessellation.h).
+ *  The path "point count" field holds the segment count.
+ *
+ *  Layout after the path segment count:
+ *      - Start Point: X, Y as float 32, R, G, B as unsigned char
+ *      - For each segment:
+ *          - Segment Type - unsigned char
+ *          - Segment data, X,Y as float 32 (same space as other formats, [-1,+1]):
+ *              - kCurveSegmentLine: End X,Y
+ *              - kCurveSegmentQuadratic: Control X,Y, End X,Y (quadratic Bezier)
+ *              - kCurveSegmentCubic: Control 1 X,Y, Control 2 X,Y, End X,Y (cubic Bezier)
+ *              - kCurveSegmentArc: Center X,Y, Sweep Angle (float 32, radians, positive is counterclockwise).
+ *                Circular arc starting at the current point, around Center
+ *          - R, G, B - unsigned char: color of all points of the segment
+ *      Each segment starts where the previous one ends.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+namespace Ponk {
+
+const unsigned char kCurveSegmentLine = 0;
+const unsigned char kCurveSegmentQuadratic = 1;
+const unsigned char kCurveSegmentCubic = 2;
+const unsigned char kCurveSegmentArc = 3;
+
+// Most points a segment is tessellated with
+const unsigned int kMaxCurveSegmentPoints = 4096;
+
+// Size of the start point record
+const size_t kCurveStartPointSize = 2 * sizeof(float) + 3;
+
+// Size of a segment record (type, data and color), 0 for an unknown type
+inline size_t curveSegmentSize(unsigned char type) {
+    switch (type) {
+    case kCurveSegmentLine:
+        return 1 + 2 * sizeof(float) + 3;
+    case kCurveSegmentQuadratic:
+        return 1 + 4 * sizeof(float) + 3;
+    case kCurveSegmentCubic:
+        return 1 + 6 * sizeof(float) + 3;
+    case kCurveSegmentArc:
+        return 1 + 3 * sizeof(float) + 3;
+    default:
+        return 0;
+    }
+}
+
+// Size of the data of a path of segmentCount segments. Returns false if truncated or using an unknown segment type.
+inline bool curvePathSize(const unsigned char* data, size_t size, unsigned int segmentCount, size_t& bytes) {
+    size_t offset = kCurveStartPointSize;
+    for (unsigned int i = 0; i < segmentCount; i++) {
+        if (size < offset + 1) {
+            return false;
+        }
+        const size_t segmentSize = curveSegmentSize(data[offset]);
+        if (segmentSize == 0) {
+            return false;
+        }
+        offset += segmentSize;
+    }
+    if (size < offset) {
+        return false;
+    }
+    bytes = offset;
+    return true;
+}
+
+inline float curveReadFloat(const unsigned char* p) {
+    float v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Color of a segment record
+inline const unsigned char* curveSegmentColor(const unsigned char* segment) {
+    return segment + curveSegmentSize(segment[0]) - 3;
+}
+
+// End point of a segment starting at x,y
+inline void curveSegmentEnd(const unsigned char* segment, float x, float y, float& endX, float& endY) {
+    const unsigned char* p = segment + 1;
+    switch (segment[0]) {
+    case kCurveSegmentArc: {
+        const float cx = curveReadFloat(p);
+        const float cy = curveReadFloat(p + 4);
+        const double sweep = curveReadFloat(p + 8);
+        const double radius = std::sqrt(static_cast<double>(x - cx) * (x - cx) + static_cast<double>(y - cy) * (y - cy));
+        const double startAngle = std::atan2(static_cast<double>(y - cy), static_cast<double>(x - cx));
+        endX = static_cast<float>(cx + radius * std::cos(startAngle + sweep));
+        endY = static_cast<float>(cy + radius * std::sin(startAngle + sweep));
+        break;
+    }
+    default:
+        // End point is the last point of the segment data
+        endX = curveReadFloat(segment + curveSegmentSize(segment[0]) - 11);
+        endY = curveReadFloat(segment + curveSegmentSize(segment[0]) - 7);
+        break;
+    }
+}
+
+// Number of points needed so the polyline stays within tolerance of the segment starting at x,y
+// (Wang's formula for Bezier segments, sagitta for arcs)
+inline unsigned int curveSegmentPointCount(const unsigned char* segment, float x, float y, float tolerance) {
+    const unsigned char* p = segment + 1;
+    double n = 1;
+    switch (segment[0]) {
+    case kCurveSegmentQuadratic: {
+        const float ddx = x - 2 * curveReadFloat(p) + curveReadFloat(p + 8);
+        const float ddy = y - 2 * curveReadFloat(p + 4) + curveReadFloat(p + 12);
+        n = std::sqrt(std::sqrt(ddx * ddx + ddy * ddy) / (4 * tolerance));
+        break;
+    }
+    case kCurveSegmentCubic: {
+        const float ddx0 = x - 2 * curveReadFloat(p) + curveReadFloat(p + 8);
+        const float ddy0 = y - 2 * curveReadFloat(p + 4) + curveReadFloat(p + 12);
+        const float ddx1 = curveReadFloat(p) - 2 * curveReadFloat(p + 8) + curveReadFloat(p + 16);
+        const float ddy1 = curveReadFloat(p + 4) - 2 * curveReadFloat(p + 12) + curveReadFloat(p + 20);
+        const float dd = std::max(ddx0 * ddx0 + ddy0 * ddy0, ddx1 * ddx1 + ddy1 * ddy1);
+        n = std::sqrt(0.75 * std::sqrt(dd) / tolerance);
+        break;
+    }
+    case kCurveSegmentArc: {
+        const float cx = curveReadFloat(p);
+        const float cy = curveReadFloat(p + 4);
+        const double sweep = std::fabs(curveReadFloat(p + 8));
+        const double radius = std::sqrt(static_cast<double>(x - cx) * (x - cx) + static_cast<double>(y - cy) * (y - cy));
+        if (radius > tolerance) {
+            n = sweep / (2 * std::acos(1 - tolerance / radius));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    if (!(n < kMaxCurveSegmentPoints)) {
+        return kMaxCurveSegmentPoints;
+    }
+    return n < 1 ? 1 : static_cast<unsigned int>(std::ceil(n));
+}
+
+// Evaluate count points of the segment starting at x,y (at t = 1/count, 2/count... 1, the start point is not
+// written) into xs and ys. x,y are updated to the segment end point.
+// Bezier segments are evaluated in power basis with independent iterations, so the loops vectorize.
+inline void evaluateCurveSegment(const unsigned char* segment, float& x, float& y, unsigned int count, float* xs, float* ys) {
+    const unsigned char* p = segment + 1;
+    float endX, endY;
+    curveSegmentEnd(segment, x, y, endX, endY);
+    // Locals, so the compiler knows writing xs / ys doesn't change them
+    const float x0 = x;
+    const float y0 = y;
+    const float step = 1.f / count;
+    switch (segment[0]) {
+    case kCurveSegmentLine: {
+        const float dx = endX - x0;
+        const float dy = endY - y0;
+        for (unsigned int i = 0; i < count; i++) {
+            const float t = (i + 1) * step;
+            xs[i] = x0 + dx * t;
+            ys[i] = y0 + dy * t;
+        }
+        break;
+    }
+    case kCurveSegmentQuadratic: {
+        // P(t) = P0 + 2t(P1 - P0) + t^2(P0 - 2P1 + P2)
+        const float bx = 2 * (curveReadFloat(p) - x0);
+        const float by = 2 * (curveReadFloat(p + 4) - y0);
+        const float ax = x0 - 2 * curveReadFloat(p) + endX;
+        const float ay = y0 - 2 * curveReadFloat(p + 4) + endY;
+        for (unsigned int i = 0; i < count; i++) {
+            const float t = (i + 1) * step;
+            xs[i] = x0 + t * (bx + t * ax);
+            ys[i] = y0 + t * (by + t * ay);
+        }
+        break;
+    }
+    case kCurveSegmentCubic: {
+        // P(t) = P0 + 3t(P1 - P0) + 3t^2(P0 - 2P1 + P2) + t^3(P3 - 3P2 + 3P1 - P0)
+        const float x1 = curveReadFloat(p), y1 = curveReadFloat(p + 4);
+        const float x2 = curveReadFloat(p + 8), y2 = curveReadFloat(p + 12);
+        const float cx = 3 * (x1 - x0), cy = 3 * (y1 - y0);
+        const float bx = 3 * (x0 - 2 * x1 + x2), by = 3 * (y0 - 2 * y1 + y2);
+        const float ax = endX - 3 * x2 + 3 * x1 - x0, ay = endY - 3 * y2 + 3 * y1 - y0;
+        for (unsigned int i = 0; i < count; i++) {
+            const float t = (i + 1) * step;
+            xs[i] = x0 + t * (cx + t * (bx + t * ax));
+            ys[i] = y0 + t * (cy + t * (by + t * ay));
+        }
+        break;
+    }
+    case kCurveSegmentArc: {
+        // Rotate the radius vector by sweep / count at each point
+        const double cx = curveReadFloat(p);
+        const double cy = curveReadFloat(p + 4);
+        const double angle = curveReadFloat(p + 8) / count;
+        const double c = std::cos(angle);
+        const double s = std::sin(angle);
+        double rx = x0 - cx;
+        double ry = y0 - cy;
+        for (unsigned int i = 0; i < count; i++) {
+            const double r = rx * c - ry * s;
+            ry = rx * s + ry * c;
+            rx = r;
+            xs[i] = static_cast<float>(cx + rx);
+            ys[i] = static_cast<float>(cy + ry);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    // Exact end point (no rounding drift), the next segment starts from it
+    xs[count - 1] = endX;
+    ys[count - 1] = endY;
+    x = endX;
+    y = endY;
+}
+
+// Sender side: build the data of a PONK_DATA_FORMAT_CURVES path
+class CurvePathEncoder {
+public:
+    void clear() {
+        m_data.clear();
+        m_segmentCount = 0;
+    }
+
+    // Start point of the path, must be called first
+    void moveTo(float x, float y, unsigned char r, unsigned char g, unsigned char b) {
+        clear();
+        pushFloat(x);
+        pushFloat(y);
+        pushColor(r, g, b);
+    }
+
+    void lineTo(float x, float y, unsigned char r, unsigned char g, unsigned char b) {
+        m_data.push_back(kCurveSegmentLine);
+        pushFloat(x);
+        pushFloat(y);
+        pushColor(r, g, b);
+        m_segmentCount++;
+    }
+
+    void quadraticTo(float controlX, float controlY, float x, float y, unsigned char r, unsigned char g, unsigned char b) {
+        m_data.push_back(kCurveSegmentQuadratic);
+        pushFloat(controlX);
+        pushFloat(controlY);
+        pushFloat(x);
+        pushFloat(y);
+        pushColor(r, g, b);
+        m_segmentCount++;
+    }
+
+    void cubicTo(float control1X, float control1Y, float control2X, float control2Y, float x, float y,
+                 unsigned char r, unsigned char g, unsigned char b) {
+        m_data.push_back(kCurveSegmentCubic);
+        pushFloat(control1X);
+        pushFloat(control1Y);
+        pushFloat(control2X);
+        pushFloat(control2Y);
+        pushFloat(x);
+        pushFloat(y);
+        pushColor(r, g, b);
+        m_segmentCount++;
+    }
+
+    // Arc around centerX,centerY from the current point, sweepAngle in radians (2 * PI for a full circle)
+    void arcTo(float centerX, float centerY, float sweepAngle, unsigned char r, unsigned char g, unsigned char b) {
+        m_data.push_back(kCurveSegmentArc);
+        pushFloat(centerX);
+        pushFloat(centerY);
+        pushFloat(sweepAngle);
+        pushColor(r, g, b);
+        m_segmentCount++;
+    }
+
+    // Value of the path point count field
+    unsigned int segmentCount() const {
+        return m_segmentCount;
+    }
+
+    void write(std::vector<unsigned char>& data) const {
+        data.insert(data.end(), m_data.begin(), m_data.end());
+    }
+
+private:
+    void pushFloat(float value) {
+        unsigned char bytes[sizeof(float)];
+        memcpy(bytes, &value, sizeof(value));
+        m_data.insert(m_data.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    void pushColor(unsigned char r, unsigned char g, unsigned char b) {
+        m_data.push_back(r);
+        m_data.push_back(g);
+        m_data.push_back(b);
+    }
+
+    std::vector<unsigned char> m_data;
+    unsigned int m_segmentCount = 0;
+};
+
+} // namespace Ponk
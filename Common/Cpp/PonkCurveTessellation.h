@@ -0,0 +1,158 @@
+#pragma once
+
+/*
+ *  Receiver side tessellation of PONK_DATA_FORMAT_CURVES paths (see PonkCurveFormat.h)
+ *
+ *  Curve paths are converted to PONK_DATA_FORMAT_XY_F32_RGB_U8 paths (same meta data) after the path cache,
+ *  so path parsing only sees point formats. Each segment gets as many points as needed for the polyline to
+ *  stay within a tolerance of the curve. With a point budget, segments of a frame needing more points in
+ *  total get proportionally fewer (at least one each), so the receiver decides how dense its output is.
+ *
+ *  Receiver usage:
+ *      if (Ponk::hasCurvePaths(data, size) && !tessellator.tessellateFrame(data, size, tessellatedData)) drop frame;
+ */
+
+#include "PonkDefs.h"
+#include "PonkCurveFormat.h"
+#include "PonkPathCache.h"
+#include <vector>
+#include <cstring>
+
+namespace Ponk {
+
+// Returns true if the frame has paths using PONK_DATA_FORMAT_CURVES (stops at the first record it can't read)
+inline bool hasCurvePaths(const unsigned char* frame, size_t size) {
+    size_t offset = 0;
+    PathRecord record;
+    while (offset < size && readPathRecord(frame + offset, size - offset, record)) {
+        if (record.dataFormat == PONK_DATA_FORMAT_CURVES) {
+            return true;
+        }
+        offset += record.size;
+    }
+    return false;
+}
+
+class CurveTessellator {
+public:
+    // Largest distance between a curve and its polyline, in [-1,+1] coordinates
+    void setTolerance(float tolerance) {
+        m_tolerance = tolerance > 1e-6f ? tolerance : 1e-6f;
+    }
+
+    // Most points all curve paths of a frame are tessellated with, 0 for no limit
+    void setPointBudget(unsigned int pointBudget) {
+        m_pointBudget = pointBudget;
+    }
+
+    // Returns false if frame data can't be parsed
+    bool tessellateFrame(const unsigned char* frame, size_t size, std::vector<unsigned char>& out) {
+        out.clear();
+
+        // Points each segment needs at the tolerance
+        m_counts.clear();
+        size_t totalCount = 0;
+        size_t offset = 0;
+        while (offset < size) {
+            PathRecord record;
+            if (!readPathRecord(frame + offset, size - offset, record)) {
+                return false;
+            }
+            if (record.dataFormat == PONK_DATA_FORMAT_CURVES) {
+                const unsigned char* segment = frame + offset + record.pointsOffset;
+                float x = curveReadFloat(segment);
+                float y = curveReadFloat(segment + 4);
+                segment += kCurveStartPointSize;
+                for (unsigned int i = 0; i < record.pointCount; i++) {
+                    const unsigned int count = curveSegmentPointCount(segment, x, y, m_tolerance);
+                    m_counts.push_back(count);
+                    totalCount += count;
+                    curveSegmentEnd(segment, x, y, x, y);
+                    segment += curveSegmentSize(segment[0]);
+                }
+            }
+            offset += record.size;
+        }
+        const double budgetScale = (m_pointBudget > 0 && totalCount > m_pointBudget) ? double(m_pointBudget) / totalCount : 1;
+
+        size_t countIndex = 0;
+        offset = 0;
+        while (offset < size) {
+            PathRecord record;
+            readPathRecord(frame + offset, size - offset, record);
+            const unsigned char* recordData = frame + offset;
+            offset += record.size;
+            if (record.dataFormat != PONK_DATA_FORMAT_CURVES) {
+                out.insert(out.end(), recordData, recordData + record.size);
+                continue;
+            }
+
+            // A path holds at most 65535 points, start point included
+            const unsigned int* counts = &m_counts[countIndex];
+            countIndex += record.pointCount;
+            double scale = budgetScale;
+            size_t pathCount = 1;
+            for (unsigned int i = 0; i < record.pointCount; i++) {
+                pathCount += scaledCount(counts[i], scale);
+            }
+            if (pathCount > 0xFFFF) {
+                scale *= (0xFFFF - 1 - record.pointCount) / double(pathCount - 1);
+                pathCount = 1;
+                for (unsigned int i = 0; i < record.pointCount; i++) {
+                    pathCount += scaledCount(counts[i], scale);
+                }
+                if (pathCount > 0xFFFF) {
+                    return false;   // More than 65534 segments
+                }
+            }
+
+            const unsigned char formatBits = recordData[0] & (PONK_DATA_FORMAT_CONTINUATION | PONK_DATA_FORMAT_INDEXED_META_DATA);
+            out.push_back(static_cast<unsigned char>(formatBits | PONK_DATA_FORMAT_XY_F32_RGB_U8));
+            out.insert(out.end(), recordData + 1, recordData + record.pointsOffset - 2);
+            out.push_back(static_cast<unsigned char>(pathCount & 0xFF));
+            out.push_back(static_cast<unsigned char>((pathCount >> 8) & 0xFF));
+
+            // The start point is already in the output format
+            const size_t stride = fixedPointStride(PONK_DATA_FORMAT_XY_F32_RGB_U8);
+            const unsigned char* segment = recordData + record.pointsOffset;
+            out.insert(out.end(), segment, segment + kCurveStartPointSize);
+            float x = curveReadFloat(segment);
+            float y = curveReadFloat(segment + 4);
+            segment += kCurveStartPointSize;
+            for (unsigned int i = 0; i < record.pointCount; i++) {
+                const unsigned int count = scaledCount(counts[i], scale);
+                m_xs.resize(count);
+                m_ys.resize(count);
+                evaluateCurveSegment(segment, x, y, count, m_xs.data(), m_ys.data());
+                const unsigned char* color = curveSegmentColor(segment);
+                const size_t pointOffset = out.size();
+                out.resize(pointOffset + static_cast<size_t>(count) * stride);
+                unsigned char* point = &out[pointOffset];
+                for (unsigned int p = 0; p < count; p++) {
+                    memcpy(point, &m_xs[p], sizeof(float));
+                    memcpy(point + 4, &m_ys[p], sizeof(float));
+                    point[8] = color[0];
+                    point[9] = color[1];
+                    point[10] = color[2];
+                    point += stride;
+                }
+                segment += curveSegmentSize(segment[0]);
+            }
+        }
+        return true;
+    }
+
+private:
+    static unsigned int scaledCount(unsigned int count, double scale) {
+        const unsigned int scaled = static_cast<unsigned int>(count * scale);
+        return scaled < 1 ? 1 : scaled;
+    }
+
+    float m_tolerance = 0.0005f;
+    unsigned int m_pointBudget = 0;
+    std::vector<unsigned int> m_counts;     // Points of each curve segment of the frame, at the tolerance
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+};
+
+} // namespace Ponk
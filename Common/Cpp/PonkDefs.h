@@ -14,8 +14,9 @@
  *          diodes have a very poor definition in low values anyway)
  *          - Support multiple formats to adapt bandwidth to project requirements
  *      - If the frame to transmit is too long to fit a single UDP packet, it should be cut in multiple
- *        chunks. PONK_MAX_CHUNK_SIZE is set to 8192 by default. This value should make
- *        it work on all popular OS.
+ *        chunks. Chunk size is a sender setting: PONK_MAX_CHUNK_SIZE (1472 bytes) by default, which
+ *        should make it work on all popular OS and networks. Senders can also use the path MTU
+ *        discovered by the OS (unicast), or PONK_JUMBO_CHUNK_SIZE on networks configured for jumbo frames.
  *      - The sender should be able to attach "meta data" to each path transmitted, that the receiver
  *        might handle for specific behaviors. When rasterizing a path for laser rendering
  *        user might give some hints like "should we favor scan speed or render precision ?"
@@ -46,7 +47,7 @@
  *  Implementation in Receiver
  *      - The receiver should handle the fact that multiple senders can be sending packets.
  *      - It should be as reactive as possible to reduce latency and improve synchronization.
- *      - The receiver should accept any packet size (chunk size can be adjusted on sender side)
+ *      - The receiver should accept any packet size up to PONK_MAX_UDP_PAYLOAD_SIZE (chunk size can be adjusted on sender side)
  *      - The receiver should at least support data format "PONK_DATA_FORMAT_XY_F32_RGB_U8"
  *      - If the receiver doesn't handle sender data type, it should notify it in the user interface in some way
  *      - Protocol Version field in the packets shouldn't be ignored: if the specified protocol version is not
@@ -63,10 +64,6 @@
  *        if value should be a floating point, no problem
  *
  *  Possible improvements / extensions:
- *      Synchronization
- *          - If the receiver notify sender that it has used the last received frame, the sender could
- *            adjust to the receiver framerate... (since the sender doesn't know how long it will take
- *            to the laser to travel the path, but receiver might know)
  *      New Data Formats:
  *          - XY_U16_SingleRGB: if you send a path of 2000 points with the same color,
  *                              we could reduce bandwidth a lot by removing color
@@ -86,13 +83,29 @@
  *  Packet Format:
  *      - Header:
  *          - Header String - char[8]: "PONK-UDP"
- *          - Protocol Version - char: 0
+ *          - Protocol Version - char: 0, 1 if flags are used, 2 if the frame has more than 255 chunks,
+ *            3 for the compact header
  *          - Sender Indetifier - 32 bits int
- *          - Sender Name - char[32]
- *          - Frame Number - unsigned char: incremented on each frame
- *          - Chunk Count - unsigned char
- *          - Chunk Number - unsigned char
+ *          - Sender Name - char[32] (not in protocol version 3, sent in announcements)
+ *          - Frame Number - unsigned char: incremented on each frame (unsigned int from protocol version 2)
+ *          - Chunk Count - unsigned char (unsigned short from protocol version 2)
+ *          - Chunk Number - unsigned char (unsigned short from protocol version 2)
  *          - CRC - unsigned int: sum of all data contained in this frame (of all chunks)
+ *          - Flags - unsigned char (protocol version >= 1):
+ *              - PONK_FLAG_COMPRESSED: frame data has been compressed before chunking, each chunk payload
+ *                being an independent block (uncompressed size as unsigned short, then LZ block, see
+ *                PonkCompression.h). CRC is computed on uncompressed data.
+ *              - PONK_FLAG_FEC: parity chunks are sent after the data chunks, chunk numbers from Chunk Count
+ *                to Chunk Count + Parity Chunk Count - 1 (see PonkFec.h)
+ *              - PONK_FLAG_PATH_ALIGNED: chunk boundaries fall on path boundaries, each chunk can be parsed on
+ *                its own. Paths too long for a chunk are split in pieces, pieces after the first one having
+ *                PONK_DATA_FORMAT_CONTINUATION set in their data format (see PonkPathAlignment.h)
+ *              - PONK_FLAG_TIMESTAMP: the frame capture time is sent after the header (see below and PonkClock.h)
+ *          - Parity Chunk Count - unsigned char (unsigned short from protocol version 2), only if PONK_FLAG_FEC is set
+ *          - Timestamp - unsigned 64 bits int, only if PONK_FLAG_TIMESTAMP is set: frame capture time on sender
+ *            clock, in microseconds (any monotonic clock, receivers estimate its offset with clock sync messages)
+ *      - Compact header (protocol version 3): same fields as protocol version 2 without the sender name (26 bytes
+ *        instead of 59). Senders using it must also send announcements.
  *      - Data:
  *          - For each path:
  *              - Data format - unsigned char (PONK_DATA_FORMAT_XY_F32_RGB_U8...)
@@ -104,6 +117,75 @@
  *              - For each point
  *                  - Point data, depending on data format, ie X,Y as float 32, R,G,B as unsigned char
  *
+ *  Announcement Packet Format (sent on the same address and port as frames):
+ *      - Header String - char[8]: "PONK-ANN"
+ *      - Protocol Version - char: 3
+ *      - Sender Identifier - 32 bits int
+ *      - Sender Name - char[32]
+ *      Senders using the compact header send an announcement about once per second and when their name changes.
+ *      Receivers cache the name by sender identifier (see PonkAnnouncement.h), and must ignore bytes following
+ *      the sender name (reserved for future descriptive data).
+ *
+ *  Clock Sync Packet Format (PTP-like offset estimation between receiver and sender clocks, see PonkClock.h):
+ *      - Header String - char[8]: "PONK-SYN"
+ *      - Protocol Version - char: 3
+ *      - Type - unsigned char: 0 for a request (receiver to sender), 1 for a response (sender to receiver)
+ *      - Sender Identifier - 32 bits int: sender the request is for
+ *      - T1 - unsigned 64 bits int: request send time, receiver clock (microseconds)
+ *      - T2 - unsigned 64 bits int: request receive time, sender clock (0 in requests)
+ *      - T3 - unsigned 64 bits int: response send time, sender clock (0 in requests)
+ *      Receivers send requests to the source address and port of frames carrying timestamps, senders answer to the
+ *      source address and port of the request. Offset (sender - receiver) = ((T2 - T1) + (T3 - T4)) / 2, T4 being
+ *      the response receive time on receiver clock.
+ *
+ *  Feedback Packet Format (receiver to sender, see PonkFeedback.h):
+ *      - Header String - char[8]: "PONK-FBK"
+ *      - Protocol Version - char: 3
+ *      - Sender Identifier - 32 bits int: sender the feedback is for
+ *      - Receiver Identifier - 32 bits int: random value, identifies receivers sharing an address
+ *      - Last Consumed Frame Number - unsigned int: last frame of this sender used (shown) by the receiver
+ *      - Queue Depth - unsigned short: frames of this sender due (received, and past their playout time if delayed) but not used yet
+ *      - Output Rate - 32 bits float: frames per second the receiver actually uses (0 if unknown)
+ *      Receivers send feedback a few times per second to the source address and port of the sender frames.
+ *      Senders may lower their send rate to the fastest receiver output rate, and skip frames while queues grow.
+ *
+ *  NACK Packet Format (receiver to sender, selective retransmission, see PonkRetransmit.h):
+ *      - Header String - char[8]: "PONK-NAK"
+ *      - Protocol Version - char: 3
+ *      - Sender Identifier - 32 bits int: sender the request is for
+ *      - Frame Number - unsigned int: frame number as read in the chunk headers (8 bits before protocol version 2)
+ *      - First Chunk - unsigned short: chunk number of the first bit of the bitmap
+ *      - Chunk Range - unsigned short: number of bits in the bitmap
+ *      - Bitmap - (Chunk Range + 7) / 8 bytes: bit i (LSB first) set if chunk First Chunk + i is missing
+ *      Receivers send a NACK to the source address and port of the sender frames when a frame stayed incomplete
+ *      for a short delay. Senders keeping their last frames resend the missing chunks, unchanged, to the source
+ *      address and port of the NACK. Senders not supporting it ignore the message.
+ *
+ *  Data Formats:
+ *      - PONK_DATA_FORMAT_XYRGB_U16: X,Y,R,G,B as unsigned short (10 bytes per point)
+ *      - PONK_DATA_FORMAT_XY_F32_RGB_U8: X,Y as float 32, R,G,B as unsigned char (11 bytes per point)
+ *      - PONK_DATA_FORMAT_XY_DELTA_RGB_RLE: X,Y quantized to 16 bits, zigzag-delta from previous point and
+ *        varint encoded, then colors run-length encoded along the path (see PonkDeltaFormat.h). Typically
+ *        2 bytes per point for dense smooth paths.
+ *      - PONK_DATA_FORMAT_PATH_REFERENCE / PONK_DATA_FORMAT_PATH_DIFF: not actual point formats, these records
+ *        replace a path carrying PATHNUMB meta data by a reference to the frame it was last sent in (or a diff
+ *        against it). The receiver keeps a per-sender path cache to rebuild the full frame, see PonkPathCache.h
+ *      - PONK_DATA_FORMAT_CONTINUATION (0x80) bit: set on the data format of a path piece continuing the previous
+ *        path, only in PONK_FLAG_PATH_ALIGNED frames. Receivers merge pieces back into a single path
+ *      - PONK_DATA_FORMAT_META_DATA_TABLE: not a path, a table of meta data keys with a default value for each,
+ *        used by the following paths having the PONK_DATA_FORMAT_INDEXED_META_DATA (0x40) bit set in their data
+ *        format. Such paths carry key indices and only the values that differ from the default: receivers expand
+ *        them back to regular paths before any other processing, see PonkMetaDataTable.h
+ *      - PONK_DATA_FORMAT_CURVES: a start point followed by line, quadratic / cubic Bezier and circular arc segments
+ *        (the point count field holds the segment count), each with a color. Receivers tessellate them to their
+ *        own precision and point budget, see PonkCurveFormat.h. A 4096 points circle fits in 27 bytes of path data.
+ *      - PONK_DATA_FORMAT_PATH_TEMPLATE / PONK_DATA_FORMAT_PATH_INSTANCES: a template record wraps a path (identified
+ *        by its PATHNUMB meta data) that is not drawn itself, instance records then list copies of it, each as a
+ *        2D affine transform with an optional color and path number. Receivers expand instances into regular paths
+ *        after the path cache (which turns unchanged templates into references), see PonkPathInstancing.h
+ *      - PONK_DATA_FORMAT_XY_F16_RGB_U8: X,Y as half precision float (16 bits), R,G,B as unsigned char (7 bytes per
+ *        point). Precision is 1/2048 or better in [-1,+1], see PonkHalfFormat.h
+ *
  *  List of Meta Data support by:
  *
  *      - MadMapper / MadLaser: most of those parameters can be adjusted at surface level. Adding meta data will override
@@ -140,13 +222,43 @@
 
 // Header String
 #define PONK_HEADER_STRING "PONK-UDP"
-// Protocol Version
-#define PONK_PROTOCOL_VERSION 0
+// Announcement String (sender name and descriptive data, see PonkAnnouncement.h)
+#define PONK_ANNOUNCEMENT_STRING "PONK-ANN"
+// Clock Sync String (clock offset estimation, see PonkClock.h)
+#define PONK_CLOCK_SYNC_STRING "PONK-SYN"
+// Feedback String (receiver to sender, see PonkFeedback.h)
+#define PONK_FEEDBACK_STRING "PONK-FBK"
+// NACK String (receiver to sender, see PonkRetransmit.h)
+#define PONK_NACK_STRING "PONK-NAK"
+// Protocol Version (highest version handled, senders use version 0 when no header flag is needed,
+// version 2 only for frames of more than 255 chunks and version 3 when asked for the compact header)
+#define PONK_PROTOCOL_VERSION 3
+// Header Flags (protocol version >= 1)
+#define PONK_FLAG_COMPRESSED 0x01           // Each chunk payload is an independent compressed block, see PonkCompression.h
+#define PONK_FLAG_FEC 0x02                  // Parity chunks are sent after data chunks, see PonkFec.h
+#define PONK_FLAG_PATH_ALIGNED 0x04         // Chunks hold complete paths and can be parsed alone, see PonkPathAlignment.h
+#define PONK_FLAG_TIMESTAMP 0x08            // Frame capture time is sent after the header, see PonkClock.h
 // Data Formats
 #define PONK_DATA_FORMAT_XYRGB_U16 0
 #define PONK_DATA_FORMAT_XY_F32_RGB_U8 1
-// Maximum chunk size
+#define PONK_DATA_FORMAT_XY_DELTA_RGB_RLE 2  // See PonkDeltaFormat.h
+#define PONK_DATA_FORMAT_PATH_REFERENCE 3    // Path unchanged since a previous frame, see PonkPathCache.h
+#define PONK_DATA_FORMAT_PATH_DIFF 4         // Path changed in a few points since a previous frame, see PonkPathCache.h
+#define PONK_DATA_FORMAT_META_DATA_TABLE 5   // Meta data keys and default values for following paths, see PonkMetaDataTable.h
+#define PONK_DATA_FORMAT_CURVES 6            // Path made of line, Bezier and arc segments, see PonkCurveFormat.h
+#define PONK_DATA_FORMAT_PATH_TEMPLATE 7     // Path drawn by following instance records only, see PonkPathInstancing.h
+#define PONK_DATA_FORMAT_PATH_INSTANCES 8    // Copies of a template path with 2D affine transforms, see PonkPathInstancing.h
+#define PONK_DATA_FORMAT_XY_F16_RGB_U8 9     // X,Y as half float, R,G,B as unsigned char, see PonkHalfFormat.h
+#define PONK_DATA_FORMAT_INDEXED_META_DATA 0x40 // Bit set on data format of a path using the meta data table, see PonkMetaDataTable.h
+#define PONK_DATA_FORMAT_CONTINUATION 0x80   // Bit set on data format of a piece of the previous path, see PonkPathAlignment.h
+// Default chunk size (UDP payload fitting a 1500 bytes Ethernet MTU), senders can change it at runtime
 #define PONK_MAX_CHUNK_SIZE 1472
+// Chunk size for networks configured with 9000 bytes jumbo frames
+#define PONK_JUMBO_CHUNK_SIZE 8972
+// Smallest chunk size senders should use (576 bytes minimum IPv4 datagram every host must accept)
+#define PONK_MIN_CHUNK_SIZE 548
+// Largest UDP payload: receivers should read packets in a buffer of this size
+#define PONK_MAX_UDP_PAYLOAD_SIZE 65507
 // Ponk Multicast address
 #define PONK_MULTICAST_IP ((239<<24) + (255<<16) + (10<<8) + (24<<0))
 // Ponk port = 5583
@@ -175,6 +287,81 @@ struct GeomUdpHeader {
     unsigned int dataCrc;           // CRC of all data in the frame (data from  chunks, to detect network transmission issues)
 } ATTRIBUTE_PACKED;
 
+// Protocol version 1: same as version 0 with flags appended
+struct GeomUdpHeaderV1 {
+    char headerString[8];           // = "PONK-UDP"
+    unsigned char protocolVersion;  // 1
+    unsigned int senderIdentifier;  // 4 bytes - used to identify the source, so when changing name in sender, the receiver can just rename existing stream
+    char senderName[32];            // 32 bytes UTF8 null terminated string
+    unsigned char frameNumber;      // Increase by one on each frame
+    unsigned char chunkCount;       // Number of chunks in this frame
+    unsigned char chunkNumber;      // Number of this chunk
+    unsigned int dataCrc;           // CRC of all data in the frame (uncompressed data from chunks, to detect network transmission issues)
+    unsigned char flags;            // PONK_FLAG_XXX
+} ATTRIBUTE_PACKED;
+
+// Protocol version 2: same as version 1 with larger frame number and chunk indices, for frames of more than 255 chunks
+struct GeomUdpHeaderV2 {
+    char headerString[8];           // = "PONK-UDP"
+    unsigned char protocolVersion;  // 2
+    unsigned int senderIdentifier;  // 4 bytes - used to identify the source, so when changing name in sender, the receiver can just rename existing stream
+    char senderName[32];            // 32 bytes UTF8 null terminated string
+    unsigned int frameNumber;       // Increase by one on each frame
+    unsigned short chunkCount;      // Number of chunks in this frame
+    unsigned short chunkNumber;     // Number of this chunk
+    unsigned int dataCrc;           // CRC of all data in the frame (uncompressed data from chunks, to detect network transmission issues)
+    unsigned char flags;            // PONK_FLAG_XXX
+} ATTRIBUTE_PACKED;
+
+// Protocol version 3: compact header, sender name is sent in GeomUdpAnnouncement packets
+struct GeomUdpHeaderV3 {
+    char headerString[8];           // = "PONK-UDP"
+    unsigned char protocolVersion;  // 3
+    unsigned int senderIdentifier;  // 4 bytes - used to identify the source
+    unsigned int frameNumber;       // Increase by one on each frame
+    unsigned short chunkCount;      // Number of chunks in this frame
+    unsigned short chunkNumber;     // Number of this chunk
+    unsigned int dataCrc;           // CRC of all data in the frame (uncompressed data from chunks, to detect network transmission issues)
+    unsigned char flags;            // PONK_FLAG_XXX
+} ATTRIBUTE_PACKED;
+
+struct GeomUdpAnnouncement {
+    char headerString[8];           // = "PONK-ANN"
+    unsigned char protocolVersion;  // 3
+    unsigned int senderIdentifier;  // 4 bytes - same as in frame headers
+    char senderName[32];            // 32 bytes UTF8 null terminated string
+} ATTRIBUTE_PACKED;
+
+struct GeomUdpClockSync {
+    char headerString[8];           // = "PONK-SYN"
+    unsigned char protocolVersion;  // 3
+    unsigned char type;             // 0 = request, 1 = response
+    unsigned int senderIdentifier;  // Sender the request is for
+    unsigned long long t1;          // Request send time (receiver clock, microseconds)
+    unsigned long long t2;          // Request receive time (sender clock, microseconds)
+    unsigned long long t3;          // Response send time (sender clock, microseconds)
+} ATTRIBUTE_PACKED;
+
+struct GeomUdpFeedback {
+    char headerString[8];                   // = "PONK-FBK"
+    unsigned char protocolVersion;          // 3
+    unsigned int senderIdentifier;          // Sender the feedback is for
+    unsigned int receiverIdentifier;        // Random value identifying the receiver
+    unsigned int lastConsumedFrameNumber;   // Last frame used (shown) by the receiver
+    unsigned short queueDepth;              // Frames due but not used yet (not frames waiting for their playout time)
+    float outputRate;                       // Frames per second used by the receiver, 0 if unknown
+} ATTRIBUTE_PACKED;
+
+// Followed by the missing chunks bitmap, (chunkRange + 7) / 8 bytes
+struct GeomUdpNack {
+    char headerString[8];           // = "PONK-NAK"
+    unsigned char protocolVersion;  // 3
+    unsigned int senderIdentifier;  // Sender the request is for
+    unsigned int frameNumber;       // As read in chunk headers
+    unsigned short firstChunk;      // Chunk number of the first bitmap bit
+    unsigned short chunkRange;      // Number of bits in the bitmap
+} ATTRIBUTE_PACKED;
+
 struct GeomUdpMetaData {
     char name[8];                   // EightCC (64 bits / 8 bytes), ie "POLYNUMB"
     char value[4];                  // 4 bytes for value, must be casted to int / bool / float
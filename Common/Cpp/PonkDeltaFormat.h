@@ -0,0 +1,288 @@
+#pragma once
+
+/*
+ *  PONK_DATA_FORMAT_XY_DELTA_RGB_RLE encoder / decoder
+ *
+ *  Successive points of a laser path are spatially close, so instead of absolute coordinates this
+ *  format sends small deltas:
+ *      - X and Y are quantized to 16 bits ([-1,+1] -> [0,65535], same mapping as PONK_DATA_FORMAT_XYRGB_U16)
+ *      - Each point stores the difference with the previous point (the first point is relative to 0x8000,
+ *        the center of the projection space), as a wrapping 16 bits value
+ *      - Differences are zigzag encoded (0,-1,1,-2,2... -> 0,1,2,3,4...) then varint encoded
+ *        (7 bits per byte, LSB first, high bit set when another byte follows). A delta always fits in 3 bytes.
+ *      - Colors are sent after all XY values as runs: varint run length followed by R,G,B (8 bits each).
+ *        Run lengths sum up to the path point count.
+ *
+ *  Layout after the path point count:
+ *      - For each point: varint(zigzag(dx)), varint(zigzag(dy))
+ *      - For each color run: varint(run length), R, G, B
+ */
+
+#include <vector>
+#include <cstddef>
+
+namespace Ponk {
+
+inline unsigned short quantize16(float v) {
+    float normalized = (v + 1) * 0.5f;
+    normalized = normalized < 0 ? 0 : (normalized > 1 ? 1 : normalized);
+    return static_cast<unsigned short>(normalized * 65535.f + 0.5f);
+}
+
+inline float dequantize16(unsigned int v) {
+    return -1 + 2 * (v / 65535.f);
+}
+
+inline unsigned int zigzag(short v) {
+    return ((static_cast<unsigned int>(v) << 1) ^ static_cast<unsigned int>(v >> 15)) & 0xFFFF;
+}
+
+inline short unzigzag(unsigned int v) {
+    return static_cast<short>((v >> 1) ^ (0u - (v & 1)));
+}
+
+// Quantized point as carried by this format
+struct DeltaPoint {
+    unsigned short x, y;
+    unsigned char r, g, b;
+};
+
+inline void pushVarint(std::vector<unsigned char>& data, unsigned int value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<unsigned char>(value));
+}
+
+// Read a varint of at most 3 bytes, checking buffer bounds. Returns the number of bytes read, 0 on error.
+inline size_t readVarint(const unsigned char* data, size_t size, unsigned int& value) {
+    value = 0;
+    for (size_t i = 0; i < 3 && i < size; i++) {
+        value |= static_cast<unsigned int>(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Branch-free read of a varint of at most 3 bytes. Caller guarantees 3 bytes are readable.
+// Sets 'invalid' if the varint is longer than 3 bytes.
+inline unsigned int readVarintUnchecked(const unsigned char*& p, unsigned int& invalid) {
+    const unsigned int b0 = p[0];
+    const unsigned int b1 = p[1];
+    const unsigned int b2 = p[2];
+    const unsigned int c0 = b0 >> 7;
+    const unsigned int c1 = c0 & (b1 >> 7);
+    invalid |= c1 & (b2 >> 7);
+    p += 1 + c0 + c1;
+    return (b0 & 0x7F) | (((b1 & 0x7F) << 7) & (0u - c0)) | (((b2 & 0x7F) << 14) & (0u - c1));
+}
+
+// Accumulates path points and writes them in PONK_DATA_FORMAT_XY_DELTA_RGB_RLE layout
+// (the caller writes data format, meta data and point count as for other formats)
+class DeltaPathEncoder {
+public:
+    void clear() {
+        m_xy.clear();
+        m_colors.clear();
+        m_pointCount = 0;
+        m_colorBytes = 0;
+        m_prevX = m_prevY = 0x8000;
+    }
+
+    void addPoint(float x, float y, unsigned char r, unsigned char g, unsigned char b) {
+        addQuantizedPoint(quantize16(x), quantize16(y), r, g, b);
+    }
+
+    void addQuantizedPoint(unsigned short qx, unsigned short qy, unsigned char r, unsigned char g, unsigned char b) {
+        pushVarint(m_xy, zigzag(static_cast<short>(qx - m_prevX)));
+        pushVarint(m_xy, zigzag(static_cast<short>(qy - m_prevY)));
+        m_prevX = qx;
+        m_prevY = qy;
+
+        if (m_colors.empty() || m_colors.back().r != r || m_colors.back().g != g || m_colors.back().b != b) {
+            ColorRun run = {0, r, g, b};
+            m_colors.push_back(run);
+            m_colorBytes += 4;
+        }
+        // Run length varint grows by one byte at 128 and 16384
+        const unsigned int length = ++m_colors.back().length;
+        if (length == 0x80 || length == 0x4000) {
+            m_colorBytes++;
+        }
+        m_pointCount++;
+    }
+
+    unsigned int pointCount() const {
+        return m_pointCount;
+    }
+
+    // Size in bytes of what write() will append
+    size_t size() const {
+        return m_xy.size() + m_colorBytes;
+    }
+
+    void write(std::vector<unsigned char>& data) const {
+        data.insert(data.end(), m_xy.begin(), m_xy.end());
+        for (const auto& run: m_colors) {
+            pushVarint(data, run.length);
+            data.push_back(run.r);
+            data.push_back(run.g);
+            data.push_back(run.b);
+        }
+    }
+
+private:
+    struct ColorRun {
+        unsigned int length;
+        unsigned char r, g, b;
+    };
+
+    std::vector<unsigned char> m_xy;
+    std::vector<ColorRun> m_colors;
+    unsigned int m_pointCount = 0;
+    size_t m_colorBytes = 0;
+    unsigned short m_prevX = 0x8000;
+    unsigned short m_prevY = 0x8000;
+};
+
+// Compute the size in bytes of pointCount points encoded in this format without decoding them.
+// Returns false if data is truncated or corrupt.
+inline bool deltaPathSize(const unsigned char* data, size_t size, unsigned int pointCount, size_t& bytes) {
+    size_t offset = 0;
+    unsigned int value;
+    for (unsigned int i = 0; i < 2 * pointCount; i++) {
+        const size_t n = readVarint(data + offset, size - offset, value);
+        if (n == 0) {
+            return false;
+        }
+        offset += n;
+    }
+    unsigned int colored = 0;
+    while (colored < pointCount) {
+        const size_t n = readVarint(data + offset, size - offset, value);
+        if (n == 0 || size - offset < n + 3 || value == 0 || value > pointCount - colored) {
+            return false;
+        }
+        offset += n + 3;
+        colored += value;
+    }
+    bytes = offset;
+    return true;
+}
+
+// Decode pointCount points without dequantizing them (used to split or merge paths without loss).
+// Returns false if data is truncated or corrupt, otherwise bytesRead is set to the number of bytes consumed.
+inline bool decodeDeltaPoints(const unsigned char* data, size_t size, unsigned int pointCount, DeltaPoint* points, size_t& bytesRead) {
+    size_t offset = 0;
+    unsigned int x = 0x8000;
+    unsigned int y = 0x8000;
+    for (unsigned int i = 0; i < pointCount; i++) {
+        unsigned int dx, dy;
+        size_t n = readVarint(data + offset, size - offset, dx);
+        if (n == 0) {
+            return false;
+        }
+        offset += n;
+        n = readVarint(data + offset, size - offset, dy);
+        if (n == 0) {
+            return false;
+        }
+        offset += n;
+        x = (x + static_cast<unsigned int>(unzigzag(dx))) & 0xFFFF;
+        y = (y + static_cast<unsigned int>(unzigzag(dy))) & 0xFFFF;
+        points[i].x = static_cast<unsigned short>(x);
+        points[i].y = static_cast<unsigned short>(y);
+    }
+    unsigned int colored = 0;
+    while (colored < pointCount) {
+        unsigned int runLength;
+        const size_t n = readVarint(data + offset, size - offset, runLength);
+        if (n == 0 || size - offset < n + 3 || runLength == 0 || runLength > pointCount - colored) {
+            return false;
+        }
+        offset += n;
+        for (unsigned int j = colored; j < colored + runLength; j++) {
+            points[j].r = data[offset];
+            points[j].g = data[offset + 1];
+            points[j].b = data[offset + 2];
+        }
+        offset += 3;
+        colored += runLength;
+    }
+    bytesRead = offset;
+    return true;
+}
+
+// Decode pointCount points into 'points' (pointer to any type with float x,y,r,g,b members, or PointArrays),
+// colors in [0,1]. Returns false if data is truncated or corrupt, otherwise bytesRead is set to the number of bytes
+// consumed.
+template <class Points>
+bool decodeDeltaPath(const unsigned char* data, size_t size, unsigned int pointCount, Points points, size_t& bytesRead) {
+    const unsigned char* p = data;
+    const unsigned char* const end = data + size;
+    unsigned int x = 0x8000;
+    unsigned int y = 0x8000;
+    unsigned int invalid = 0;
+    unsigned int i = 0;
+
+    // Fast path: while at least two maximum length varints can be read, decode without bound checks
+    for (; i < pointCount && end - p >= 6; i++) {
+        const unsigned int dx = readVarintUnchecked(p, invalid);
+        const unsigned int dy = readVarintUnchecked(p, invalid);
+        x = (x + static_cast<unsigned int>(unzigzag(dx))) & 0xFFFF;
+        y = (y + static_cast<unsigned int>(unzigzag(dy))) & 0xFFFF;
+        points[i].x = dequantize16(x);
+        points[i].y = dequantize16(y);
+    }
+    if (invalid) {
+        return false;
+    }
+
+    // Tail: checked reads
+    for (; i < pointCount; i++) {
+        unsigned int dx, dy;
+        size_t n = readVarint(p, end - p, dx);
+        if (n == 0) {
+            return false;
+        }
+        p += n;
+        n = readVarint(p, end - p, dy);
+        if (n == 0) {
+            return false;
+        }
+        p += n;
+        x = (x + static_cast<unsigned int>(unzigzag(dx))) & 0xFFFF;
+        y = (y + static_cast<unsigned int>(unzigzag(dy))) & 0xFFFF;
+        points[i].x = dequantize16(x);
+        points[i].y = dequantize16(y);
+    }
+
+    // Color runs
+    unsigned int colored = 0;
+    while (colored < pointCount) {
+        unsigned int runLength;
+        const size_t n = readVarint(p, end - p, runLength);
+        if (n == 0 || static_cast<size_t>(end - p) < n + 3 || runLength == 0 || runLength > pointCount - colored) {
+            return false;
+        }
+        p += n;
+        const float r = p[0] / 255.f;
+        const float g = p[1] / 255.f;
+        const float b = p[2] / 255.f;
+        p += 3;
+        for (unsigned int j = colored; j < colored + runLength; j++) {
+            points[j].r = r;
+            points[j].g = g;
+            points[j].b = b;
+        }
+        colored += runLength;
+    }
+
+    bytesRead = static_cast<size_t>(p - data);
+    return true;
+}
+
+} // namespace Ponk
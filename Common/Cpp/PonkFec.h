@@ -0,0 +1,156 @@
+#pragma once
+
+/*
+ *  Forward error correction for PONK_FLAG_FEC frames
+ *
+ *  The sender appends P parity chunks after the N data chunks of a frame. Chunk Count in the header is
+ *  still N (data chunks), parity chunks have chunk numbers N to N+P-1 and the header carries P.
+ *
+ *  Parity chunks are interleaved XOR: parity chunk p is the XOR of data chunks i with i % P == p, each
+ *  data chunk being seen as its payload size (unsigned short) followed by its payload, zero padded to
+ *  the longest chunk of the group. A parity chunk payload is then 2 + longest payload size of its group.
+ *
+ *  The receiver can rebuild one missing data chunk per group: up to P lost chunks per frame, including any
+ *  burst of P consecutive lost chunks, which is the usual loss pattern on Wi-Fi.
+ *  Parity is computed on chunk payloads as sent (so on compressed blocks if PONK_FLAG_COMPRESSED is set).
+ */
+
+#include <vector>
+#include <cstddef>
+
+namespace Ponk {
+
+// Number of parity chunks for a frame of dataChunkCount chunks: at least one if ratio > 0,
+// never more than one per data chunk
+inline unsigned int fecParityChunkCount(unsigned int dataChunkCount, float ratio) {
+    if (ratio <= 0 || dataChunkCount == 0) {
+        return 0;
+    }
+    unsigned int count = static_cast<unsigned int>(dataChunkCount * ratio + 0.999f);
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > dataChunkCount) {
+        count = dataChunkCount;
+    }
+    return count;
+}
+
+// XOR payload size + payload into buffer at offset, growing buffer (with zeros) if needed
+inline void fecAccumulate(std::vector<unsigned char>& buffer, size_t offset, const unsigned char* payload, size_t size) {
+    if (buffer.size() < offset + 2 + size) {
+        buffer.resize(offset + 2 + size, 0);
+    }
+    unsigned char* p = &buffer[offset];
+    p[0] ^= static_cast<unsigned char>(size & 0xFF);
+    p[1] ^= static_cast<unsigned char>((size >> 8) & 0xFF);
+    p += 2;
+    for (size_t i = 0; i < size; i++) {
+        p[i] ^= payload[i];
+    }
+}
+
+// Receiver side: accumulates received chunks of a frame per parity group and rebuilds missing data chunks
+class FecDecoder {
+public:
+    void reset(unsigned int dataChunkCount, unsigned int parityChunkCount) {
+        m_dataChunkCount = dataChunkCount;
+        m_parityChunkCount = parityChunkCount;
+        m_received.assign(dataChunkCount, false);
+        if (m_groups.size() < parityChunkCount) {
+            m_groups.resize(parityChunkCount);
+        }
+        for (unsigned int g = 0; g < parityChunkCount; g++) {
+            m_groups[g].accumulator.clear();
+            m_groups[g].receivedDataCount = 0;
+            m_groups[g].hasParity = false;
+        }
+    }
+
+    bool enabled() const {
+        return m_parityChunkCount > 0;
+    }
+
+    // Add a received chunk (data or parity). Returns false if the chunk number is out of range or the
+    // chunk was already added.
+    bool addChunk(unsigned int chunkNumber, const unsigned char* payload, size_t size) {
+        if (!enabled() || chunkNumber >= m_dataChunkCount + m_parityChunkCount) {
+            return false;
+        }
+        Group& group = m_groups[groupOf(chunkNumber)];
+        if (chunkNumber < m_dataChunkCount) {
+            if (m_received[chunkNumber]) {
+                return false;
+            }
+            m_received[chunkNumber] = true;
+            group.receivedDataCount++;
+            fecAccumulate(group.accumulator, 0, payload, size);
+        } else {
+            if (group.hasParity) {
+                return false;
+            }
+            group.hasParity = true;
+            // Parity payload already contains the size prefix, XOR it as is
+            if (group.accumulator.size() < size) {
+                group.accumulator.resize(size, 0);
+            }
+            for (size_t i = 0; i < size; i++) {
+                group.accumulator[i] ^= payload[i];
+            }
+        }
+        return true;
+    }
+
+    // If the group of chunkNumber misses exactly one data chunk and its parity chunk has been received,
+    // rebuild the missing chunk payload. The rebuilt chunk is then considered as received.
+    bool recoverChunk(unsigned int chunkNumber, unsigned int& recoveredChunkNumber, std::vector<unsigned char>& payload) {
+        if (!enabled() || chunkNumber >= m_dataChunkCount + m_parityChunkCount) {
+            return false;
+        }
+        const unsigned int g = groupOf(chunkNumber);
+        Group& group = m_groups[g];
+        const unsigned int groupDataCount = (m_dataChunkCount - g + m_parityChunkCount - 1) / m_parityChunkCount;
+        if (!group.hasParity || group.receivedDataCount + 1 != groupDataCount) {
+            return false;
+        }
+
+        recoveredChunkNumber = m_dataChunkCount;
+        for (unsigned int i = g; i < m_dataChunkCount; i += m_parityChunkCount) {
+            if (!m_received[i]) {
+                recoveredChunkNumber = i;
+                break;
+            }
+        }
+        if (recoveredChunkNumber >= m_dataChunkCount || group.accumulator.size() < 2) {
+            return false;
+        }
+
+        // Accumulator now holds size + payload of the missing chunk
+        const size_t size = group.accumulator[0] | (group.accumulator[1] << 8);
+        if (size > group.accumulator.size() - 2) {
+            return false;
+        }
+        payload.assign(group.accumulator.begin() + 2, group.accumulator.begin() + 2 + size);
+        m_received[recoveredChunkNumber] = true;
+        group.receivedDataCount++;
+        return true;
+    }
+
+private:
+    unsigned int groupOf(unsigned int chunkNumber) const {
+        return chunkNumber < m_dataChunkCount ? chunkNumber % m_parityChunkCount : chunkNumber - m_dataChunkCount;
+    }
+
+    struct Group {
+        std::vector<unsigned char> accumulator;
+        unsigned int receivedDataCount = 0;
+        bool hasParity = false;
+    };
+
+    unsigned int m_dataChunkCount = 0;
+    unsigned int m_parityChunkCount = 0;
+    std::vector<bool> m_received;
+    std::vector<Group> m_groups;
+};
+
+} // namespace Ponk
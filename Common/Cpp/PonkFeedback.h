@@ -0,0 +1,174 @@
+#pragma once
+
+/*
+ *  Receiver to sender feedback ("PONK-FBK" messages)
+ *
+ *  Receivers regularly tell each sender which frame they last used (shown / rendered), how many frames are
+ *  waiting in their queue and at which rate they actually output frames. The message is sent in unicast to
+ *  the source address of the sender frames (the address recvFrom reports), so it reaches the sending socket.
+ *
+ *  Senders read feedback when polling their socket and can adapt their send rate: SendRateController
+ *  skips frames to match the fastest receiver output rate heard recently, and while receiver queues grow.
+ *  Without feedback (receivers not supporting it), all frames are sent.
+ *
+ *  Sender usage:
+ *      while (socket.recvFrom(addr, buffer, size) && size > 0) {
+ *          rateController.readFeedback(buffer, size, senderIdentifier);
+ *      }
+ *      if (rateController.shouldSendFrame()) { ... send frame ... }
+ */
+
+#include "PonkDefs.h"
+#include <map>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+namespace Ponk {
+
+// Returns false if the buffer is not a feedback message
+inline bool readFeedback(const unsigned char* buffer, size_t size, GeomUdpFeedback& message) {
+    if (size < sizeof(GeomUdpFeedback) || strncmp(reinterpret_cast<const char*>(buffer), PONK_FEEDBACK_STRING, 8) != 0) {
+        return false;
+    }
+    memcpy(&message, buffer, sizeof(message));
+    return true;
+}
+
+inline void writeFeedback(unsigned int senderIdentifier, unsigned int receiverIdentifier, unsigned int lastConsumedFrameNumber,
+                          unsigned int queueDepth, float outputRate, std::vector<unsigned char>& packet) {
+    GeomUdpFeedback message;
+    memcpy(message.headerString, PONK_FEEDBACK_STRING, sizeof(message.headerString));
+    message.protocolVersion = 3;
+    message.senderIdentifier = senderIdentifier;
+    message.receiverIdentifier = receiverIdentifier;
+    message.lastConsumedFrameNumber = lastConsumedFrameNumber;
+    message.queueDepth = static_cast<unsigned short>(queueDepth > 0xFFFF ? 0xFFFF : queueDepth);
+    message.outputRate = outputRate;
+    packet.resize(sizeof(message));
+    memcpy(packet.data(), &message, sizeof(message));
+}
+
+// Receiver side: measures the output rate (frames used per second) with an exponential moving average
+class OutputRateMeter {
+public:
+    void frameConsumed() {
+        const auto now = std::chrono::steady_clock::now();
+        if (m_hasLastTime) {
+            const float interval = std::chrono::duration<float>(now - m_lastTime).count();
+            if (interval > 0 && interval < 1) {
+                m_averageInterval = m_averageInterval <= 0 ? interval : m_averageInterval * 0.9f + interval * 0.1f;
+            }
+        }
+        m_lastTime = now;
+        m_hasLastTime = true;
+    }
+
+    // Frames per second, 0 if unknown
+    float rate() const {
+        return m_averageInterval > 0 ? 1.f / m_averageInterval : 0.f;
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_lastTime;
+    bool m_hasLastTime = false;
+    float m_averageInterval = 0;
+};
+
+// Sender side: send rate adaptation from receivers feedback
+class SendRateController {
+public:
+    // Feedback older than this is forgotten (receiver gone)
+    void setTimeout(std::chrono::milliseconds timeout) {
+        m_timeout = timeout;
+    }
+
+    // Returns true if the buffer was a feedback message for this sender
+    bool readFeedback(const unsigned char* buffer, size_t size, unsigned int senderIdentifier) {
+        GeomUdpFeedback message;
+        if (!Ponk::readFeedback(buffer, size, message) || message.senderIdentifier != senderIdentifier) {
+            return false;
+        }
+        Receiver& receiver = m_receivers[message.receiverIdentifier];
+        receiver.lastConsumedFrameNumber = message.lastConsumedFrameNumber;
+        receiver.queueDepth = message.queueDepth;
+        receiver.outputRate = message.outputRate;
+        receiver.time = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    // Fastest output rate of receivers heard recently, 0 if no feedback (no adaptation)
+    float targetRate() {
+        removeExpiredReceivers();
+        float rate = 0;
+        for (const auto& kv: m_receivers) {
+            if (kv.second.outputRate > rate) {
+                rate = kv.second.outputRate;
+            }
+        }
+        return rate;
+    }
+
+    // Number of receivers heard recently
+    size_t receiverCount() {
+        removeExpiredReceivers();
+        return m_receivers.size();
+    }
+
+    // Call once per frame the sender could send: returns false if the frame should be skipped
+    // because receivers would not use it
+    bool shouldSendFrame() {
+        const float rate = targetRate();
+        const auto now = std::chrono::steady_clock::now();
+        if (rate <= 0) {
+            m_nextSendTime = now;
+            return true;
+        }
+
+        // Receivers are late (frames pile up in all queues): skip until one of them catches up
+        unsigned int minQueueDepth = 0xFFFF;
+        for (const auto& kv: m_receivers) {
+            if (kv.second.queueDepth < minQueueDepth) {
+                minQueueDepth = kv.second.queueDepth;
+            }
+        }
+        if (minQueueDepth > 2) {
+            return false;
+        }
+
+        if (now < m_nextSendTime) {
+            return false;
+        }
+        // Schedule next frame one period later, without trying to catch up on skipped periods.
+        // 10% margin so we don't skip a frame because of sender frame time jitter.
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<float>(0.9f / rate));
+        m_nextSendTime = (now - m_nextSendTime > period) ? now + period : m_nextSendTime + period;
+        return true;
+    }
+
+private:
+    void removeExpiredReceivers() {
+        const auto now = std::chrono::steady_clock::now();
+        for (auto it = m_receivers.begin(); it != m_receivers.end();) {
+            if (now - it->second.time > m_timeout) {
+                it = m_receivers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    struct Receiver {
+        unsigned int lastConsumedFrameNumber = 0;
+        unsigned int queueDepth = 0;
+        float outputRate = 0;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    std::map<unsigned int, Receiver> m_receivers;
+    std::chrono::milliseconds m_timeout = std::chrono::milliseconds(3000);
+    std::chrono::steady_clock::time_point m_nextSendTime;
+};
+
+} // namespace Ponk
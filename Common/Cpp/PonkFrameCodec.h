@@ -0,0 +1,434 @@
+#pragma once
+
+/*
+ *  In place frame reading, and path writing
+ *
+ *  FrameView walks the paths of a reassembled frame without copying or allocating: each PathView gives the data
+ *  format, meta data and point count of a path, and reads its points where they are in the frame. Consumers that
+ *  only need path counts, meta data or bounds don't decode points at all. Only point formats are read
+ *  (PONK_DATA_FORMAT_XYRGB_U16, PONK_DATA_FORMAT_XY_F32_RGB_U8, PONK_DATA_FORMAT_XY_DELTA_RGB_RLE,
+ *  PONK_DATA_FORMAT_XY_F16_RGB_U8): receivers expand other records first (see PonkPathCache.h, PonkMetaDataTable.h,
+ *  PonkPathInstancing.h and PonkCurveTessellation.h).
+ *
+ *  Receiver usage:
+ *      Ponk::FrameView frame(data, size);
+ *      Ponk::PathView path;
+ *      while (frame.next(path)) {
+ *          float pathNumber;
+ *          if (path.findMetaData("PATHNUMB", pathNumber)) ...
+ *          path.decodePoints(points);                      // any point format, to points or framePoints.addPath(n)
+ *          path.point(i).x() ...                           // or in place, fixed size formats only (pointStride() != 0)
+ *      }
+ *      if (frame.error()) ...                              // stopped on a truncated or unsupported path
+ *
+ *  Sender usage (X,Y in [-1,+1], colors in [0,1], whatever the data format):
+ *      writer.beginPath(fullData, PONK_DATA_FORMAT_XY_F32_RGB_U8);
+ *      writer.addMetaData("PATHNUMB", 1.f);
+ *      writer.addPoint(x, y, r, g, b);
+ *      writer.endPath();
+ */
+
+#include "PonkDefs.h"
+#include "PonkDeltaFormat.h"
+#include "PonkHalfFormat.h"
+#include "PonkPointFormats.h"
+#include "PonkFramePoints.h"
+#include "PonkPathCache.h"
+#include <vector>
+#include <cstring>
+
+namespace Ponk {
+
+// Returns true for data formats made of points, that FrameView reads and PathWriter writes
+inline bool isPointFormat(unsigned char dataFormat) {
+    return fixedPointStride(dataFormat) != 0 || dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE;
+}
+
+// Copy a meta data key of at most 8 chars, padded with zeros as sent
+inline void padMetaDataKey(const char* key, char (&paddedKey)[8]) {
+    size_t i = 0;
+    for (; i < 8 && key[i] != '\0'; i++) {
+        paddedKey[i] = key[i];
+    }
+    for (; i < 8; i++) {
+        paddedKey[i] = '\0';
+    }
+}
+
+inline float readFloat32(const unsigned char* p) {
+    float value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// A point of a fixed size point format, read in place
+class PointView {
+public:
+    PointView(const unsigned char* data, unsigned char dataFormat)
+        : m_data(data)
+        , m_dataFormat(dataFormat) {
+    }
+
+    float x() const {
+        return position(0);
+    }
+
+    float y() const {
+        return position(1);
+    }
+
+    // Colors in [0,1]
+    float r() const {
+        return color(0);
+    }
+
+    float g() const {
+        return color(1);
+    }
+
+    float b() const {
+        return color(2);
+    }
+
+private:
+    template <class Format>
+    float position(int i) const {
+        return Format::decodePosition(m_data + (i == 0 ? Format::kXOffset : Format::kYOffset));
+    }
+
+    template <class Format>
+    float color(int i) const {
+        return Format::decodeColor(m_data + Format::kColorOffset + i * Format::kColorSize);
+    }
+
+    float position(int i) const {
+        switch (m_dataFormat) {
+        case PONK_DATA_FORMAT_XY_F32_RGB_U8: return position<PointFormat<PONK_DATA_FORMAT_XY_F32_RGB_U8> >(i);
+        case PONK_DATA_FORMAT_XY_F16_RGB_U8: return position<PointFormat<PONK_DATA_FORMAT_XY_F16_RGB_U8> >(i);
+        default: return position<PointFormat<PONK_DATA_FORMAT_XYRGB_U16> >(i);
+        }
+    }
+
+    float color(int i) const {
+        switch (m_dataFormat) {
+        case PONK_DATA_FORMAT_XY_F32_RGB_U8: return color<PointFormat<PONK_DATA_FORMAT_XY_F32_RGB_U8> >(i);
+        case PONK_DATA_FORMAT_XY_F16_RGB_U8: return color<PointFormat<PONK_DATA_FORMAT_XY_F16_RGB_U8> >(i);
+        default: return color<PointFormat<PONK_DATA_FORMAT_XYRGB_U16> >(i);
+        }
+    }
+
+    const unsigned char* m_data;
+    unsigned char m_dataFormat;
+};
+
+// A path of a frame, read in place (valid as long as the frame data is)
+class PathView {
+public:
+    unsigned char dataFormat() const {
+        return m_record.dataFormat;
+    }
+
+    unsigned int metaDataCount() const {
+        return m_data[1];
+    }
+
+    // 8 chars, padded with zeros and not null terminated when 8 chars long
+    const char* metaDataKey(unsigned int i) const {
+        return reinterpret_cast<const char*>(m_data + 2 + 12 * i);
+    }
+
+    // Key length without padding zeros
+    unsigned int metaDataKeyLength(unsigned int i) const {
+        const char* key = metaDataKey(i);
+        unsigned int length = 8;
+        while (length > 0 && key[length - 1] == '\0') {
+            length--;
+        }
+        return length;
+    }
+
+    float metaDataValue(unsigned int i) const {
+        return readFloat32(m_data + 2 + 12 * i + 8);
+    }
+
+    // Returns false if the path doesn't have this meta data (key of at most 8 chars, ie "PATHNUMB")
+    bool findMetaData(const char* key, float& value) const {
+        char paddedKey[8];
+        padMetaDataKey(key, paddedKey);
+        for (unsigned int i = 0; i < metaDataCount(); i++) {
+            if (memcmp(metaDataKey(i), paddedKey, 8) == 0) {
+                value = metaDataValue(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned int pointCount() const {
+        return m_record.pointCount;
+    }
+
+    // Bytes between two points, 0 for variable size point formats
+    unsigned int pointStride() const {
+        return fixedPointStride(m_record.dataFormat);
+    }
+
+    const unsigned char* pointData() const {
+        return m_data + m_record.pointsOffset;
+    }
+
+    size_t pointDataSize() const {
+        return m_record.size - m_record.pointsOffset;
+    }
+
+    // Fixed size point formats only
+    PointView point(unsigned int i) const {
+        return PointView(pointData() + static_cast<size_t>(i) * pointStride(), m_record.dataFormat);
+    }
+
+    // Whole path record
+    const unsigned char* data() const {
+        return m_data;
+    }
+
+    size_t size() const {
+        return m_record.size;
+    }
+
+    // Smallest box containing the path points, without decoding colors. Returns false for paths without points.
+    bool bounds(float& minX, float& minY, float& maxX, float& maxY) const {
+        if (pointCount() == 0) {
+            return false;
+        }
+        if (m_record.dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE) {
+            // Positions come first, compare quantized values
+            const unsigned char* p = pointData();
+            const unsigned char* const end = p + pointDataSize();
+            unsigned int x = 0x8000, y = 0x8000;
+            unsigned int qMinX = 0xFFFF, qMinY = 0xFFFF, qMaxX = 0, qMaxY = 0;
+            for (unsigned int i = 0; i < pointCount(); i++) {
+                unsigned int dx, dy;
+                p += readVarint(p, end - p, dx);
+                p += readVarint(p, end - p, dy);
+                x = (x + static_cast<unsigned int>(unzigzag(dx))) & 0xFFFF;
+                y = (y + static_cast<unsigned int>(unzigzag(dy))) & 0xFFFF;
+                qMinX = x < qMinX ? x : qMinX;
+                qMinY = y < qMinY ? y : qMinY;
+                qMaxX = x > qMaxX ? x : qMaxX;
+                qMaxY = y > qMaxY ? y : qMaxY;
+            }
+            minX = dequantize16(qMinX);
+            minY = dequantize16(qMinY);
+            maxX = dequantize16(qMaxX);
+            maxY = dequantize16(qMaxY);
+            return true;
+        }
+        minX = maxX = point(0).x();
+        minY = maxY = point(0).y();
+        for (unsigned int i = 1; i < pointCount(); i++) {
+            const PointView p = point(i);
+            const float x = p.x();
+            const float y = p.y();
+            minX = x < minX ? x : minX;
+            minY = y < minY ? y : minY;
+            maxX = x > maxX ? x : maxX;
+            maxY = y > maxY ? y : maxY;
+        }
+        return true;
+    }
+
+    // Decode all points into 'points' (pointer to any type with float x,y,r,g,b members, or PointArrays such as
+    // FramePoints::addPath() returns), pointCount() of them, colors in [0,1]
+    template <class Points>
+    bool decodePoints(Points points) const {
+        if (m_record.dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE) {
+            size_t bytesRead = 0;
+            return decodeDeltaPath(pointData(), pointDataSize(), pointCount(), points, bytesRead);
+        }
+        DecodeVisitor<Points> visitor = { pointData(), pointCount(), points };
+        return dispatchPointFormat(m_record.dataFormat, visitor);
+    }
+
+private:
+    friend class FrameView;
+
+    template <class Points>
+    struct DecodeVisitor {
+        template <class Format>
+        void visit() {
+            PointKernels<Format>::decode(data, count, points);
+        }
+
+        const unsigned char* data;
+        unsigned int count;
+        Points points;
+    };
+
+    const unsigned char* m_data = nullptr;
+    PathRecord m_record;
+};
+
+// Paths of a frame, read in place (data must outlive the views)
+class FrameView {
+public:
+    FrameView(const unsigned char* data, size_t size)
+        : m_data(data)
+        , m_size(size) {
+    }
+
+    // Returns false at the end of the frame, or on a path that can't be read (see error())
+    bool next(PathView& path) {
+        if (m_offset >= m_size || m_error) {
+            return false;
+        }
+        if (!readPathRecord(m_data + m_offset, m_size - m_offset, path.m_record) || path.m_record.indexedMetaData
+            || !isPointFormat(path.m_record.dataFormat)) {
+            m_error = true;
+            return false;
+        }
+        path.m_data = m_data + m_offset;
+        m_offset += path.m_record.size;
+        return true;
+    }
+
+    // True if next() stopped before the end of the frame (truncated data, unsupported data format)
+    bool error() const {
+        return m_error;
+    }
+
+    void rewind() {
+        m_offset = 0;
+        m_error = false;
+    }
+
+    // Paths that can be read, without moving this view
+    unsigned int pathCount() const {
+        FrameView frame(m_data, m_size);
+        PathView path;
+        unsigned int count = 0;
+        while (frame.next(path)) {
+            count++;
+        }
+        return count;
+    }
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_error = false;
+};
+
+// Writes paths of any point format from float values. Keeps its buffers between paths: reuse the same writer.
+class PathWriter {
+public:
+    void beginPath(std::vector<unsigned char>& data, unsigned char dataFormat) {
+        m_data = &data;
+        m_dataFormat = dataFormat;
+        m_pointCount = 0;
+        m_countOffset = 0;
+        m_deltaEncoder.clear();
+        m_halfEncoder.clear();
+        // Fixed size formats are encoded as points come (half floats are converted by blocks, when the path ends)
+        EncodeVisitor visitor = { nullptr, 0 };
+        if (dataFormat != PONK_DATA_FORMAT_XY_F16_RGB_U8) {
+            dispatchPointFormat(dataFormat, visitor);
+        }
+        m_encodePoint = visitor.encodePoint;
+        m_stride = visitor.stride;
+        data.push_back(dataFormat);
+        m_metaCountOffset = data.size();
+        data.push_back(0);
+    }
+
+    // Before the first point. Key of at most 8 chars, at most 255 meta data per path.
+    void addMetaData(const char* key, float value) {
+        std::vector<unsigned char>& data = *m_data;
+        if (m_countOffset != 0 || data[m_metaCountOffset] == 0xFF) {
+            return;
+        }
+        char paddedKey[8];
+        padMetaDataKey(key, paddedKey);
+        data.insert(data.end(), paddedKey, paddedKey + 8);
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        pushU32(data, bits);
+        data[m_metaCountOffset]++;
+    }
+
+    // X,Y in [-1,+1], colors in [0,1]. Points after the 65535th are dropped.
+    void addPoint(float x, float y, float r, float g, float b) {
+        if (m_countOffset == 0) {
+            beginPoints();
+        }
+        if (m_pointCount == 0xFFFF) {
+            return;
+        }
+        m_pointCount++;
+        if (m_encodePoint) {
+            std::vector<unsigned char>& data = *m_data;
+            const size_t offset = data.size();
+            data.resize(offset + m_stride);
+            m_encodePoint(x, y, r, g, b, &data[offset]);
+        } else if (m_dataFormat == PONK_DATA_FORMAT_XY_F16_RGB_U8) {
+            m_halfEncoder.addPoint(x, y, colorToU8(r), colorToU8(g), colorToU8(b));
+        } else {
+            m_deltaEncoder.addPoint(x, y, colorToU8(r), colorToU8(g), colorToU8(b));
+        }
+    }
+
+    void endPath() {
+        if (m_countOffset == 0) {
+            beginPoints();
+        }
+        std::vector<unsigned char>& data = *m_data;
+        data[m_countOffset] = static_cast<unsigned char>(m_pointCount & 0xFF);
+        data[m_countOffset + 1] = static_cast<unsigned char>(m_pointCount >> 8);
+        if (m_dataFormat == PONK_DATA_FORMAT_XY_F16_RGB_U8) {
+            m_halfEncoder.write(data);
+        } else if (m_dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE) {
+            m_deltaEncoder.write(data);
+        }
+    }
+
+private:
+    typedef void (*EncodePoint)(float x, float y, float r, float g, float b, unsigned char* p);
+
+    struct EncodeVisitor {
+        template <class Format>
+        void visit() {
+            encodePoint = &PointKernels<Format>::encode;
+            stride = Format::kStride;
+        }
+
+        EncodePoint encodePoint;
+        unsigned int stride;
+    };
+
+    static unsigned char colorToU8(float c) {
+        return static_cast<unsigned char>((c < 0 ? 0 : (c > 1 ? 1 : c)) * 255.f + 0.5f);
+    }
+
+    static void push16(std::vector<unsigned char>& data, unsigned short value) {
+        data.push_back(static_cast<unsigned char>(value & 0xFF));
+        data.push_back(static_cast<unsigned char>(value >> 8));
+    }
+
+    // Point count placeholder, written by endPath
+    void beginPoints() {
+        m_countOffset = m_data->size();
+        push16(*m_data, 0);
+    }
+
+    std::vector<unsigned char>* m_data = nullptr;
+    unsigned char m_dataFormat = PONK_DATA_FORMAT_XY_F32_RGB_U8;
+    size_t m_metaCountOffset = 0;
+    size_t m_countOffset = 0;   // 0 until points start (offset 0 is always the data format)
+    unsigned int m_pointCount = 0;
+    EncodePoint m_encodePoint = nullptr;   // Fixed size formats encoded point by point
+    unsigned int m_stride = 0;
+    DeltaPathEncoder m_deltaEncoder;
+    HalfPathEncoder m_halfEncoder;
+};
+
+} // namespace Ponk
@@ -0,0 +1,164 @@
+#pragma once
+
+/*
+ *  Structure of arrays point storage
+ *
+ *  FramePoints keeps the points of a whole frame in one array per component (X, Y, R, G, B) and paths as ranges of
+ *  points, instead of a vector of points per path: a frame costs no allocation once its arrays are big enough, and
+ *  consumers transform or copy each component with contiguous loops. Point decoders (PathView::decodePoints, delta,
+ *  half float and fixed size format kernels) write straight into it through PointArrays, which is indexed like an
+ *  array of points: points[i].x = ... XY_F32_RGB_U8 and XYRGB_U16 points are decoded by SIMD kernels
+ *  (PonkSimdDecode.h).
+ *
+ *  Usage:
+ *      framePoints.clear();
+ *      while (frame.next(path)) {
+ *          if (!path.decodePoints(framePoints.addPath(path.pointCount()))) {
+ *              framePoints.removeLastPath();
+ *              break;
+ *          }
+ *      }
+ *      for (unsigned int i = 0; i < framePoints.pathCount(); i++) {
+ *          const unsigned int first = framePoints.pathFirstPoint(i);
+ *          ... framePoints.x()[first], ... framePoints.pathPointCount(i) points
+ *      }
+ */
+
+#include "PonkDefs.h"
+#include "PonkPointFormats.h"
+#include "PonkSimdDecode.h"
+#include <vector>
+#include <cstddef>
+
+namespace Ponk {
+
+// One point of PointArrays, so decoders written for arrays of points work unchanged
+struct PointArraysRef {
+    float& x;
+    float& y;
+    float& r;
+    float& g;
+    float& b;
+};
+
+// Destination of decoded points: X, Y in [-1,+1] and colors in [0,1], each component in its own array
+struct PointArrays {
+    float* x;
+    float* y;
+    float* r;
+    float* g;
+    float* b;
+
+    PointArraysRef operator[](size_t i) const {
+        PointArraysRef point = { x[i], y[i], r[i], g[i], b[i] };
+        return point;
+    }
+};
+
+// Fixed size formats with SIMD kernels decode all components of a path at once
+template <>
+template <>
+inline void PointKernels<PointFormat<PONK_DATA_FORMAT_XY_F32_RGB_U8> >::decode<PointArrays>(const unsigned char* data,
+                                                                                          unsigned int count,
+                                                                                          PointArrays points) {
+    decodeF32Points(data, count, points.x, points.y, points.r, points.g, points.b);
+}
+
+template <>
+template <>
+inline void PointKernels<PointFormat<PONK_DATA_FORMAT_XYRGB_U16> >::decode<PointArrays>(const unsigned char* data,
+                                                                                      unsigned int count,
+                                                                                      PointArrays points) {
+    decodeU16Points(data, count, points.x, points.y, points.r, points.g, points.b);
+}
+
+class FramePoints {
+public:
+    // Drop all paths (arrays keep their capacity)
+    void clear() {
+        m_x.clear();
+        m_y.clear();
+        m_r.clear();
+        m_g.clear();
+        m_b.clear();
+        m_pathOffsets.assign(1, 0);
+    }
+
+    // Make room for a path of pointCount points, and return where to write them
+    PointArrays addPath(unsigned int pointCount) {
+        if (m_pathOffsets.empty()) {
+            m_pathOffsets.push_back(0);
+        }
+        const size_t first = m_x.size();
+        const size_t size = first + pointCount;
+        m_x.resize(size);
+        m_y.resize(size);
+        m_r.resize(size);
+        m_g.resize(size);
+        m_b.resize(size);
+        m_pathOffsets.push_back(static_cast<unsigned int>(size));
+        PointArrays points = { m_x.data() + first, m_y.data() + first, m_r.data() + first, m_g.data() + first,
+                               m_b.data() + first };
+        return points;
+    }
+
+    // Remove the last path added (its points could not be decoded)
+    void removeLastPath() {
+        if (pathCount() == 0) {
+            return;
+        }
+        m_pathOffsets.pop_back();
+        const size_t size = m_pathOffsets.back();
+        m_x.resize(size);
+        m_y.resize(size);
+        m_r.resize(size);
+        m_g.resize(size);
+        m_b.resize(size);
+    }
+
+    unsigned int pathCount() const {
+        return m_pathOffsets.empty() ? 0 : static_cast<unsigned int>(m_pathOffsets.size() - 1);
+    }
+
+    unsigned int pointCount() const {
+        return static_cast<unsigned int>(m_x.size());
+    }
+
+    unsigned int pathFirstPoint(unsigned int path) const {
+        return m_pathOffsets[path];
+    }
+
+    unsigned int pathPointCount(unsigned int path) const {
+        return m_pathOffsets[path + 1] - m_pathOffsets[path];
+    }
+
+    const float* x() const {
+        return m_x.data();
+    }
+
+    const float* y() const {
+        return m_y.data();
+    }
+
+    const float* r() const {
+        return m_r.data();
+    }
+
+    const float* g() const {
+        return m_g.data();
+    }
+
+    const float* b() const {
+        return m_b.data();
+    }
+
+private:
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_r;
+    std::vector<float> m_g;
+    std::vector<float> m_b;
+    std::vector<unsigned int> m_pathOffsets;    // First point of each path, then the point count
+};
+
+} // namespace Ponk
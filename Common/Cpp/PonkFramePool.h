@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+ *  Pool of reusable frames
+ *
+ *  Received frames hold arrays that grow to the size of the frames they store (FramePoints, per path meta data...).
+ *  Instead of destroying a frame once it was replaced and allocating the next one, receivers recycle it in a
+ *  FramePool: acquire() gives back a cleared frame which kept its storage, so once a few frames went through the
+ *  pool, frames of a steady stream are received without any allocation. Frames are exchanged (std::swap) rather
+ *  than copied when handed over, for the storage to stay in circulation.
+ *
+ *  Frame must have a clear() method keeping its storage. Not thread safe: use a pool per receive thread (or sender).
+ *
+ *  Usage:
+ *      std::unique_ptr<Frame> frame = pool.acquire();
+ *      ... fill *frame
+ *      std::swap(latestFrame, *frame);     // frame now holds the previous latest frame
+ *      pool.recycle(std::move(frame));
+ */
+
+#include <vector>
+#include <memory>
+
+namespace Ponk {
+
+template <class Frame>
+class FramePool {
+public:
+    // Frames kept for reuse: more are freed when recycled
+    explicit FramePool(unsigned int capacity = 8)
+        : m_capacity(capacity) {
+        m_frames.reserve(capacity);
+    }
+
+    // Cleared frame, a recycled one when available
+    std::unique_ptr<Frame> acquire() {
+        if (m_frames.empty()) {
+            return std::unique_ptr<Frame>(new Frame());
+        }
+        std::unique_ptr<Frame> frame = std::move(m_frames.back());
+        m_frames.pop_back();
+        frame->clear();
+        return frame;
+    }
+
+    void recycle(std::unique_ptr<Frame> frame) {
+        if (frame && m_frames.size() < m_capacity) {
+            m_frames.push_back(std::move(frame));
+        }
+    }
+
+    // Frames waiting for reuse
+    size_t size() const {
+        return m_frames.size();
+    }
+
+private:
+    unsigned int m_capacity;
+    std::vector<std::unique_ptr<Frame> > m_frames;
+};
+
+} // namespace Ponk
@@ -0,0 +1,198 @@
+#pragma once
+
+/*
+ *  PONK_DATA_FORMAT_XY_F16_RGB_U8 encoder / decoder
+ *
+ *  X,Y as IEEE 754 half precision floats (16 bits, LSB first), R,G,B as unsigned char: 7 bytes per point
+ *  instead of 11 for PONK_DATA_FORMAT_XY_F32_RGB_U8. Halves have 11 significant bits: in [-1,+1] the step is
+ *  at most 1/2048 (near the edges), finer towards the center, which is below what galvanometers resolve.
+ *
+ *  Conversions use the F16C instructions when the compiler targets them (-mf16c / -march=native with GCC and
+ *  Clang, /arch:AVX2 with MSVC), otherwise a scalar conversion rounding the same way (to nearest even).
+ */
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+    #define PONK_HAS_F16C 1
+    #include <immintrin.h>
+#else
+    #define PONK_HAS_F16C 0
+#endif
+
+namespace Ponk {
+
+inline unsigned short floatToHalf(float value) {
+    unsigned int f;
+    memcpy(&f, &value, sizeof(f));
+    const unsigned int sign = f & 0x80000000u;
+    f ^= sign;
+    unsigned int h;
+    if (f >= (127u + 16) << 23) {
+        // Too big for a half (or infinity, NaN)
+        h = f > (255u << 23) ? 0x7E00 : 0x7C00;
+    } else if (f < 113u << 23) {
+        // Subnormal half or zero: let the float addition round the mantissa
+        const unsigned int magicBits = ((127u - 15) + (23 - 10) + 1) << 23;
+        float magic, sum;
+        memcpy(&magic, &magicBits, sizeof(magic));
+        memcpy(&sum, &f, sizeof(sum));
+        sum += magic;
+        memcpy(&h, &sum, sizeof(h));
+        h -= magicBits;
+    } else {
+        // Rebias exponent and round mantissa to nearest even
+        const unsigned int mantissaOdd = (f >> 13) & 1;
+        f += ((15u - 127) << 23) + 0xFFF + mantissaOdd;
+        h = f >> 13;
+    }
+    return static_cast<unsigned short>(h | (sign >> 16));
+}
+
+inline float halfToFloat(unsigned short half) {
+    const unsigned int shiftedExponent = 0x7C00u << 13;
+    unsigned int f = (half & 0x7FFFu) << 13;
+    const unsigned int exponent = f & shiftedExponent;
+    f += (127u - 15) << 23;
+    float value;
+    if (exponent == shiftedExponent) {
+        f += (128u - 16) << 23;    // Infinity, NaN
+        memcpy(&value, &f, sizeof(value));
+    } else if (exponent == 0) {
+        // Subnormal: renormalize with a float subtraction
+        const unsigned int magicBits = 113u << 23;
+        float magic;
+        memcpy(&magic, &magicBits, sizeof(magic));
+        f += 1u << 23;
+        memcpy(&value, &f, sizeof(value));
+        value -= magic;
+    } else {
+        memcpy(&value, &f, sizeof(value));
+    }
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits |= static_cast<unsigned int>(half & 0x8000u) << 16;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline void floatsToHalves(const float* in, unsigned short* out, size_t count) {
+    size_t i = 0;
+#if PONK_HAS_F16C
+    for (; i + 8 <= count; i += 8) {
+        const __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), halves);
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = floatToHalf(in[i]);
+    }
+}
+
+inline void halvesToFloats(const unsigned short* in, float* out, size_t count) {
+    size_t i = 0;
+#if PONK_HAS_F16C
+    for (; i + 8 <= count; i += 8) {
+        const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(halves));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = halfToFloat(in[i]);
+    }
+}
+
+const size_t kHalfPointSize = 2 * sizeof(unsigned short) + 3;
+
+// Decode count points into xs, ys (float arrays) and colors (R,G,B per point). Caller checked data holds them.
+inline void decodeHalfPoints(const unsigned char* data, size_t count, float* xs, float* ys, unsigned char* colors) {
+    // Gather halves by blocks, so conversions run on contiguous arrays
+    const size_t kBlockSize = 64;
+    unsigned short xHalves[kBlockSize];
+    unsigned short yHalves[kBlockSize];
+    for (size_t first = 0; first < count; first += kBlockSize) {
+        const size_t blockCount = count - first < kBlockSize ? count - first : kBlockSize;
+        const unsigned char* p = data + first * kHalfPointSize;
+        for (size_t i = 0; i < blockCount; i++, p += kHalfPointSize) {
+            xHalves[i] = static_cast<unsigned short>(p[0] | (p[1] << 8));
+            yHalves[i] = static_cast<unsigned short>(p[2] | (p[3] << 8));
+            colors[3 * (first + i)] = p[4];
+            colors[3 * (first + i) + 1] = p[5];
+            colors[3 * (first + i) + 2] = p[6];
+        }
+        halvesToFloats(xHalves, xs + first, blockCount);
+        halvesToFloats(yHalves, ys + first, blockCount);
+    }
+}
+
+// Decode pointCount points into 'points' (pointer to any type with float x,y,r,g,b members, or PointArrays),
+// colors in [0,1]. Returns false if data is truncated.
+template <class Points>
+bool decodeHalfPath(const unsigned char* data, size_t size, unsigned int pointCount, Points points) {
+    if (size < pointCount * kHalfPointSize) {
+        return false;
+    }
+    const unsigned int kBlockSize = 64;
+    float xs[kBlockSize];
+    float ys[kBlockSize];
+    unsigned char colors[3 * kBlockSize];
+    for (unsigned int first = 0; first < pointCount; first += kBlockSize) {
+        const unsigned int blockCount = pointCount - first < kBlockSize ? pointCount - first : kBlockSize;
+        decodeHalfPoints(data + first * kHalfPointSize, blockCount, xs, ys, colors);
+        for (unsigned int i = 0; i < blockCount; i++) {
+            points[first + i].x = xs[i];
+            points[first + i].y = ys[i];
+            points[first + i].r = colors[3 * i] / 255.f;
+            points[first + i].g = colors[3 * i + 1] / 255.f;
+            points[first + i].b = colors[3 * i + 2] / 255.f;
+        }
+    }
+    return true;
+}
+
+// Sender side: points are collected, then converted all at once when written
+class HalfPathEncoder {
+public:
+    void clear() {
+        m_xy.clear();
+        m_colors.clear();
+    }
+
+    void addPoint(float x, float y, unsigned char r, unsigned char g, unsigned char b) {
+        m_xy.push_back(x);
+        m_xy.push_back(y);
+        m_colors.push_back(r);
+        m_colors.push_back(g);
+        m_colors.push_back(b);
+    }
+
+    unsigned int pointCount() const {
+        return static_cast<unsigned int>(m_colors.size() / 3);
+    }
+
+    void write(std::vector<unsigned char>& data) {
+        m_halves.resize(m_xy.size());
+        floatsToHalves(m_xy.data(), m_halves.data(), m_xy.size());
+        const size_t offset = data.size();
+        data.resize(offset + pointCount() * kHalfPointSize);
+        unsigned char* p = data.data() + offset;
+        for (size_t i = 0; i < pointCount(); i++, p += kHalfPointSize) {
+            p[0] = static_cast<unsigned char>(m_halves[2 * i] & 0xFF);
+            p[1] = static_cast<unsigned char>(m_halves[2 * i] >> 8);
+            p[2] = static_cast<unsigned char>(m_halves[2 * i + 1] & 0xFF);
+            p[3] = static_cast<unsigned char>(m_halves[2 * i + 1] >> 8);
+            p[4] = m_colors[3 * i];
+            p[5] = m_colors[3 * i + 1];
+            p[6] = m_colors[3 * i + 2];
+        }
+    }
+
+private:
+    std::vector<float> m_xy;                // X,Y of each point
+    std::vector<unsigned char> m_colors;    // R,G,B of each point
+    std::vector<unsigned short> m_halves;
+};
+
+} // namespace Ponk
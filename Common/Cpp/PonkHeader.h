@@ -0,0 +1,209 @@
+#pragma once
+
+/*
+ *  Read / write PONK chunk headers of any supported protocol version.
+ *
+ *  Senders fill a ChunkHeader and call writeChunkHeader, which picks the lowest protocol version able
+ *  to carry it (so receivers only supporting version 0 still get frames that don't use any extension).
+ *  Receivers call readChunkHeader to get the same normalized ChunkHeader whatever the version.
+ *  The compact header (protocol version 3) is only used when asked for, as it doesn't carry the sender name:
+ *  senders then send announcements and receivers get the name from their cache (see PonkAnnouncement.h).
+ */
+
+#include "PonkDefs.h"
+#include <cstring>
+#include <cstddef>
+
+namespace Ponk {
+
+struct ChunkHeader {
+    unsigned char protocolVersion = 0;  // When writing: minimum version to use (2 for frames of more than 255 chunks, 3 for compact header)
+    unsigned char flags = 0;            // PONK_FLAG_XXX, always 0 for protocol version 0
+    unsigned int senderIdentifier = 0;
+    char senderName[32] = {};           // Not sent with protocol version 3
+    unsigned int frameNumber = 0;       // Only 8 bits are sent before protocol version 2
+    unsigned int chunkCount = 0;
+    unsigned int chunkNumber = 0;
+    unsigned int dataCrc = 0;
+    unsigned int parityChunkCount = 0;  // Only with PONK_FLAG_FEC
+    unsigned long long timestamp = 0;   // Only with PONK_FLAG_TIMESTAMP: capture time, sender clock in microseconds
+};
+
+// Protocol version writeChunkHeader will use
+inline unsigned char chunkHeaderVersion(const ChunkHeader& header) {
+    if (header.protocolVersion >= 3) {
+        return 3;
+    }
+    if (header.protocolVersion >= 2) {
+        return 2;
+    }
+    return header.flags == 0 ? 0 : 1;
+}
+
+// Size of the fixed part of the header for this protocol version
+inline size_t chunkHeaderBaseSize(unsigned char version) {
+    switch (version) {
+    case 0:
+        return sizeof(GeomUdpHeader);
+    case 1:
+        return sizeof(GeomUdpHeaderV1);
+    case 2:
+        return sizeof(GeomUdpHeaderV2);
+    default:
+        return sizeof(GeomUdpHeaderV3);
+    }
+}
+
+// Size of the header extensions following the fixed part, depending on flags
+inline size_t chunkHeaderExtensionsSize(unsigned char version, unsigned char flags) {
+    size_t size = 0;
+    if (flags & PONK_FLAG_FEC) {
+        size += version >= 2 ? 2 : 1;
+    }
+    if (flags & PONK_FLAG_TIMESTAMP) {
+        size += 8;
+    }
+    return size;
+}
+
+// Size of the header that writeChunkHeader will write
+inline size_t chunkHeaderSize(const ChunkHeader& header) {
+    const unsigned char version = chunkHeaderVersion(header);
+    return chunkHeaderBaseSize(version) + chunkHeaderExtensionsSize(version, header.flags);
+}
+
+// Maximum number of chunks (data and parity) in a frame with this header version
+inline unsigned int maxChunkCount(const ChunkHeader& header) {
+    return chunkHeaderVersion(header) >= 2 ? 0xFFFF : 0xFF;
+}
+
+// Write header to buffer (which must hold chunkHeaderSize(header) bytes), returns written size
+inline size_t writeChunkHeader(const ChunkHeader& header, unsigned char* buffer) {
+    const unsigned char version = chunkHeaderVersion(header);
+    if (version >= 3) {
+        GeomUdpHeaderV3 raw;
+        memcpy(raw.headerString, PONK_HEADER_STRING, sizeof(raw.headerString));
+        raw.protocolVersion = 3;
+        raw.senderIdentifier = header.senderIdentifier;
+        raw.frameNumber = header.frameNumber;
+        raw.chunkCount = static_cast<unsigned short>(header.chunkCount);
+        raw.chunkNumber = static_cast<unsigned short>(header.chunkNumber);
+        raw.dataCrc = header.dataCrc;
+        raw.flags = header.flags;
+        memcpy(buffer, &raw, sizeof(raw));
+    } else if (version == 2) {
+        GeomUdpHeaderV2 raw;
+        memcpy(raw.headerString, PONK_HEADER_STRING, sizeof(raw.headerString));
+        raw.protocolVersion = 2;
+        raw.senderIdentifier = header.senderIdentifier;
+        memcpy(raw.senderName, header.senderName, sizeof(raw.senderName));
+        raw.frameNumber = header.frameNumber;
+        raw.chunkCount = static_cast<unsigned short>(header.chunkCount);
+        raw.chunkNumber = static_cast<unsigned short>(header.chunkNumber);
+        raw.dataCrc = header.dataCrc;
+        raw.flags = header.flags;
+        memcpy(buffer, &raw, sizeof(raw));
+    } else {
+        GeomUdpHeaderV1 raw;
+        memcpy(raw.headerString, PONK_HEADER_STRING, sizeof(raw.headerString));
+        raw.protocolVersion = version;
+        raw.senderIdentifier = header.senderIdentifier;
+        memcpy(raw.senderName, header.senderName, sizeof(raw.senderName));
+        raw.frameNumber = static_cast<unsigned char>(header.frameNumber);
+        raw.chunkCount = static_cast<unsigned char>(header.chunkCount);
+        raw.chunkNumber = static_cast<unsigned char>(header.chunkNumber);
+        raw.dataCrc = header.dataCrc;
+        raw.flags = header.flags;
+        memcpy(buffer, &raw, version == 0 ? sizeof(GeomUdpHeader) : sizeof(GeomUdpHeaderV1));
+    }
+
+    // Extensions, in flag order
+    unsigned char* p = buffer + chunkHeaderBaseSize(version);
+    if (header.flags & PONK_FLAG_FEC) {
+        *p++ = static_cast<unsigned char>(header.parityChunkCount & 0xFF);
+        if (version >= 2) {
+            *p++ = static_cast<unsigned char>((header.parityChunkCount >> 8) & 0xFF);
+        }
+    }
+    if (header.flags & PONK_FLAG_TIMESTAMP) {
+        for (int i = 0; i < 8; i++) {
+            *p++ = static_cast<unsigned char>((header.timestamp >> (8 * i)) & 0xFF);
+        }
+    }
+    return static_cast<size_t>(p - buffer);
+}
+
+// Parse a chunk header. Returns the header size (data starts right after), or 0 if the buffer is not
+// a valid PONK chunk or uses an unsupported protocol version (header.protocolVersion is then set so the
+// caller can notify the user).
+inline size_t readChunkHeader(const unsigned char* buffer, size_t size, ChunkHeader& header) {
+    header = ChunkHeader();
+    // Smallest header (protocol version 3), the magic and version are at the same place in all versions
+    if (size < sizeof(GeomUdpHeaderV3)) {
+        return 0;
+    }
+    if (strncmp(reinterpret_cast<const char*>(buffer), PONK_HEADER_STRING, 8) != 0) {
+        return 0;
+    }
+
+    header.protocolVersion = buffer[8];
+    if (header.protocolVersion > PONK_PROTOCOL_VERSION) {
+        return 0;
+    }
+    const unsigned char version = header.protocolVersion;
+    if (size < chunkHeaderBaseSize(version)) {
+        return 0;
+    }
+
+    if (version == 3) {
+        GeomUdpHeaderV3 raw;
+        memcpy(&raw, buffer, sizeof(raw));
+        header.senderIdentifier = raw.senderIdentifier;
+        header.frameNumber = raw.frameNumber;
+        header.chunkCount = raw.chunkCount;
+        header.chunkNumber = raw.chunkNumber;
+        header.dataCrc = raw.dataCrc;
+        header.flags = raw.flags;
+    } else if (version == 2) {
+        GeomUdpHeaderV2 raw;
+        memcpy(&raw, buffer, sizeof(raw));
+        header.senderIdentifier = raw.senderIdentifier;
+        memcpy(header.senderName, raw.senderName, sizeof(header.senderName));
+        header.frameNumber = raw.frameNumber;
+        header.chunkCount = raw.chunkCount;
+        header.chunkNumber = raw.chunkNumber;
+        header.dataCrc = raw.dataCrc;
+        header.flags = raw.flags;
+    } else {
+        GeomUdpHeaderV1 raw;
+        memcpy(&raw, buffer, version == 0 ? sizeof(GeomUdpHeader) : sizeof(GeomUdpHeaderV1));
+        header.senderIdentifier = raw.senderIdentifier;
+        memcpy(header.senderName, raw.senderName, sizeof(header.senderName));
+        header.frameNumber = raw.frameNumber;
+        header.chunkCount = raw.chunkCount;
+        header.chunkNumber = raw.chunkNumber;
+        header.dataCrc = raw.dataCrc;
+        header.flags = version == 0 ? 0 : raw.flags;
+    }
+
+    // Extensions, in flag order
+    const size_t headerSize = chunkHeaderBaseSize(version) + chunkHeaderExtensionsSize(version, header.flags);
+    if (size < headerSize) {
+        return 0;
+    }
+    const unsigned char* p = buffer + chunkHeaderBaseSize(version);
+    if (header.flags & PONK_FLAG_FEC) {
+        header.parityChunkCount = *p++;
+        if (version >= 2) {
+            header.parityChunkCount |= static_cast<unsigned int>(*p++) << 8;
+        }
+    }
+    if (header.flags & PONK_FLAG_TIMESTAMP) {
+        for (int i = 0; i < 8; i++) {
+            header.timestamp |= static_cast<unsigned long long>(*p++) << (8 * i);
+        }
+    }
+    return headerSize;
+}
+
+} // namespace Ponk
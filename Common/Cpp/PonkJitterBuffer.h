@@ -0,0 +1,173 @@
+#pragma once
+
+/*
+ *  Jitter buffer: playout times at a steady cadence
+ *
+ *  Frames are sent at a steady rate, but arrive unevenly (network queues, retransmissions, sender hiccups): shown as
+ *  soon as received, the jitter shows up as uneven motion. A JitterBuffer gives each frame of a sender a playout
+ *  time on a steady cadence instead, from frame numbers and arrival times only (no clock sync needed):
+ *      - The frame interval is estimated from arrival times and frame numbers
+ *      - Each frame is expected one interval (per frame number) after the previous one. Frames arriving earlier
+ *        than expected pull the expected arrivals back, later ones push them slowly forward (clock drift)
+ *      - Frames are shown a delay after their expected arrival: the target delay, or more when the measured jitter
+ *        needs it (adaptive depth, up to the max delay). The delay changes smoothly so the cadence stays steady
+ *  A frame arriving after its playout time is an underrun (the buffer ran dry, it is shown at once and the delay
+ *  grows). Receivers dropping frames because too many are waiting count overruns with countOverrun().
+ *
+ *  Receiver usage (per sender):
+ *      jitterBuffer.setTargetDelay(20000);
+ *      unsigned long long playoutTime;
+ *      if (jitterBuffer.schedule(frameNumber, frameNumberMask(protocolVersion), clockMicroseconds(), playoutTime))
+ *          ... show the frame at playoutTime
+ *      // else older than frames already scheduled: drop it
+ */
+
+#include "PonkReassembly.h"
+#include <cstdint>
+
+namespace Ponk {
+
+class JitterBuffer {
+public:
+    // Smallest delay between the expected arrival of frames and their playout, in microseconds
+    void setTargetDelay(unsigned int delay) {
+        m_targetDelay = delay;
+    }
+
+    // Largest delay the jitter can grow the buffer to
+    void setMaxDelay(unsigned int delay) {
+        m_maxDelay = delay;
+    }
+
+    // Start over, ie when the sender restarted or the buffer was disabled
+    void reset() {
+        m_started = false;
+        m_interval = 0;
+        m_jitter = 0;
+        m_delay = 0;
+        m_lastPlayoutTime = 0;
+    }
+
+    // Playout time (receiver clock, microseconds) of a frame received at arrivalTime. Returns false for frames
+    // older than the last scheduled one, which would be shown out of order.
+    bool schedule(unsigned int frameNumber, unsigned int frameNumberMask, unsigned long long arrivalTime,
+                  unsigned long long& playoutTime) {
+        const int64_t arrival = static_cast<int64_t>(arrivalTime);
+        int64_t distance = 0;
+        if (m_started) {
+            distance = frameNumberDistance(m_lastFrameNumber, frameNumber, frameNumberMask);
+            if (distance < -static_cast<int64_t>(kMaxLateFrames)) {
+                reset();    // Sender restarted
+            } else if (distance <= 0) {
+                // Older than the last frame (reordered): its slot in the cadence has passed
+                m_underruns++;
+                return false;
+            }
+        }
+
+        if (!m_started) {
+            m_started = true;
+            m_firstArrival = arrival;
+            m_framesSinceFirst = 0;
+            m_expectedArrival = arrival;
+            m_delay = m_targetDelay;
+        } else {
+            // Frame interval, averaged since the first frame of the stream (lost frames count for their frame
+            // numbers): the arrival jitter of a frame weighs less and less. Pauses of the sender start over.
+            if (arrival - m_lastArrival > static_cast<int64_t>(kMaxInterval) * distance) {
+                m_firstArrival = arrival;
+                m_framesSinceFirst = 0;
+                m_expectedArrival = arrival - static_cast<int64_t>(static_cast<double>(distance) * m_interval);
+            } else {
+                m_framesSinceFirst += distance;
+                m_interval = static_cast<double>(arrival - m_firstArrival) / static_cast<double>(m_framesSinceFirst);
+            }
+
+            m_expectedArrival += static_cast<int64_t>(static_cast<double>(distance) * m_interval);
+            const int64_t deviation = arrival - m_expectedArrival;
+            if (deviation < 0) {
+                m_expectedArrival = arrival;
+            } else {
+                m_expectedArrival += deviation / 64;
+            }
+            m_jitter += (static_cast<double>(deviation < 0 ? -deviation : deviation) - m_jitter) / 16;
+
+            // Adaptive depth: enough delay for most frames to arrive in time. It grows within a few frames, and
+            // shrinks much slower so that occasional late frames keep finding room.
+            double delay = kJitterFactor * m_jitter;
+            if (delay < m_targetDelay) {
+                delay = m_targetDelay;
+            }
+            if (delay > m_maxDelay) {
+                delay = m_maxDelay;
+            }
+            m_delay += (delay - m_delay) / (delay > m_delay ? 16 : 512);
+        }
+        m_lastFrameNumber = frameNumber;
+        m_lastArrival = arrival;
+
+        int64_t playout = m_expectedArrival + static_cast<int64_t>(m_delay);
+        if (playout < arrival) {
+            // Arrived too late for its slot in the cadence: show it now, and make room for more jitter
+            m_underruns++;
+            m_delay += static_cast<double>(arrival - playout);
+            if (m_delay > m_maxDelay) {
+                m_delay = m_maxDelay;
+            }
+            playout = arrival;
+        }
+        // Frames are shown in order
+        if (playout < m_lastPlayoutTime) {
+            playout = m_lastPlayoutTime;
+        }
+        m_lastPlayoutTime = playout;
+        playoutTime = static_cast<unsigned long long>(playout);
+        return true;
+    }
+
+    // A frame was dropped because too many frames were waiting for their playout time
+    void countOverrun() {
+        m_overruns++;
+    }
+
+    unsigned int underruns() const {
+        return m_underruns;
+    }
+
+    unsigned int overruns() const {
+        return m_overruns;
+    }
+
+    // Current delay between expected arrivals and playout, in microseconds
+    double delay() const {
+        return m_delay;
+    }
+
+    // Estimated time between frames in microseconds, 0 until known
+    double frameInterval() const {
+        return m_interval;
+    }
+
+private:
+    static constexpr double kJitterFactor = 3;          // Delay in average deviations from the cadence
+    static constexpr double kMaxInterval = 1000000;     // Longer gaps between frames are sender pauses
+
+    unsigned int m_targetDelay = 0;
+    unsigned int m_maxDelay = 500000;
+
+    bool m_started = false;
+    unsigned int m_lastFrameNumber = 0;
+    int64_t m_lastArrival = 0;
+    int64_t m_firstArrival = 0;         // Of the frames the interval is averaged on
+    int64_t m_framesSinceFirst = 0;
+    int64_t m_expectedArrival = 0;      // Of the last frame, on the cadence
+    int64_t m_lastPlayoutTime = 0;
+    double m_interval = 0;
+    double m_jitter = 0;                // Average deviation from the cadence
+    double m_delay = 0;
+
+    unsigned int m_underruns = 0;
+    unsigned int m_overruns = 0;
+};
+
+} // namespace Ponk
@@ -0,0 +1,141 @@
+#pragma once
+
+/*
+ *  Interned meta data keys
+ *
+ *  Meta data keys are 8 chars, padded with zeros: packed in a 64 bits integer (EightCC) they compare and copy as
+ *  one number, without building strings. A receiver interns the keys it meets in a MetaDataKeyTable, which gives
+ *  each one a small id, stable for the life of the table: paths then store (id, value) pairs in a PathMetaData,
+ *  with room for a few of them inline, and consumers index per key arrays with the id.
+ *
+ *  The table is append only: one thread interns keys (the receive thread), others can read the keys and names of
+ *  ids below size() without locking.
+ *
+ *  Receiver usage:
+ *      for (unsigned int i = 0; i < path.metaDataCount(); i++) {
+ *          const unsigned int id = keyTable.intern(Ponk::packMetaDataKey(path.metaDataKey(i)));
+ *          if (id != Ponk::kInvalidMetaDataKeyId) pathMetaData.add(id, path.metaDataValue(i));
+ *      }
+ *      ...
+ *      keyTable.name(pathMetaData.id(i))     // "PATHNUMB"
+ */
+
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+
+namespace Ponk {
+
+// Key as sent (8 chars padded with zeros), packed in an integer
+inline uint64_t packMetaDataKey(const char* key) {
+    uint64_t packed;
+    memcpy(&packed, key, sizeof(packed));
+    return packed;
+}
+
+// Distinct keys a table holds: more are ignored, so a sender can't make receivers grow their per key arrays forever
+const unsigned int kMaxMetaDataKeys = 1024;
+const unsigned int kInvalidMetaDataKeyId = 0xFFFFFFFF;
+
+class MetaDataKeyTable {
+public:
+    MetaDataKeyTable()
+        : m_keys(kMaxMetaDataKeys) {
+    }
+
+    // Id of the key, interned on first use. Returns kInvalidMetaDataKeyId once the table is full.
+    unsigned int intern(uint64_t key) {
+        const unsigned int count = m_count.load(std::memory_order_relaxed);
+        // Keys of a path are usually in the same order as in the previous path
+        if (m_lastId < count && m_keys[m_lastId].packed == key) {
+            return m_lastId;
+        }
+        for (unsigned int id = 0; id < count; id++) {
+            if (m_keys[id].packed == key) {
+                m_lastId = id;
+                return id;
+            }
+        }
+        if (count == kMaxMetaDataKeys) {
+            return kInvalidMetaDataKeyId;
+        }
+        Key& entry = m_keys[count];
+        entry.packed = key;
+        memcpy(entry.name, &key, sizeof(key));
+        entry.name[8] = '\0';
+        m_count.store(count + 1, std::memory_order_release);
+        m_lastId = count;
+        return count;
+    }
+
+    // Number of interned keys: ids are below it
+    unsigned int size() const {
+        return m_count.load(std::memory_order_acquire);
+    }
+
+    uint64_t key(unsigned int id) const {
+        return m_keys[id].packed;
+    }
+
+    // Key without its padding zeros, null terminated
+    const char* name(unsigned int id) const {
+        return m_keys[id].name;
+    }
+
+private:
+    struct Key {
+        uint64_t packed;
+        char name[9];
+    };
+
+    std::vector<Key> m_keys;     // Sized once, so readers can access interned keys while others are added
+    std::atomic<unsigned int> m_count{0};
+    unsigned int m_lastId = 0;
+};
+
+// Meta data of a path as (key id, value) pairs: the first ones are stored inline, without allocation
+class PathMetaData {
+public:
+    static const unsigned int kInlineCount = 8;
+
+    void clear() {
+        m_count = 0;
+        m_more.clear();
+    }
+
+    void add(unsigned int id, float value) {
+        if (m_count < kInlineCount) {
+            m_entries[m_count].id = id;
+            m_entries[m_count].value = value;
+        } else {
+            Entry entry = { id, value };
+            m_more.push_back(entry);
+        }
+        m_count++;
+    }
+
+    unsigned int count() const {
+        return m_count;
+    }
+
+    unsigned int id(unsigned int i) const {
+        return i < kInlineCount ? m_entries[i].id : m_more[i - kInlineCount].id;
+    }
+
+    float value(unsigned int i) const {
+        return i < kInlineCount ? m_entries[i].value : m_more[i - kInlineCount].value;
+    }
+
+private:
+    struct Entry {
+        unsigned int id;
+        float value;
+    };
+
+    Entry m_entries[kInlineCount];
+    unsigned int m_count = 0;
+    std::vector<Entry> m_more;      // Past kInlineCount (up to 255 meta data per path)
+};
+
+} // namespace Ponk
@@ -0,0 +1,245 @@
+#pragma once
+
+/*
+ *  Frame level meta data table (PONK_DATA_FORMAT_META_DATA_TABLE / PONK_DATA_FORMAT_INDEXED_META_DATA)
+ *
+ *  Each meta data costs 12 bytes per path, and paths of a frame usually carry the same keys, often with the same
+ *  values (ie a PATHNUMB on every path, MAXSPEED 1 on most of them). The sender can instead start the frame with a
+ *  table of the keys used in the frame and a default value for each (the most frequent one), then write paths with
+ *  the PONK_DATA_FORMAT_INDEXED_META_DATA bit, listing only the meta data that differ from the table:
+ *      - PONK_DATA_FORMAT_META_DATA_TABLE record, first record of the frame:
+ *          - Data format - unsigned char
+ *          - Key Count - unsigned char (up to 127)
+ *          - For each key:
+ *              - Key - char[8]
+ *              - Default Value - 32 bits float
+ *      - Path with PONK_DATA_FORMAT_INDEXED_META_DATA set in its data format: same as a regular path, but each
+ *        meta data is
+ *          - Key Index - unsigned char: index in the table
+ *          - Value - 32 bits float, only if Key Index doesn't have 0x80 set (with 0x80 set, the path doesn't
+ *            have this meta data at all)
+ *        Keys of the table that are not listed take their default value.
+ *
+ *  Receivers expand indexed paths back to regular paths (meta data in table order) right after merging path
+ *  pieces, so the path cache and path parsing only see regular paths. Senders apply the table after the path cache.
+ *
+ *  Sender usage:
+ *      pathCache.encodeFrame(fullData, frameNumber, encodedData);   // optional
+ *      metaDataTable.encodeFrame(encodedData, frameData);
+ *  Receiver usage:
+ *      if (Ponk::usesMetaDataTable(data, size) && !metaDataTable.decodeFrame(data, size, expandedData)) drop frame;
+ */
+
+#include "PonkDefs.h"
+#include "PonkPathCache.h"
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+
+namespace Ponk {
+
+// Most keys a table can hold (key indices are 7 bits)
+const unsigned int kMaxMetaDataTableKeys = 127;
+
+// Returns true if the frame starts with a meta data table (it must then be expanded before parsing paths)
+inline bool usesMetaDataTable(const unsigned char* frame, size_t size) {
+    return size > 0 && frame[0] == PONK_DATA_FORMAT_META_DATA_TABLE;
+}
+
+// Sender side: move meta data of a regular frame to a table
+class MetaDataTableEncoder {
+public:
+    // Returns false if frame data could not be parsed, or the table would not make it smaller:
+    // out is then a plain copy of frame
+    bool encodeFrame(const std::vector<unsigned char>& frame, std::vector<unsigned char>& out) {
+        out.clear();
+        if (!collectKeys(frame)) {
+            out = frame;
+            return false;
+        }
+
+        out.push_back(PONK_DATA_FORMAT_META_DATA_TABLE);
+        out.push_back(static_cast<unsigned char>(m_keys.size()));
+        for (auto& key: m_keys) {
+            unsigned int defaultCount = 0;
+            for (const auto& kv: key.valueCounts) {
+                if (kv.second > defaultCount || (kv.second == defaultCount && kv.first < key.defaultValue)) {
+                    key.defaultValue = kv.first;
+                    defaultCount = kv.second;
+                }
+            }
+            out.insert(out.end(), key.name, key.name + 8);
+            pushU32(out, key.defaultValue);
+        }
+
+        size_t offset = 0;
+        while (offset < frame.size()) {
+            PathRecord record;
+            readPathRecord(&frame[offset], frame.size() - offset, record);
+            const unsigned char* recordData = &frame[offset];
+            offset += record.size;
+
+            const unsigned int metaCount = record.pointsOffset != 0 ? recordData[1] : 0;
+            if (metaCount == 0) {
+                out.insert(out.end(), recordData, recordData + record.size);
+                continue;
+            }
+
+            out.push_back(static_cast<unsigned char>(recordData[0] | PONK_DATA_FORMAT_INDEXED_META_DATA));
+            const size_t countOffset = out.size();
+            out.push_back(0);
+            unsigned int entryCount = 0;
+            for (size_t k = 0; k < m_keys.size(); k++) {
+                const unsigned char* meta = findMetaData(recordData, metaCount, m_keys[k].name);
+                if (!meta) {
+                    out.push_back(static_cast<unsigned char>(k | 0x80));
+                    entryCount++;
+                } else if (readU32(meta + 8) != m_keys[k].defaultValue) {
+                    out.push_back(static_cast<unsigned char>(k));
+                    out.insert(out.end(), meta + 8, meta + 12);
+                    entryCount++;
+                }
+            }
+            out[countOffset] = static_cast<unsigned char>(entryCount);
+            out.insert(out.end(), recordData + record.pointsOffset - 2, recordData + record.size);
+        }
+
+        if (out.size() >= frame.size()) {
+            out = frame;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Key {
+        char name[8];
+        unsigned int defaultValue = 0;                              // Raw float bits
+        std::unordered_map<unsigned int, unsigned int> valueCounts; // Raw float bits -> path count
+    };
+
+    static const unsigned char* findMetaData(const unsigned char* recordData, unsigned int metaCount, const char* name) {
+        for (unsigned int i = 0; i < metaCount; i++) {
+            const unsigned char* meta = recordData + 2 + 12 * i;
+            if (memcmp(meta, name, 8) == 0) {
+                return meta;
+            }
+        }
+        return nullptr;
+    }
+
+    // List keys used in the frame and count their values. Returns false if the frame can't use a table
+    // (parse error, already indexed, a key twice in a path, too many keys, no meta data at all).
+    bool collectKeys(const std::vector<unsigned char>& frame) {
+        m_keys.clear();
+        size_t offset = 0;
+        while (offset < frame.size()) {
+            PathRecord record;
+            if (!readPathRecord(&frame[offset], frame.size() - offset, record) || record.indexedMetaData
+                || record.dataFormat == PONK_DATA_FORMAT_META_DATA_TABLE) {
+                return false;
+            }
+            const unsigned char* recordData = &frame[offset];
+            offset += record.size;
+            if (record.pointsOffset == 0) {
+                continue;   // Path reference or diff, no meta data
+            }
+
+            const unsigned int metaCount = recordData[1];
+            for (unsigned int i = 0; i < metaCount; i++) {
+                const unsigned char* meta = recordData + 2 + 12 * i;
+                if (findMetaData(recordData, i, reinterpret_cast<const char*>(meta))) {
+                    return false;
+                }
+                size_t k = 0;
+                while (k < m_keys.size() && memcmp(m_keys[k].name, meta, 8) != 0) {
+                    k++;
+                }
+                if (k == m_keys.size()) {
+                    if (m_keys.size() == kMaxMetaDataTableKeys) {
+                        return false;
+                    }
+                    m_keys.emplace_back();
+                    memcpy(m_keys.back().name, meta, 8);
+                }
+                m_keys[k].valueCounts[readU32(meta + 8)]++;
+            }
+        }
+        return !m_keys.empty();
+    }
+
+    std::vector<Key> m_keys;
+};
+
+// Receiver side: expand paths using a meta data table back to regular paths
+class MetaDataTableDecoder {
+public:
+    // Returns false if frame data is corrupt (path using a table before any table, key index out of the table)
+    bool decodeFrame(const unsigned char* frame, size_t size, std::vector<unsigned char>& out) {
+        out.clear();
+        m_keys.clear();
+        size_t offset = 0;
+        while (offset < size) {
+            PathRecord record;
+            if (!readPathRecord(frame + offset, size - offset, record)) {
+                return false;
+            }
+            const unsigned char* recordData = frame + offset;
+            offset += record.size;
+
+            if (record.dataFormat == PONK_DATA_FORMAT_META_DATA_TABLE) {
+                m_keys.assign(recordData + 2, recordData + record.size);
+                continue;
+            }
+            if (!record.indexedMetaData) {
+                out.insert(out.end(), recordData, recordData + record.size);
+                continue;
+            }
+
+            // Start from the table defaults, then apply the path entries
+            const size_t keyCount = m_keys.size() / 12;
+            m_values.resize(keyCount);
+            m_present.assign(keyCount, 1);
+            for (size_t k = 0; k < keyCount; k++) {
+                m_values[k] = readU32(&m_keys[12 * k + 8]);
+            }
+            const unsigned int entryCount = recordData[1];
+            const unsigned char* entry = recordData + 2;
+            for (unsigned int i = 0; i < entryCount; i++) {
+                const unsigned int index = entry[0] & 0x7F;
+                if (index >= keyCount) {
+                    return false;
+                }
+                if (entry[0] & 0x80) {
+                    m_present[index] = 0;
+                    entry += 1;
+                } else {
+                    m_values[index] = readU32(entry + 1);
+                    entry += 5;
+                }
+            }
+
+            out.push_back(static_cast<unsigned char>(recordData[0] & ~PONK_DATA_FORMAT_INDEXED_META_DATA));
+            const size_t countOffset = out.size();
+            out.push_back(0);
+            unsigned int metaCount = 0;
+            for (size_t k = 0; k < keyCount; k++) {
+                if (m_present[k]) {
+                    out.insert(out.end(), &m_keys[12 * k], &m_keys[12 * k] + 8);
+                    pushU32(out, m_values[k]);
+                    metaCount++;
+                }
+            }
+            out[countOffset] = static_cast<unsigned char>(metaCount);
+            out.insert(out.end(), recordData + record.pointsOffset - 2, recordData + record.size);
+        }
+        return true;
+    }
+
+private:
+    std::vector<unsigned char> m_keys;      // Table entries: key and default value, 12 bytes each
+    std::vector<unsigned int> m_values;
+    std::vector<unsigned char> m_present;
+};
+
+} // namespace Ponk
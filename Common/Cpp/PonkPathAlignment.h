@@ -0,0 +1,450 @@
+#pragma once
+
+/*
+ *  Path-aligned chunking (PONK_FLAG_PATH_ALIGNED)
+ *
+ *  Frame data is normally cut in chunks at arbitrary offsets, so a path can straddle two chunks and no
+ *  chunk can be parsed without the others. With PONK_FLAG_PATH_ALIGNED, chunk boundaries fall on path
+ *  boundaries: each chunk payload (once decompressed) is a sequence of complete path records that can be
+ *  parsed on its own.
+ *
+ *  Paths too long for a chunk are split in pieces. Each piece is a regular path record with the same meta
+ *  data, and pieces after the first one have PONK_DATA_FORMAT_CONTINUATION set in their data format:
+ *      - Fixed size point formats: points are split by count
+ *      - PONK_DATA_FORMAT_XY_DELTA_RGB_RLE: each piece is encoded on its own (first point relative to 0x8000)
+ *      - PONK_DATA_FORMAT_PATH_DIFF: ranges are split between pieces, a range can be cut in adjacent ranges
+ *      - PONK_DATA_FORMAT_PATH_INSTANCES: instances are split in independent instance records (no continuation)
+ *      - PONK_DATA_FORMAT_CURVES paths and templates are not split (a frame with one too long for a chunk is sent
+ *        as usual)
+ *
+ *  A meta data table (PONK_DATA_FORMAT_META_DATA_TABLE, see PonkMetaDataTable.h) is repeated at the start of
+ *  each following chunk, so paths using it can still be expanded when other chunks are lost.
+ *
+ *  Receivers merge pieces back (PathPieceMerger) before any other processing, so the rest of the pipeline
+ *  (CRC is computed on data with pieces, path cache works on merged paths) is unchanged. Repeated tables are
+ *  merged back too. When chunks are lost, a piece whose previous piece was in a missing chunk starts a new
+ *  path: the received part of the frame can still be displayed.
+ */
+
+#include "PonkDefs.h"
+#include "PonkDeltaFormat.h"
+#include "PonkPathCache.h"
+#include "PonkPathInstancing.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace Ponk {
+
+// Sender side: rewrite frame data so it can be cut on path boundaries in chunks of at most maxChunkSize bytes
+class PathAligner {
+public:
+    // Returns false if frame data can't be parsed or a path can't be split to fit (ie too many meta data),
+    // the frame should then be chunked as usual
+    bool alignFrame(const std::vector<unsigned char>& frame, size_t maxChunkSize) {
+        m_data.clear();
+        m_chunkEnds.clear();
+        m_chunkStart = 0;
+        m_chunkContentStart = 0;
+        m_table.clear();
+        m_maxChunkSize = maxChunkSize;
+
+        size_t offset = 0;
+        while (offset < frame.size()) {
+            PathRecord record;
+            if (!readPathRecord(&frame[offset], frame.size() - offset, record) || record.continuation) {
+                return false;
+            }
+            const unsigned char* recordData = &frame[offset];
+            offset += record.size;
+
+            // Tables are repeated at the start of following chunks, they must leave room for paths
+            if (record.dataFormat == PONK_DATA_FORMAT_META_DATA_TABLE) {
+                if (record.size > maxChunkSize / 2) {
+                    return false;
+                }
+                m_table.assign(recordData, recordData + record.size);
+                if (record.size > room() && m_data.size() > m_chunkContentStart) {
+                    closeChunk();
+                } else {
+                    m_data.insert(m_data.end(), recordData, recordData + record.size);
+                }
+                continue;
+            }
+
+            if (record.size > room() && record.size <= maxChunkSize) {
+                closeChunk();
+            }
+            if (record.size <= room()) {
+                m_data.insert(m_data.end(), recordData, recordData + record.size);
+                continue;
+            }
+
+            bool split = false;
+            if (fixedPointStride(record.dataFormat) != 0) {
+                split = splitFixed(recordData, record);
+            } else if (record.dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE) {
+                split = splitDelta(recordData, record);
+            } else if (record.dataFormat == PONK_DATA_FORMAT_PATH_DIFF) {
+                split = splitDiff(recordData, record);
+            } else if (record.dataFormat == PONK_DATA_FORMAT_PATH_INSTANCES) {
+                split = splitInstances(recordData);
+            }
+            if (!split) {
+                return false;
+            }
+        }
+        closeChunk();
+        // No table for a chunk that won't come
+        if (!m_chunkEnds.empty()) {
+            m_data.resize(m_chunkEnds.back());
+        }
+        return true;
+    }
+
+    // Frame data with split paths
+    const std::vector<unsigned char>& data() const {
+        return m_data;
+    }
+
+    // End offset in data() of each chunk
+    const std::vector<size_t>& chunkEnds() const {
+        return m_chunkEnds;
+    }
+
+private:
+    size_t room() const {
+        return m_maxChunkSize - (m_data.size() - m_chunkStart);
+    }
+
+    void closeChunk() {
+        if (m_data.size() > m_chunkContentStart) {
+            m_chunkEnds.push_back(m_data.size());
+            m_chunkStart = m_data.size();
+            m_data.insert(m_data.end(), m_table.begin(), m_table.end());
+            m_chunkContentStart = m_data.size();
+        }
+    }
+
+    // Start a piece in the current chunk if at least minSize bytes fit, otherwise in a new chunk
+    bool makeRoom(size_t minSize) {
+        if (room() < minSize) {
+            closeChunk();
+        }
+        return room() >= minSize;
+    }
+
+    // Write path record header (data format, meta data, point count) for a piece
+    void pushPieceHeader(const unsigned char* recordData, const PathRecord& record, bool continuation, unsigned int pointCount) {
+        m_data.push_back(static_cast<unsigned char>((recordData[0] & ~PONK_DATA_FORMAT_CONTINUATION)
+                                                    | (continuation ? PONK_DATA_FORMAT_CONTINUATION : 0)));
+        m_data.insert(m_data.end(), recordData + 1, recordData + record.pointsOffset - 2);
+        m_data.push_back(static_cast<unsigned char>(pointCount & 0xFF));
+        m_data.push_back(static_cast<unsigned char>((pointCount >> 8) & 0xFF));
+    }
+
+    bool splitFixed(const unsigned char* recordData, const PathRecord& record) {
+        const unsigned int stride = fixedPointStride(record.dataFormat);
+        unsigned int first = 0;
+        while (first < record.pointCount) {
+            // Avoid tiny pieces at the end of a chunk
+            if (!makeRoom(record.pointsOffset + stride * std::min(8u, record.pointCount - first))) {
+                return false;
+            }
+            const unsigned int count = std::min<unsigned int>(record.pointCount - first,
+                                                              static_cast<unsigned int>((room() - record.pointsOffset) / stride));
+            pushPieceHeader(recordData, record, first > 0, count);
+            const unsigned char* points = recordData + record.pointsOffset + static_cast<size_t>(first) * stride;
+            m_data.insert(m_data.end(), points, points + static_cast<size_t>(count) * stride);
+            first += count;
+        }
+        return true;
+    }
+
+    bool splitInstances(const unsigned char* recordData) {
+        PathInstancesHeader header = readPathInstancesHeader(recordData);
+        const unsigned char* instances = recordData + header.headerSize;
+        const unsigned int instanceCount = header.instanceCount;
+        unsigned int first = 0;
+        while (first < instanceCount) {
+            if (!makeRoom(header.headerSize + header.instanceSize * std::min(8u, instanceCount - first))) {
+                return false;
+            }
+            header.instanceCount = std::min<unsigned int>(instanceCount - first,
+                                                          static_cast<unsigned int>((room() - header.headerSize) / header.instanceSize));
+            writePathInstancesHeader(header, m_data);
+            m_data.insert(m_data.end(), instances + first * header.instanceSize,
+                          instances + (first + header.instanceCount) * header.instanceSize);
+            first += header.instanceCount;
+            header.firstPathNumber += header.instanceCount;
+        }
+        return true;
+    }
+
+    bool splitDelta(const unsigned char* recordData, const PathRecord& record) {
+        m_points.resize(record.pointCount);
+        size_t bytesRead = 0;
+        if (!decodeDeltaPoints(recordData + record.pointsOffset, record.size - record.pointsOffset,
+                               record.pointCount, m_points.data(), bytesRead)) {
+            return false;
+        }
+
+        // Worst case size of a point: two 3 bytes varints and a new color run
+        const size_t kMaxPointSize = 10;
+        unsigned int first = 0;
+        while (first < record.pointCount) {
+            if (!makeRoom(record.pointsOffset + kMaxPointSize * std::min(8u, record.pointCount - first))) {
+                return false;
+            }
+            const unsigned int pieceFirst = first;
+            m_encoder.clear();
+            while (first < record.pointCount && record.pointsOffset + m_encoder.size() + kMaxPointSize <= room()) {
+                const DeltaPoint& point = m_points[first];
+                m_encoder.addQuantizedPoint(point.x, point.y, point.r, point.g, point.b);
+                first++;
+            }
+            pushPieceHeader(recordData, record, pieceFirst > 0, m_encoder.pointCount());
+            m_encoder.write(m_data);
+        }
+        return true;
+    }
+
+    bool splitDiff(const unsigned char* recordData, const PathRecord& record) {
+        const unsigned int stride = fixedPointStride(record.baseDataFormat);
+        const unsigned int rangeCount = recordData[7];
+        const size_t kDiffHeaderSize = 8;
+        const size_t kRangeHeaderSize = 4;
+
+        unsigned int range = 0;
+        size_t rangeOffset = kDiffHeaderSize;
+        unsigned int rangeFirst = 0;
+        unsigned int rangeCountLeft = 0;
+        const unsigned char* rangePoints = nullptr;
+        auto loadRange = [&]() {
+            rangeFirst = recordData[rangeOffset] | (recordData[rangeOffset + 1] << 8);
+            rangeCountLeft = recordData[rangeOffset + 2] | (recordData[rangeOffset + 3] << 8);
+            rangePoints = recordData + rangeOffset + kRangeHeaderSize;
+            rangeOffset += kRangeHeaderSize + static_cast<size_t>(rangeCountLeft) * stride;
+        };
+        if (rangeCount > 0) {
+            loadRange();
+        }
+
+        bool continuation = false;
+        while (range < rangeCount) {
+            if (!makeRoom(kDiffHeaderSize + kRangeHeaderSize + stride * 8)) {
+                return false;
+            }
+            const size_t pieceStart = m_data.size();
+            m_data.push_back(static_cast<unsigned char>(record.dataFormat | (continuation ? PONK_DATA_FORMAT_CONTINUATION : 0)));
+            m_data.insert(m_data.end(), recordData + 1, recordData + 7);
+            m_data.push_back(0);
+
+            unsigned int pieceRangeCount = 0;
+            while (range < rangeCount && pieceRangeCount < 255 && room() >= kRangeHeaderSize + stride) {
+                const unsigned int count = std::min<unsigned int>(rangeCountLeft,
+                                                                  static_cast<unsigned int>((room() - kRangeHeaderSize) / stride));
+                m_data.push_back(static_cast<unsigned char>(rangeFirst & 0xFF));
+                m_data.push_back(static_cast<unsigned char>((rangeFirst >> 8) & 0xFF));
+                m_data.push_back(static_cast<unsigned char>(count & 0xFF));
+                m_data.push_back(static_cast<unsigned char>((count >> 8) & 0xFF));
+                m_data.insert(m_data.end(), rangePoints, rangePoints + static_cast<size_t>(count) * stride);
+                pieceRangeCount++;
+                rangeFirst += count;
+                rangeCountLeft -= count;
+                rangePoints += static_cast<size_t>(count) * stride;
+                if (rangeCountLeft == 0 && ++range < rangeCount) {
+                    loadRange();
+                }
+            }
+            m_data[pieceStart + 7] = static_cast<unsigned char>(pieceRangeCount);
+            continuation = true;
+        }
+        return true;
+    }
+
+    std::vector<unsigned char> m_data;
+    std::vector<size_t> m_chunkEnds;
+    size_t m_chunkStart = 0;
+    size_t m_chunkContentStart = 0;     // After the table repeated at chunk start
+    size_t m_maxChunkSize = 0;
+    std::vector<unsigned char> m_table;
+    std::vector<DeltaPoint> m_points;
+    DeltaPathEncoder m_encoder;
+};
+
+// Receiver side: merge path pieces of a PONK_FLAG_PATH_ALIGNED frame back into full paths
+//
+// Usage:
+//      merger.clear();
+//      for each received chunk, in chunk number order:
+//          merger.addChunk(chunkData, chunkSize, previousChunkReceived);
+//      const std::vector<unsigned char>& frameData = merger.finish();
+class PathPieceMerger {
+public:
+    void clear() {
+        m_data.clear();
+        m_open = false;
+        m_table.clear();
+    }
+
+    // Append the paths of a chunk. If previousChunkReceived is false, a piece continuing a path of the
+    // missing chunk starts a new path. Returns false if chunk data is corrupt (paths before are kept).
+    bool addChunk(const unsigned char* data, size_t size, bool previousChunkReceived) {
+        bool canContinue = previousChunkReceived;
+        size_t offset = 0;
+        while (offset < size) {
+            PathRecord record;
+            if (!readPathRecord(data + offset, size - offset, record)) {
+                closePath();
+                return false;
+            }
+            const unsigned char* recordData = data + offset;
+            offset += record.size;
+
+            // A meta data table repeated at chunk start is only kept once
+            if (record.dataFormat == PONK_DATA_FORMAT_META_DATA_TABLE) {
+                if (m_table.size() == record.size && memcmp(m_table.data(), recordData, record.size) == 0) {
+                    continue;
+                }
+                m_table.assign(recordData, recordData + record.size);
+            }
+
+            if (!record.continuation || !canContinue || !continuePath(recordData, record)) {
+                closePath();
+                openPath(recordData, record);
+            }
+            canContinue = true;
+        }
+        return true;
+    }
+
+    const std::vector<unsigned char>& finish() {
+        closePath();
+        return m_data;
+    }
+
+private:
+    void openPath(const unsigned char* recordData, const PathRecord& record) {
+        m_open = true;
+        m_openOffset = m_data.size();
+        m_openRecord = record;
+        m_openDeltaDecoded = false;
+        m_data.insert(m_data.end(), recordData, recordData + record.size);
+        m_data[m_openOffset] = recordData[0] & ~PONK_DATA_FORMAT_CONTINUATION;
+
+        // Locate the last range of a diff, a continuation may extend it
+        if (record.dataFormat == PONK_DATA_FORMAT_PATH_DIFF) {
+            const unsigned int stride = fixedPointStride(record.baseDataFormat);
+            const unsigned int rangeCount = recordData[7];
+            size_t rangeOffset = 8;
+            m_lastRangeOffset = 0;
+            for (unsigned int i = 0; i < rangeCount; i++) {
+                m_lastRangeOffset = m_openOffset + rangeOffset;
+                const unsigned int count = recordData[rangeOffset + 2] | (recordData[rangeOffset + 3] << 8);
+                rangeOffset += 4 + static_cast<size_t>(count) * stride;
+            }
+        }
+    }
+
+    bool continuePath(const unsigned char* recordData, const PathRecord& record) {
+        if (!m_open || record.dataFormat != m_openRecord.dataFormat || record.indexedMetaData != m_openRecord.indexedMetaData) {
+            return false;
+        }
+
+        if (record.dataFormat == PONK_DATA_FORMAT_PATH_DIFF) {
+            if (record.pathNumber != m_openRecord.pathNumber || record.baseFrameNumber != m_openRecord.baseFrameNumber) {
+                return false;
+            }
+            const unsigned int stride = fixedPointStride(record.baseDataFormat);
+            const unsigned int rangeCount = recordData[7];
+            size_t rangeOffset = 8;
+            for (unsigned int i = 0; i < rangeCount; i++) {
+                const unsigned int first = recordData[rangeOffset] | (recordData[rangeOffset + 1] << 8);
+                const unsigned int count = recordData[rangeOffset + 2] | (recordData[rangeOffset + 3] << 8);
+                const unsigned char* points = recordData + rangeOffset + 4;
+                rangeOffset += 4 + static_cast<size_t>(count) * stride;
+
+                // A range cut in two by the sender is merged back
+                if (m_lastRangeOffset != 0) {
+                    unsigned char* last = &m_data[m_lastRangeOffset];
+                    const unsigned int lastFirst = last[0] | (last[1] << 8);
+                    const unsigned int lastCount = last[2] | (last[3] << 8);
+                    if (lastFirst + lastCount == first && lastCount + count <= 0xFFFF) {
+                        last[2] = static_cast<unsigned char>((lastCount + count) & 0xFF);
+                        last[3] = static_cast<unsigned char>(((lastCount + count) >> 8) & 0xFF);
+                        m_data.insert(m_data.end(), points, points + static_cast<size_t>(count) * stride);
+                        continue;
+                    }
+                }
+                if (m_data[m_openOffset + 7] == 255) {
+                    return false;
+                }
+                m_data[m_openOffset + 7]++;
+                m_lastRangeOffset = m_data.size();
+                m_data.insert(m_data.end(), recordData + rangeOffset - 4 - static_cast<size_t>(count) * stride,
+                              recordData + rangeOffset);
+            }
+            return true;
+        }
+
+        // Curve pieces would repeat the start point and other records have no points, senders never split them
+        if (record.dataFormat == PONK_DATA_FORMAT_CURVES || record.pointsOffset == 0) {
+            return false;
+        }
+
+        const unsigned int pointCount = m_openRecord.pointCount + record.pointCount;
+        if (pointCount > 0xFFFF) {
+            return false;
+        }
+
+        if (record.dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE) {
+            // Pieces are encoded independently: decode them, the merged path is encoded when closed
+            size_t bytesRead = 0;
+            if (!m_openDeltaDecoded) {
+                m_points.resize(m_openRecord.pointCount);
+                if (!decodeDeltaPoints(&m_data[m_openOffset + m_openRecord.pointsOffset], m_openRecord.size - m_openRecord.pointsOffset,
+                                       m_openRecord.pointCount, m_points.data(), bytesRead)) {
+                    return false;
+                }
+                m_data.resize(m_openOffset + m_openRecord.pointsOffset);
+                m_openDeltaDecoded = true;
+            }
+            m_points.resize(pointCount);
+            if (!decodeDeltaPoints(recordData + record.pointsOffset, record.size - record.pointsOffset,
+                                   record.pointCount, &m_points[m_openRecord.pointCount], bytesRead)) {
+                m_points.resize(m_openRecord.pointCount);
+                return false;
+            }
+        } else {
+            m_data.insert(m_data.end(), recordData + record.pointsOffset, recordData + record.size);
+        }
+        m_openRecord.pointCount = pointCount;
+        m_data[m_openOffset + m_openRecord.pointsOffset - 2] = static_cast<unsigned char>(pointCount & 0xFF);
+        m_data[m_openOffset + m_openRecord.pointsOffset - 1] = static_cast<unsigned char>((pointCount >> 8) & 0xFF);
+        return true;
+    }
+
+    void closePath() {
+        if (m_open && m_openDeltaDecoded) {
+            m_encoder.clear();
+            for (const auto& point: m_points) {
+                m_encoder.addQuantizedPoint(point.x, point.y, point.r, point.g, point.b);
+            }
+            m_encoder.write(m_data);
+        }
+        m_open = false;
+    }
+
+    std::vector<unsigned char> m_data;
+    bool m_open = false;
+    size_t m_openOffset = 0;
+    PathRecord m_openRecord;
+    bool m_openDeltaDecoded = false;
+    size_t m_lastRangeOffset = 0;
+    std::vector<DeltaPoint> m_points;
+    DeltaPathEncoder m_encoder;
+    std::vector<unsigned char> m_table;
+};
+
+} // namespace Ponk
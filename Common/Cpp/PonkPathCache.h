@@ -0,0 +1,489 @@
+#pragma once
+
+/*
+ *  Inter-frame path caching keyed by PATHNUMB meta data
+ *
+ *  Most frames re-send paths that didn't change since previous frames. The sender can replace such a
+ *  path by a reference to the frame it was last sent in, or by a small diff against it. The receiver keeps
+ *  a per-sender cache of the last full version of each path and rebuilds the full frame before parsing it.
+ *
+ *  Path records added to the frame data (they can be mixed with regular paths):
+ *      - PONK_DATA_FORMAT_PATH_REFERENCE: path unchanged since frame N
+ *          - Data format - unsigned char
+ *          - Path Number - unsigned int (PATHNUMB meta data value, rounded)
+ *          - Base Frame Number - unsigned char: frame in which the receiver got this path
+ *      - PONK_DATA_FORMAT_PATH_DIFF: same format, meta data and point count as in frame N, some points changed.
+ *        Only used for fixed size point formats (PONK_DATA_FORMAT_XYRGB_U16, PONK_DATA_FORMAT_XY_F32_RGB_U8,
+ *        PONK_DATA_FORMAT_XY_F16_RGB_U8)
+ *          - Data format - unsigned char
+ *          - Path Number - unsigned int
+ *          - Base Frame Number - unsigned char
+ *          - Base Data Format - unsigned char: data format of the base path (gives the point size)
+ *          - Range Count - unsigned char
+ *          - For each range:
+ *              - First Point - unsigned short
+ *              - Point Count - unsigned short
+ *              - Point data, in the base path data format
+ *
+ *  Rules on both sides (so sender and receiver caches stay identical):
+ *      - Any path carrying PATHNUMB meta data is cached with the number of the frame it was received in.
+ *        A diff updates the cached path and its frame number.
+ *      - A path number appearing more than once in a frame is removed from the cache.
+ *      - Paths absent from a frame are removed from the cache.
+ *      - If a referenced path is not in the cache with the expected frame number (frame lost), the frame
+ *        can't be rebuilt and is dropped. The sender sends a keyframe (all paths in full) periodically so
+ *        the receiver can recover. Keyframe interval must be lower than 256 frames as frame numbers wrap.
+ *        A receiver displaying partial frames can instead leave such paths out (PathCacheDecodeMode).
+ */
+
+#include "PonkDefs.h"
+#include "PonkDeltaFormat.h"
+#include "PonkPointFormats.h"
+#include "PonkCurveFormat.h"
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+namespace Ponk {
+
+inline unsigned int readU32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<unsigned int>(p[3]) << 24);
+}
+
+inline void pushU32(std::vector<unsigned char>& data, unsigned int value) {
+    data.push_back(static_cast<unsigned char>((value >> 0) & 0xFF));
+    data.push_back(static_cast<unsigned char>((value >> 8) & 0xFF));
+    data.push_back(static_cast<unsigned char>((value >> 16) & 0xFF));
+    data.push_back(static_cast<unsigned char>((value >> 24) & 0xFF));
+}
+
+// Location of one path record in frame data
+struct PathRecord {
+    unsigned char dataFormat = 0;       // Without PONK_DATA_FORMAT_CONTINUATION and PONK_DATA_FORMAT_INDEXED_META_DATA bits
+    bool continuation = false;          // Piece of the previous path (PONK_FLAG_PATH_ALIGNED frames)
+    bool indexedMetaData = false;       // Meta data refer to the frame meta data table (PATHNUMB is then not read)
+    size_t size = 0;                    // Total record size in bytes
+    bool hasPathNumber = false;
+    unsigned int pathNumber = 0;
+    unsigned int baseFrameNumber = 0;   // Reference / diff only
+    unsigned char baseDataFormat = 0;   // Diff only
+    unsigned int pointCount = 0;        // Regular paths only (segment count for PONK_DATA_FORMAT_CURVES)
+    size_t pointsOffset = 0;            // Offset of point data from record start, regular paths only
+};
+
+// Find the extent of the path record starting at data. Returns false if truncated or unknown format.
+inline bool readPathRecord(const unsigned char* data, size_t size, PathRecord& record) {
+    record = PathRecord();
+    if (size < 1) {
+        return false;
+    }
+    record.dataFormat = data[0] & ~(PONK_DATA_FORMAT_CONTINUATION | PONK_DATA_FORMAT_INDEXED_META_DATA);
+    record.continuation = (data[0] & PONK_DATA_FORMAT_CONTINUATION) != 0;
+    record.indexedMetaData = (data[0] & PONK_DATA_FORMAT_INDEXED_META_DATA) != 0;
+
+    if (record.dataFormat == PONK_DATA_FORMAT_META_DATA_TABLE) {
+        if (size < 2 || size < 2 + 12 * static_cast<size_t>(data[1])) {
+            return false;
+        }
+        record.size = 2 + 12 * static_cast<size_t>(data[1]);
+        return true;
+    }
+
+    if (record.dataFormat == PONK_DATA_FORMAT_PATH_TEMPLATE) {
+        // A regular path record carrying PATHNUMB (the template number), cached like any path
+        PathRecord path;
+        if (!readPathRecord(data + 1, size - 1, path) || path.pointsOffset == 0 || path.continuation
+            || path.indexedMetaData || !path.hasPathNumber) {
+            return false;
+        }
+        record.hasPathNumber = true;
+        record.pathNumber = path.pathNumber;
+        record.size = 1 + path.size;
+        return true;
+    }
+
+    if (record.dataFormat == PONK_DATA_FORMAT_PATH_INSTANCES) {
+        // Template number, flags, first path number if flag 0x02, instance count, then the instances
+        if (size < 6) {
+            return false;
+        }
+        const unsigned char flags = data[5];
+        const size_t headerSize = 6 + ((flags & 0x02) ? 4 : 0) + 2;
+        if (size < headerSize) {
+            return false;
+        }
+        const size_t instanceCount = data[headerSize - 2] | (data[headerSize - 1] << 8);
+        const size_t instanceSize = 6 * sizeof(float) + ((flags & 0x01) ? 3 : 0);
+        if (size < headerSize + instanceCount * instanceSize) {
+            return false;
+        }
+        record.size = headerSize + instanceCount * instanceSize;
+        return true;
+    }
+
+    if (record.dataFormat == PONK_DATA_FORMAT_PATH_REFERENCE) {
+        if (size < 6) {
+            return false;
+        }
+        record.hasPathNumber = true;
+        record.pathNumber = readU32(data + 1);
+        record.baseFrameNumber = data[5];
+        record.size = 6;
+        return true;
+    }
+
+    if (record.dataFormat == PONK_DATA_FORMAT_PATH_DIFF) {
+        if (size < 8) {
+            return false;
+        }
+        record.hasPathNumber = true;
+        record.pathNumber = readU32(data + 1);
+        record.baseFrameNumber = data[5];
+        record.baseDataFormat = data[6];
+        const unsigned int stride = fixedPointStride(record.baseDataFormat);
+        if (stride == 0) {
+            return false;
+        }
+        const unsigned int rangeCount = data[7];
+        size_t offset = 8;
+        for (unsigned int i = 0; i < rangeCount; i++) {
+            if (size < offset + 4) {
+                return false;
+            }
+            const unsigned int count = data[offset + 2] | (data[offset + 3] << 8);
+            offset += 4 + static_cast<size_t>(count) * stride;
+        }
+        if (size < offset) {
+            return false;
+        }
+        record.size = offset;
+        return true;
+    }
+
+    if (size < 2) {
+        return false;
+    }
+    const unsigned int metaCount = data[1];
+    size_t offset = 2;
+    if (record.indexedMetaData) {
+        // Key index, followed by the value unless the index has 0x80 set (key absent from this path)
+        for (unsigned int i = 0; i < metaCount; i++) {
+            if (size < offset + 1) {
+                return false;
+            }
+            offset += (data[offset] & 0x80) ? 1 : 5;
+        }
+        if (size < offset + 2) {
+            return false;
+        }
+    } else {
+        if (size < offset + 12 * metaCount + 2) {
+            return false;
+        }
+        for (unsigned int i = 0; i < metaCount; i++) {
+            if (memcmp(data + offset, "PATHNUMB", 8) == 0) {
+                float value;
+                memcpy(&value, data + offset + 8, sizeof(float));
+                // Converting a NaN, infinite or out of range float is undefined: such paths have no path number
+                const float rounded = std::isfinite(value) ? std::floor(value + 0.5f) : 0;
+                record.hasPathNumber = std::isfinite(value) && rounded >= -2147483648.0f && rounded < 2147483648.0f;
+                record.pathNumber = record.hasPathNumber ? static_cast<unsigned int>(static_cast<int>(rounded)) : 0;
+            }
+            offset += 12;
+        }
+    }
+    record.pointCount = data[offset] | (data[offset + 1] << 8);
+    offset += 2;
+    record.pointsOffset = offset;
+
+    size_t pointsSize = 0;
+    const unsigned int stride = fixedPointStride(record.dataFormat);
+    if (stride != 0) {
+        pointsSize = static_cast<size_t>(stride) * record.pointCount;
+    } else if (record.dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE) {
+        if (!deltaPathSize(data + offset, size - offset, record.pointCount, pointsSize)) {
+            return false;
+        }
+    } else if (record.dataFormat == PONK_DATA_FORMAT_CURVES) {
+        if (!curvePathSize(data + offset, size - offset, record.pointCount, pointsSize)) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    if (size < offset + pointsSize) {
+        return false;
+    }
+    record.size = offset + pointsSize;
+    return true;
+}
+
+// Check that diff ranges apply to baseRecord
+inline bool pathDiffMatchesBase(const unsigned char* data, const PathRecord& diffRecord, const PathRecord& baseRecord) {
+    if (diffRecord.baseDataFormat != baseRecord.dataFormat) {
+        return false;
+    }
+    const unsigned int stride = fixedPointStride(baseRecord.dataFormat);
+    const unsigned int rangeCount = data[7];
+    size_t offset = 8;
+    for (unsigned int i = 0; i < rangeCount; i++) {
+        const unsigned int first = data[offset] | (data[offset + 1] << 8);
+        const unsigned int count = data[offset + 2] | (data[offset + 3] << 8);
+        if (first + count > baseRecord.pointCount) {
+            return false;
+        }
+        offset += 4 + static_cast<size_t>(count) * stride;
+    }
+    return true;
+}
+
+// Common cache state for encoder and decoder
+class PathCacheBase {
+public:
+    void clear() {
+        m_entries.clear();
+    }
+
+protected:
+    struct Entry {
+        unsigned char frameNumber = 0;
+        std::vector<unsigned char> record;
+    };
+
+    void beginFrame() {
+        m_seen.clear();
+        m_duplicates.clear();
+    }
+
+    // Returns false if this path number already appeared in the frame
+    bool markSeen(unsigned int pathNumber) {
+        const auto seen = std::lower_bound(m_seen.begin(), m_seen.end(), pathNumber);
+        if (seen != m_seen.end() && *seen == pathNumber) {
+            const auto duplicate = std::lower_bound(m_duplicates.begin(), m_duplicates.end(), pathNumber);
+            if (duplicate == m_duplicates.end() || *duplicate != pathNumber) {
+                m_duplicates.insert(duplicate, pathNumber);
+            }
+            return false;
+        }
+        m_seen.insert(seen, pathNumber);
+        return true;
+    }
+
+    void storeFull(unsigned int pathNumber, unsigned char frameNumber, const unsigned char* record, size_t size) {
+        Entry& entry = m_entries[pathNumber];
+        entry.frameNumber = frameNumber;
+        entry.record.assign(record, record + size);
+    }
+
+    void endFrame() {
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (!std::binary_search(m_seen.begin(), m_seen.end(), it->first)
+                || std::binary_search(m_duplicates.begin(), m_duplicates.end(), it->first)) {
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::unordered_map<unsigned int, Entry> m_entries;
+    // Path numbers of the current frame, sorted: kept between frames so they don't allocate
+    std::vector<unsigned int> m_seen;
+    std::vector<unsigned int> m_duplicates;
+};
+
+// Sender side: rewrite a regular frame, replacing unchanged paths by references or diffs
+class PathCacheEncoder : public PathCacheBase {
+public:
+    // Send all paths in full every 'frames' frames (1 to 255)
+    void setKeyframeInterval(unsigned int frames) {
+        m_keyframeInterval = frames < 1 ? 1 : (frames > 255 ? 255 : frames);
+    }
+
+    // Next frame will be a keyframe
+    void forceKeyframe() {
+        m_framesSinceKeyframe = 0;
+    }
+
+    // Returns false if frame data could not be parsed, out is then a plain copy of frame
+    bool encodeFrame(const std::vector<unsigned char>& frame, unsigned char frameNumber, std::vector<unsigned char>& out) {
+        out.clear();
+        const bool keyframe = (m_framesSinceKeyframe % m_keyframeInterval) == 0;
+        m_framesSinceKeyframe = (m_framesSinceKeyframe + 1) % m_keyframeInterval;
+
+        beginFrame();
+        size_t offset = 0;
+        while (offset < frame.size()) {
+            PathRecord record;
+            if (!readPathRecord(&frame[offset], frame.size() - offset, record) || record.continuation
+                || record.dataFormat == PONK_DATA_FORMAT_PATH_REFERENCE || record.dataFormat == PONK_DATA_FORMAT_PATH_DIFF) {
+                out = frame;
+                clear();
+                forceKeyframe();
+                return false;
+            }
+            const unsigned char* recordData = &frame[offset];
+            offset += record.size;
+
+            if (!record.hasPathNumber || !markSeen(record.pathNumber)) {
+                out.insert(out.end(), recordData, recordData + record.size);
+                continue;
+            }
+
+            auto it = m_entries.find(record.pathNumber);
+            if (!keyframe && it != m_entries.end()) {
+                Entry& entry = it->second;
+                if (entry.record.size() == record.size && memcmp(&entry.record[0], recordData, record.size) == 0) {
+                    out.push_back(PONK_DATA_FORMAT_PATH_REFERENCE);
+                    pushU32(out, record.pathNumber);
+                    out.push_back(entry.frameNumber);
+                    continue;
+                }
+                if (pushDiff(entry, record, recordData, out)) {
+                    entry.frameNumber = frameNumber;
+                    entry.record.assign(recordData, recordData + record.size);
+                    continue;
+                }
+            }
+
+            storeFull(record.pathNumber, frameNumber, recordData, record.size);
+            out.insert(out.end(), recordData, recordData + record.size);
+        }
+        endFrame();
+        return true;
+    }
+
+private:
+    // Write a diff record if the path only changed in a few points and it's worth it
+    static bool pushDiff(const Entry& entry, const PathRecord& record, const unsigned char* recordData, std::vector<unsigned char>& out) {
+        const unsigned int stride = fixedPointStride(record.dataFormat);
+        if (stride == 0 || entry.record.size() != record.size
+            || memcmp(&entry.record[0], recordData, record.pointsOffset) != 0) {
+            return false;
+        }
+
+        // Find ranges of changed points, merging ranges separated by less than a range header
+        const unsigned char* base = &entry.record[record.pointsOffset];
+        const unsigned char* points = recordData + record.pointsOffset;
+        struct Range { unsigned int first, count; };
+        std::vector<Range> ranges;
+        size_t diffSize = 8;
+        for (unsigned int i = 0; i < record.pointCount; i++) {
+            if (memcmp(base + i * stride, points + i * stride, stride) == 0) {
+                continue;
+            }
+            if (!ranges.empty() && (i - (ranges.back().first + ranges.back().count)) * stride < 4) {
+                diffSize += (i + 1 - (ranges.back().first + ranges.back().count)) * stride;
+                ranges.back().count = i + 1 - ranges.back().first;
+            } else {
+                Range range = {i, 1};
+                ranges.push_back(range);
+                diffSize += 4 + stride;
+            }
+            if (ranges.size() > 255 || diffSize * 2 > record.size) {
+                return false;
+            }
+        }
+
+        out.push_back(PONK_DATA_FORMAT_PATH_DIFF);
+        pushU32(out, record.pathNumber);
+        out.push_back(entry.frameNumber);
+        out.push_back(record.dataFormat);
+        out.push_back(static_cast<unsigned char>(ranges.size()));
+        for (const auto& range: ranges) {
+            out.push_back(static_cast<unsigned char>(range.first & 0xFF));
+            out.push_back(static_cast<unsigned char>((range.first >> 8) & 0xFF));
+            out.push_back(static_cast<unsigned char>(range.count & 0xFF));
+            out.push_back(static_cast<unsigned char>((range.count >> 8) & 0xFF));
+            out.insert(out.end(), points + range.first * stride, points + (range.first + range.count) * stride);
+        }
+        return true;
+    }
+
+    unsigned int m_keyframeInterval = 60;
+    unsigned int m_framesSinceKeyframe = 0;
+};
+
+// What PathCacheDecoder::decodeFrame does with references to paths it doesn't have
+enum class PathCacheDecodeMode {
+    Strict,             // Frame can't be rebuilt, decodeFrame fails
+    SkipMissingPaths,   // Missing paths are left out, other paths are rebuilt and cached as usual
+    PartialFrame        // Frame data misses chunks (PONK_FLAG_PATH_ALIGNED): missing paths are left out and
+                        // the cache is left untouched since paths may be incomplete
+};
+
+// Receiver side: rebuild the full frame from references and diffs (one decoder per sender)
+class PathCacheDecoder : public PathCacheBase {
+public:
+    // Returns false if the frame can't be rebuilt (referenced path lost, corrupt data): it should be dropped
+    bool decodeFrame(const unsigned char* frame, size_t size, unsigned char frameNumber, std::vector<unsigned char>& out,
+                     PathCacheDecodeMode mode = PathCacheDecodeMode::Strict) {
+        out.clear();
+        beginFrame();
+        const bool updateCache = mode != PathCacheDecodeMode::PartialFrame;
+        size_t offset = 0;
+        while (offset < size) {
+            PathRecord record;
+            if (!readPathRecord(frame + offset, size - offset, record) || record.continuation) {
+                return false;
+            }
+            const unsigned char* recordData = frame + offset;
+            offset += record.size;
+
+            if (record.dataFormat == PONK_DATA_FORMAT_PATH_REFERENCE || record.dataFormat == PONK_DATA_FORMAT_PATH_DIFF) {
+                auto it = m_entries.find(record.pathNumber);
+                if (it == m_entries.end() || it->second.frameNumber != record.baseFrameNumber) {
+                    if (mode == PathCacheDecodeMode::Strict) {
+                        return false;
+                    }
+                    continue;
+                }
+                markSeen(record.pathNumber);
+                Entry& entry = it->second;
+
+                if (record.dataFormat == PONK_DATA_FORMAT_PATH_REFERENCE) {
+                    out.insert(out.end(), entry.record.begin(), entry.record.end());
+                    continue;
+                }
+
+                PathRecord baseRecord;
+                readPathRecord(&entry.record[0], entry.record.size(), baseRecord);
+                if (!pathDiffMatchesBase(recordData, record, baseRecord)) {
+                    return false;
+                }
+                // Partial frames apply the diff to a copy, leaving the cache untouched
+                const size_t outOffset = out.size();
+                out.insert(out.end(), entry.record.begin(), entry.record.end());
+                unsigned char* target = updateCache ? &entry.record[0] : &out[outOffset];
+                const unsigned int stride = fixedPointStride(baseRecord.dataFormat);
+                const unsigned int rangeCount = recordData[7];
+                size_t diffOffset = 8;
+                for (unsigned int i = 0; i < rangeCount; i++) {
+                    const unsigned int first = recordData[diffOffset] | (recordData[diffOffset + 1] << 8);
+                    const unsigned int count = recordData[diffOffset + 2] | (recordData[diffOffset + 3] << 8);
+                    diffOffset += 4;
+                    memcpy(target + baseRecord.pointsOffset + first * stride, recordData + diffOffset, count * stride);
+                    diffOffset += count * stride;
+                }
+                if (updateCache) {
+                    entry.frameNumber = frameNumber;
+                    memcpy(&out[outOffset], &entry.record[0], entry.record.size());
+                }
+                continue;
+            }
+
+            if (updateCache && record.hasPathNumber && markSeen(record.pathNumber)) {
+                storeFull(record.pathNumber, frameNumber, recordData, record.size);
+            }
+            out.insert(out.end(), recordData, recordData + record.size);
+        }
+        if (updateCache) {
+            endFrame();
+        }
+        return true;
+    }
+};
+
+} // namespace Ponk
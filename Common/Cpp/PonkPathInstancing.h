@@ -0,0 +1,494 @@
+#pragma once
+
+/*
+ *  Path instancing (PONK_DATA_FORMAT_PATH_TEMPLATE / PONK_DATA_FORMAT_PATH_INSTANCES)
+ *
+ *  Generative content often repeats a shape with different transforms (ie 1000 triangles with different
+ *  centers). The sender can send the shape once as a template, then each copy as a transform only:
+ *      - PONK_DATA_FORMAT_PATH_TEMPLATE: a path that is not drawn itself
+ *          - Data format - unsigned char
+ *          - Path record: a regular path (any point format or PONK_DATA_FORMAT_CURVES) carrying PATHNUMB meta
+ *            data, its value is the template number
+ *      - PONK_DATA_FORMAT_PATH_INSTANCES: copies of a template sent before in the frame
+ *          - Data format - unsigned char
+ *          - Template Number - unsigned int
+ *          - Flags - unsigned char: 0x01 instances have a color, 0x02 instances have a path number
+ *          - First Path Number - unsigned int, only with flag 0x02: instance i gets PATHNUMB First Path Number + i
+ *          - Instance Count - unsigned short
+ *          - For each instance:
+ *              - A, B, C, D, TX, TY - 32 bits float: x' = A.x + B.y + TX, y' = C.x + D.y + TY
+ *              - R, G, B - unsigned char, only with flag 0x01: multiplies the template colors (255 keeps them,
+ *                blanked points stay blanked)
+ *  Each instance becomes a path with the template meta data (except PATHNUMB, only set with flag 0x02).
+ *  Templates of point formats give PONK_DATA_FORMAT_XY_F32_RGB_U8 paths, templates of PONK_DATA_FORMAT_CURVES give
+ *  curve paths (arcs are converted to cubic Bezier segments when the transform is not a similarity).
+ *
+ *  The template record is cached by the path cache like any path with PATHNUMB: unchanged templates are sent as
+ *  6 bytes references, so a frame costs about 24 bytes per instance whatever the template size.
+ *  Receivers expand instances after the path cache and before curve tessellation. Frames expanding to more than
+ *  kMaxInstancedPoints points (or curve segments) are rejected: 24 bytes per instance can otherwise ask receivers
+ *  for gigabytes.
+ *
+ *  Sender usage:
+ *      Ponk::writePathTemplate(templatePath, frameData);
+ *      instances.clear();
+ *      instances.addInstance(1, 0, 0, 1, x, y);  // For each copy
+ *      instances.write(templateNumber, frameData);
+ *  Receiver usage:
+ *      if (Ponk::hasPathInstances(data, size) && !expander.expandFrame(data, size, expandedData)) drop frame;
+ */
+
+#include "PonkDefs.h"
+#include "PonkDeltaFormat.h"
+#include "PonkCurveFormat.h"
+#include "PonkHalfFormat.h"
+#include "PonkPathCache.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Ponk {
+
+const unsigned char kPathInstanceColors = 0x01;
+const unsigned char kPathInstancePathNumbers = 0x02;
+
+// Most points (segments and start points of curve templates) the instances of a frame expand to
+const size_t kMaxInstancedPoints = 1000000;
+
+// Parsed header of a PONK_DATA_FORMAT_PATH_INSTANCES record (readPathRecord already checked its size)
+struct PathInstancesHeader {
+    unsigned int templateNumber = 0;
+    unsigned char flags = 0;
+    unsigned int firstPathNumber = 0;
+    unsigned int instanceCount = 0;
+    size_t headerSize = 0;      // Offset of the first instance from record start
+    size_t instanceSize = 0;
+};
+
+inline PathInstancesHeader readPathInstancesHeader(const unsigned char* recordData) {
+    PathInstancesHeader header;
+    header.templateNumber = readU32(recordData + 1);
+    header.flags = recordData[5];
+    size_t offset = 6;
+    if (header.flags & kPathInstancePathNumbers) {
+        header.firstPathNumber = readU32(recordData + offset);
+        offset += 4;
+    }
+    header.instanceCount = recordData[offset] | (recordData[offset + 1] << 8);
+    header.headerSize = offset + 2;
+    header.instanceSize = 6 * sizeof(float) + ((header.flags & kPathInstanceColors) ? 3 : 0);
+    return header;
+}
+
+inline void writePathInstancesHeader(const PathInstancesHeader& header, std::vector<unsigned char>& data) {
+    data.push_back(PONK_DATA_FORMAT_PATH_INSTANCES);
+    pushU32(data, header.templateNumber);
+    data.push_back(header.flags);
+    if (header.flags & kPathInstancePathNumbers) {
+        pushU32(data, header.firstPathNumber);
+    }
+    data.push_back(static_cast<unsigned char>(header.instanceCount & 0xFF));
+    data.push_back(static_cast<unsigned char>((header.instanceCount >> 8) & 0xFF));
+}
+
+// Returns true if the frame has instance records (stops at the first record it can't read)
+inline bool hasPathInstances(const unsigned char* frame, size_t size) {
+    size_t offset = 0;
+    PathRecord record;
+    while (offset < size && readPathRecord(frame + offset, size - offset, record)) {
+        if (record.dataFormat == PONK_DATA_FORMAT_PATH_INSTANCES) {
+            return true;
+        }
+        offset += record.size;
+    }
+    return false;
+}
+
+// Sender side: append a template record for a regular path record (which must carry PATHNUMB meta data)
+inline void writePathTemplate(const std::vector<unsigned char>& path, std::vector<unsigned char>& data) {
+    data.push_back(PONK_DATA_FORMAT_PATH_TEMPLATE);
+    data.insert(data.end(), path.begin(), path.end());
+}
+
+// Sender side: build instance records
+class PathInstanceEncoder {
+public:
+    void clear() {
+        m_instances.clear();
+        m_hasColors = false;
+        m_hasPathNumbers = false;
+    }
+
+    // Instance i gets PATHNUMB firstPathNumber + i (without it, instances have no PATHNUMB)
+    void setFirstPathNumber(unsigned int firstPathNumber) {
+        m_firstPathNumber = firstPathNumber;
+        m_hasPathNumbers = true;
+    }
+
+    // x' = a.x + b.y + tx, y' = c.x + d.y + ty
+    void addInstance(float a, float b, float c, float d, float tx, float ty) {
+        addInstance(a, b, c, d, tx, ty, 0xFF, 0xFF, 0xFF);
+    }
+
+    // Same with a color multiplying template colors
+    void addInstance(float a, float b, float c, float d, float tx, float ty, unsigned char r, unsigned char g, unsigned char bl) {
+        const Instance instance = {{a, b, c, d, tx, ty}, {r, g, bl}};
+        m_instances.push_back(instance);
+        m_hasColors = m_hasColors || r != 0xFF || g != 0xFF || bl != 0xFF;
+    }
+
+    size_t instanceCount() const {
+        return m_instances.size();
+    }
+
+    // Append instance records (more than one if there are more than 65535 instances)
+    void write(unsigned int templateNumber, std::vector<unsigned char>& data) const {
+        for (size_t first = 0; first < m_instances.size(); first += 0xFFFF) {
+            PathInstancesHeader header;
+            header.templateNumber = templateNumber;
+            header.flags = static_cast<unsigned char>((m_hasColors ? kPathInstanceColors : 0)
+                                                      | (m_hasPathNumbers ? kPathInstancePathNumbers : 0));
+            header.firstPathNumber = m_firstPathNumber + static_cast<unsigned int>(first);
+            header.instanceCount = static_cast<unsigned int>(std::min<size_t>(0xFFFF, m_instances.size() - first));
+            writePathInstancesHeader(header, data);
+            for (size_t i = first; i < first + header.instanceCount; i++) {
+                for (float v: m_instances[i].transform) {
+                    unsigned int raw;
+                    memcpy(&raw, &v, sizeof(raw));
+                    pushU32(data, raw);
+                }
+                if (m_hasColors) {
+                    data.insert(data.end(), m_instances[i].color, m_instances[i].color + 3);
+                }
+            }
+        }
+    }
+
+private:
+    struct Instance {
+        float transform[6];
+        unsigned char color[3];
+    };
+
+    std::vector<Instance> m_instances;
+    bool m_hasColors = false;
+    bool m_hasPathNumbers = false;
+    unsigned int m_firstPathNumber = 0;
+};
+
+// Apply x' = a.x + b.y + tx, y' = c.x + d.y + ty to count points. Independent iterations on plain float
+// arrays, so the loop vectorizes.
+inline void transformPoints(const float* transform, const float* xs, const float* ys, unsigned int count,
+                            float* outXs, float* outYs) {
+    const float a = transform[0], b = transform[1], c = transform[2], d = transform[3];
+    const float tx = transform[4], ty = transform[5];
+    for (unsigned int i = 0; i < count; i++) {
+        outXs[i] = a * xs[i] + b * ys[i] + tx;
+        outYs[i] = c * xs[i] + d * ys[i] + ty;
+    }
+}
+
+// Receiver side: replace instance records by the paths they describe (template records are removed)
+class PathInstanceExpander {
+public:
+    // Returns false if frame data can't be parsed, or if instances expand to more than kMaxInstancedPoints points.
+    // Instances of a template missing from the frame (lost chunk of a PONK_FLAG_PATH_ALIGNED frame) are left out,
+    // see missingInstanceCount().
+    bool expandFrame(const unsigned char* frame, size_t size, std::vector<unsigned char>& out) {
+        out.clear();
+        m_templates.clear();
+        m_missingInstanceCount = 0;
+        size_t instancedPointCount = 0;
+        size_t offset = 0;
+        while (offset < size) {
+            PathRecord record;
+            if (!readPathRecord(frame + offset, size - offset, record)) {
+                return false;
+            }
+            const unsigned char* recordData = frame + offset;
+            offset += record.size;
+
+            if (record.dataFormat == PONK_DATA_FORMAT_PATH_TEMPLATE) {
+                Template pathTemplate;
+                pathTemplate.number = record.pathNumber;
+                pathTemplate.data = recordData + 1;
+                readPathRecord(pathTemplate.data, record.size - 1, pathTemplate.record);
+                m_templates.push_back(pathTemplate);
+                continue;
+            }
+            if (record.dataFormat != PONK_DATA_FORMAT_PATH_INSTANCES) {
+                out.insert(out.end(), recordData, recordData + record.size);
+                continue;
+            }
+
+            const PathInstancesHeader header = readPathInstancesHeader(recordData);
+            Template* pathTemplate = findTemplate(header.templateNumber);
+            if (!pathTemplate) {
+                m_missingInstanceCount += header.instanceCount;
+                continue;
+            }
+            if (!pathTemplate->decoded && !decodeTemplate(*pathTemplate)) {
+                return false;
+            }
+            const bool curves = pathTemplate->record.dataFormat == PONK_DATA_FORMAT_CURVES;
+            const size_t templatePointCount = pathTemplate->record.pointCount + (curves ? 1 : 0);
+            instancedPointCount += static_cast<size_t>(header.instanceCount) * templatePointCount;
+            if (instancedPointCount > kMaxInstancedPoints) {
+                return false;
+            }
+            const unsigned char* instance = recordData + header.headerSize;
+            for (unsigned int i = 0; i < header.instanceCount; i++) {
+                float transform[6];
+                memcpy(transform, instance, sizeof(transform));
+                const unsigned char white[3] = {0xFF, 0xFF, 0xFF};
+                const unsigned char* color = (header.flags & kPathInstanceColors) ? instance + sizeof(transform) : white;
+                pushInstanceHeader(*pathTemplate, header, i, out);
+                if (pathTemplate->record.dataFormat == PONK_DATA_FORMAT_CURVES) {
+                    if (!pushCurveInstance(*pathTemplate, transform, color, out)) {
+                        return false;
+                    }
+                } else {
+                    pushPointsInstance(transform, color, out);
+                }
+                instance += header.instanceSize;
+            }
+        }
+        return true;
+    }
+
+    // Instances left out by the last expandFrame because their template was not in the frame
+    unsigned int missingInstanceCount() const {
+        return m_missingInstanceCount;
+    }
+
+private:
+    struct Template {
+        unsigned int number = 0;
+        const unsigned char* data = nullptr;    // Regular path record
+        PathRecord record;
+        bool decoded = false;
+    };
+
+    Template* findTemplate(unsigned int number) {
+        // Last definition wins
+        for (size_t i = m_templates.size(); i > 0; i--) {
+            if (m_templates[i - 1].number == number) {
+                return &m_templates[i - 1];
+            }
+        }
+        return nullptr;
+    }
+
+    // Meta data of the template without PATHNUMB, and points as float arrays for point formats.
+    // Only one template is decoded at a time: consecutive instance records of the same template share it.
+    bool decodeTemplate(Template& pathTemplate) {
+        for (auto& other: m_templates) {
+            other.decoded = false;
+        }
+        const unsigned char* data = pathTemplate.data;
+        const PathRecord& record = pathTemplate.record;
+        m_meta.clear();
+        for (unsigned int i = 0; i < data[1]; i++) {
+            const unsigned char* meta = data + 2 + 12 * i;
+            if (memcmp(meta, "PATHNUMB", 8) != 0) {
+                m_meta.insert(m_meta.end(), meta, meta + 12);
+            }
+        }
+
+        const unsigned int count = record.pointCount;
+        const unsigned char* points = data + record.pointsOffset;
+        m_xs.resize(count);
+        m_ys.resize(count);
+        m_colors.resize(3 * static_cast<size_t>(count));
+        if (record.dataFormat == PONK_DATA_FORMAT_XY_F32_RGB_U8) {
+            for (unsigned int i = 0; i < count; i++) {
+                memcpy(&m_xs[i], points + 11 * i, sizeof(float));
+                memcpy(&m_ys[i], points + 11 * i + 4, sizeof(float));
+                memcpy(&m_colors[3 * i], points + 11 * i + 8, 3);
+            }
+        } else if (record.dataFormat == PONK_DATA_FORMAT_XY_F16_RGB_U8) {
+            decodeHalfPoints(points, count, m_xs.data(), m_ys.data(), m_colors.data());
+        } else if (record.dataFormat == PONK_DATA_FORMAT_XYRGB_U16) {
+            for (unsigned int i = 0; i < count; i++) {
+                const unsigned char* p = points + 10 * i;
+                m_xs[i] = dequantize16(p[0] | (p[1] << 8));
+                m_ys[i] = dequantize16(p[2] | (p[3] << 8));
+                m_colors[3 * i] = p[5];     // High byte of 16 bits colors
+                m_colors[3 * i + 1] = p[7];
+                m_colors[3 * i + 2] = p[9];
+            }
+        } else if (record.dataFormat == PONK_DATA_FORMAT_XY_DELTA_RGB_RLE) {
+            m_deltaPoints.resize(count);
+            size_t bytesRead = 0;
+            if (!decodeDeltaPoints(points, record.size - record.pointsOffset, count, m_deltaPoints.data(), bytesRead)) {
+                return false;
+            }
+            for (unsigned int i = 0; i < count; i++) {
+                m_xs[i] = dequantize16(m_deltaPoints[i].x);
+                m_ys[i] = dequantize16(m_deltaPoints[i].y);
+                m_colors[3 * i] = m_deltaPoints[i].r;
+                m_colors[3 * i + 1] = m_deltaPoints[i].g;
+                m_colors[3 * i + 2] = m_deltaPoints[i].b;
+            }
+        } else if (record.dataFormat != PONK_DATA_FORMAT_CURVES) {
+            return false;
+        }
+        pathTemplate.decoded = true;
+        return true;
+    }
+
+    // Data format, meta data and a point count placeholder (fixed by the push functions)
+    void pushInstanceHeader(const Template& pathTemplate, const PathInstancesHeader& header, unsigned int index,
+                            std::vector<unsigned char>& out) {
+        const bool curves = pathTemplate.record.dataFormat == PONK_DATA_FORMAT_CURVES;
+        out.push_back(curves ? PONK_DATA_FORMAT_CURVES : PONK_DATA_FORMAT_XY_F32_RGB_U8);
+        const bool pathNumber = (header.flags & kPathInstancePathNumbers) != 0;
+        out.push_back(static_cast<unsigned char>(m_meta.size() / 12 + (pathNumber ? 1 : 0)));
+        out.insert(out.end(), m_meta.begin(), m_meta.end());
+        if (pathNumber) {
+            static const char kPathNumberKey[8] = {'P', 'A', 'T', 'H', 'N', 'U', 'M', 'B'};
+            out.insert(out.end(), kPathNumberKey, kPathNumberKey + 8);
+            pushFloat(out, static_cast<float>(header.firstPathNumber + index));
+        }
+        m_countOffset = out.size();
+        out.push_back(0);
+        out.push_back(0);
+    }
+
+    void pushPointsInstance(const float* transform, const unsigned char* color, std::vector<unsigned char>& out) {
+        const unsigned int count = static_cast<unsigned int>(m_xs.size());
+        setCount(out, count);
+        m_outXs.resize(count);
+        m_outYs.resize(count);
+        transformPoints(transform, m_xs.data(), m_ys.data(), count, m_outXs.data(), m_outYs.data());
+        const size_t pointOffset = out.size();
+        out.resize(pointOffset + 11 * static_cast<size_t>(count));
+        unsigned char* point = &out[pointOffset];
+        for (unsigned int i = 0; i < count; i++) {
+            memcpy(point, &m_outXs[i], sizeof(float));
+            memcpy(point + 4, &m_outYs[i], sizeof(float));
+            point[8] = multiplyColor(m_colors[3 * i], color[0]);
+            point[9] = multiplyColor(m_colors[3 * i + 1], color[1]);
+            point[10] = multiplyColor(m_colors[3 * i + 2], color[2]);
+            point += 11;
+        }
+    }
+
+    // Returns false if converting arcs would make more than 65535 segments
+    bool pushCurveInstance(const Template& pathTemplate, const float* transform, const unsigned char* color,
+                           std::vector<unsigned char>& out) {
+        const unsigned char* segment = pathTemplate.data + pathTemplate.record.pointsOffset;
+        float x = curveReadFloat(segment);
+        float y = curveReadFloat(segment + 4);
+        pushPoint(out, transform, x, y);
+        pushColor(out, segment + 8, color);
+        segment += kCurveStartPointSize;
+
+        // Similarities (rotation, uniform scale, translation, optionally mirrored) keep arcs circular
+        const float a = transform[0], b = transform[1], c = transform[2], d = transform[3];
+        const float epsilon = 1e-6f * (std::fabs(a) + std::fabs(b) + std::fabs(c) + std::fabs(d));
+        const bool similarity = std::fabs(a - d) <= epsilon && std::fabs(b + c) <= epsilon;
+        const bool mirrored = std::fabs(a + d) <= epsilon && std::fabs(b - c) <= epsilon;
+
+        unsigned int segmentCount = 0;
+        for (unsigned int i = 0; i < pathTemplate.record.pointCount; i++) {
+            const unsigned char type = segment[0];
+            const unsigned char* p = segment + 1;
+            float endX, endY;
+            curveSegmentEnd(segment, x, y, endX, endY);
+            if (type == kCurveSegmentArc && !similarity && !mirrored) {
+                segmentCount += pushArcAsCubics(out, transform, x, y, curveReadFloat(p), curveReadFloat(p + 4),
+                                                curveReadFloat(p + 8), curveSegmentColor(segment), color);
+            } else if (type == kCurveSegmentArc) {
+                out.push_back(type);
+                pushPoint(out, transform, curveReadFloat(p), curveReadFloat(p + 4));
+                pushFloat(out, mirrored ? -curveReadFloat(p + 8) : curveReadFloat(p + 8));
+                pushColor(out, curveSegmentColor(segment), color);
+                segmentCount++;
+            } else {
+                // Lines and Bezier segments only have points
+                out.push_back(type);
+                const unsigned char* end = curveSegmentColor(segment);
+                for (; p < end; p += 8) {
+                    pushPoint(out, transform, curveReadFloat(p), curveReadFloat(p + 4));
+                }
+                pushColor(out, end, color);
+                segmentCount++;
+            }
+            x = endX;
+            y = endY;
+            segment += curveSegmentSize(type);
+        }
+        if (segmentCount > 0xFFFF) {
+            return false;
+        }
+        setCount(out, segmentCount);
+        return true;
+    }
+
+    // Approximate an arc from x,y with cubic Bezier segments of at most 90 degrees (transformed), returns their count
+    unsigned int pushArcAsCubics(std::vector<unsigned char>& out, const float* transform, float x, float y,
+                                 float centerX, float centerY, float sweep, const unsigned char* segmentColor,
+                                 const unsigned char* color) {
+        const unsigned int count = std::max(1u, static_cast<unsigned int>(std::ceil(std::fabs(sweep) / (3.14159265358979323846 / 2) - 1e-6)));
+        const double angle = static_cast<double>(sweep) / count;
+        const double k = 4.0 / 3.0 * std::tan(angle / 4);
+        double rx = x - centerX;
+        double ry = y - centerY;
+        for (unsigned int i = 0; i < count; i++) {
+            const double nextRx = rx * std::cos(angle) - ry * std::sin(angle);
+            const double nextRy = rx * std::sin(angle) + ry * std::cos(angle);
+            out.push_back(kCurveSegmentCubic);
+            pushPoint(out, transform, static_cast<float>(centerX + rx - k * ry), static_cast<float>(centerY + ry + k * rx));
+            pushPoint(out, transform, static_cast<float>(centerX + nextRx + k * nextRy),
+                      static_cast<float>(centerY + nextRy - k * nextRx));
+            pushPoint(out, transform, static_cast<float>(centerX + nextRx), static_cast<float>(centerY + nextRy));
+            pushColor(out, segmentColor, color);
+            rx = nextRx;
+            ry = nextRy;
+        }
+        return count;
+    }
+
+    void setCount(std::vector<unsigned char>& out, unsigned int count) {
+        out[m_countOffset] = static_cast<unsigned char>(count & 0xFF);
+        out[m_countOffset + 1] = static_cast<unsigned char>((count >> 8) & 0xFF);
+    }
+
+    static unsigned char multiplyColor(unsigned int value, unsigned int factor) {
+        return static_cast<unsigned char>((value * factor + 127) / 255);
+    }
+
+    static void pushFloat(std::vector<unsigned char>& out, float value) {
+        unsigned int raw;
+        memcpy(&raw, &value, sizeof(raw));
+        pushU32(out, raw);
+    }
+
+    static void pushPoint(std::vector<unsigned char>& out, const float* transform, float x, float y) {
+        pushFloat(out, transform[0] * x + transform[1] * y + transform[4]);
+        pushFloat(out, transform[2] * x + transform[3] * y + transform[5]);
+    }
+
+    static void pushColor(std::vector<unsigned char>& out, const unsigned char* templateColor, const unsigned char* color) {
+        for (int i = 0; i < 3; i++) {
+            out.push_back(multiplyColor(templateColor[i], color[i]));
+        }
+    }
+
+    std::vector<Template> m_templates;
+    unsigned int m_missingInstanceCount = 0;
+    size_t m_countOffset = 0;
+    // Decoded template
+    std::vector<unsigned char> m_meta;
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+    std::vector<unsigned char> m_colors;
+    std::vector<DeltaPoint> m_deltaPoints;
+    // Transformed points of an instance
+    std::vector<float> m_outXs;
+    std::vector<float> m_outYs;
+};
+
+} // namespace Ponk
@@ -0,0 +1,191 @@
+#pragma once
+
+/*
+ *  Compile-time description of fixed size point formats
+ *
+ *  Each fixed size point format has a PointFormat specialization giving its stride, where its components are and
+ *  how they are normalized (X,Y to [-1,+1], colors to [0,1]). Decode and encode kernels are templates instantiated
+ *  per format: callers switch on the data format once per path (dispatchPointFormat), so per point loops have no
+ *  branches. Adding a fixed size point format means adding its PointFormat specialization and a dispatchPointFormat
+ *  case; path cache diffs, path aligned splitting, FrameView and PathWriter then handle it.
+ *
+ *  Usage (visitors are classes at namespace or class scope, local classes can't have member templates):
+ *      struct DecodeVisitor {
+ *          template <class Format> void visit() { PointKernels<Format>::decode(data, count, points); }
+ *          ...
+ *      };
+ *      DecodeVisitor visitor = { data, count, points };
+ *      if (!dispatchPointFormat(dataFormat, visitor)) ... // not a fixed size point format
+ */
+
+#include "PonkDefs.h"
+#include "PonkDeltaFormat.h"
+#include "PonkHalfFormat.h"
+#include <cstring>
+
+namespace Ponk {
+
+template <unsigned char DataFormat>
+struct PointFormat;
+
+// X,Y,R,G,B as unsigned short, X,Y mapped from [0,65535] to [-1,+1]
+template <>
+struct PointFormat<PONK_DATA_FORMAT_XYRGB_U16> {
+    enum {
+        kDataFormat = PONK_DATA_FORMAT_XYRGB_U16,
+        kStride = 5 * sizeof(unsigned short),
+        kXOffset = 0,
+        kYOffset = 2,
+        kColorOffset = 4,   // R, then G and B every kColorSize bytes
+        kColorSize = 2
+    };
+
+    static float decodePosition(const unsigned char* p) {
+        return dequantize16(p[0] | (p[1] << 8));
+    }
+
+    static float decodeColor(const unsigned char* p) {
+        return (p[0] | (p[1] << 8)) / 65535.f;
+    }
+
+    static void encodePosition(float v, unsigned char* p) {
+        const unsigned short q = quantize16(v);
+        p[0] = static_cast<unsigned char>(q & 0xFF);
+        p[1] = static_cast<unsigned char>(q >> 8);
+    }
+
+    static void encodeColor(float c, unsigned char* p) {
+        const unsigned short q = static_cast<unsigned short>((c < 0 ? 0 : (c > 1 ? 1 : c)) * 65535.f + 0.5f);
+        p[0] = static_cast<unsigned char>(q & 0xFF);
+        p[1] = static_cast<unsigned char>(q >> 8);
+    }
+};
+
+// X,Y as float 32, R,G,B as unsigned char
+template <>
+struct PointFormat<PONK_DATA_FORMAT_XY_F32_RGB_U8> {
+    enum {
+        kDataFormat = PONK_DATA_FORMAT_XY_F32_RGB_U8,
+        kStride = 2 * sizeof(float) + 3,
+        kXOffset = 0,
+        kYOffset = 4,
+        kColorOffset = 8,
+        kColorSize = 1
+    };
+
+    static float decodePosition(const unsigned char* p) {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static float decodeColor(const unsigned char* p) {
+        return p[0] / 255.f;
+    }
+
+    static void encodePosition(float v, unsigned char* p) {
+        memcpy(p, &v, sizeof(v));
+    }
+
+    static void encodeColor(float c, unsigned char* p) {
+        p[0] = static_cast<unsigned char>((c < 0 ? 0 : (c > 1 ? 1 : c)) * 255.f + 0.5f);
+    }
+};
+
+// X,Y as half float, R,G,B as unsigned char (see PonkHalfFormat.h)
+template <>
+struct PointFormat<PONK_DATA_FORMAT_XY_F16_RGB_U8> {
+    enum {
+        kDataFormat = PONK_DATA_FORMAT_XY_F16_RGB_U8,
+        kStride = 2 * sizeof(unsigned short) + 3,
+        kXOffset = 0,
+        kYOffset = 2,
+        kColorOffset = 4,
+        kColorSize = 1
+    };
+
+    static float decodePosition(const unsigned char* p) {
+        return halfToFloat(static_cast<unsigned short>(p[0] | (p[1] << 8)));
+    }
+
+    static float decodeColor(const unsigned char* p) {
+        return p[0] / 255.f;
+    }
+
+    static void encodePosition(float v, unsigned char* p) {
+        const unsigned short h = floatToHalf(v);
+        p[0] = static_cast<unsigned char>(h & 0xFF);
+        p[1] = static_cast<unsigned char>(h >> 8);
+    }
+
+    static void encodeColor(float c, unsigned char* p) {
+        p[0] = static_cast<unsigned char>((c < 0 ? 0 : (c > 1 ? 1 : c)) * 255.f + 0.5f);
+    }
+};
+
+// Calls visitor.visit<PointFormat<dataFormat>>(). Returns false if dataFormat is not a fixed size point format.
+template <class Visitor>
+bool dispatchPointFormat(unsigned char dataFormat, Visitor& visitor) {
+    switch (dataFormat) {
+    case PONK_DATA_FORMAT_XYRGB_U16:
+        visitor.template visit<PointFormat<PONK_DATA_FORMAT_XYRGB_U16> >();
+        return true;
+    case PONK_DATA_FORMAT_XY_F32_RGB_U8:
+        visitor.template visit<PointFormat<PONK_DATA_FORMAT_XY_F32_RGB_U8> >();
+        return true;
+    case PONK_DATA_FORMAT_XY_F16_RGB_U8:
+        visitor.template visit<PointFormat<PONK_DATA_FORMAT_XY_F16_RGB_U8> >();
+        return true;
+    }
+    return false;
+}
+
+struct PointStrideVisitor {
+    template <class Format>
+    void visit() {
+        stride = Format::kStride;
+    }
+
+    unsigned int stride;
+};
+
+// Bytes per point of fixed size point formats, 0 for other formats
+inline unsigned int fixedPointStride(unsigned char dataFormat) {
+    PointStrideVisitor visitor = { 0 };
+    dispatchPointFormat(dataFormat, visitor);
+    return visitor.stride;
+}
+
+template <class Format>
+struct PointKernels {
+    // count points from data to 'points' (pointer to any type with float x,y,r,g,b members, or PointArrays)
+    template <class Points>
+    static void decode(const unsigned char* data, unsigned int count, Points points) {
+        for (unsigned int i = 0; i < count; i++) {
+            const unsigned char* p = data + static_cast<size_t>(i) * Format::kStride;
+            points[i].x = Format::decodePosition(p + Format::kXOffset);
+            points[i].y = Format::decodePosition(p + Format::kYOffset);
+            points[i].r = Format::decodeColor(p + Format::kColorOffset);
+            points[i].g = Format::decodeColor(p + Format::kColorOffset + Format::kColorSize);
+            points[i].b = Format::decodeColor(p + Format::kColorOffset + 2 * Format::kColorSize);
+        }
+    }
+
+    // One point to p (kStride bytes), X,Y in [-1,+1] and colors in [0,1]
+    static void encode(float x, float y, float r, float g, float b, unsigned char* p) {
+        Format::encodePosition(x, p + Format::kXOffset);
+        Format::encodePosition(y, p + Format::kYOffset);
+        Format::encodeColor(r, p + Format::kColorOffset);
+        Format::encodeColor(g, p + Format::kColorOffset + Format::kColorSize);
+        Format::encodeColor(b, p + Format::kColorOffset + 2 * Format::kColorSize);
+    }
+};
+
+// Half floats are converted by blocks, so F16C can be used
+template <>
+template <class Points>
+void PointKernels<PointFormat<PONK_DATA_FORMAT_XY_F16_RGB_U8> >::decode(const unsigned char* data, unsigned int count, Points points) {
+    decodeHalfPath(data, static_cast<size_t>(count) * kHalfPointSize, count, points);
+}
+
+} // namespace Ponk
@@ -0,0 +1,343 @@
+#pragma once
+
+/*
+ *  Frame reassembly buffer
+ *
+ *  Receivers write the data chunk payloads of a frame straight into one buffer, at the offset of their chunk
+ *  number, instead of keeping a vector per chunk and concatenating them once the frame is complete. Chunks are
+ *  tracked with a bitmap and a received count, so duplicates and completion are checked without scanning chunks.
+ *
+ *  Chunk i is written at i * slotSize. The slot size is the largest payload (decompressed size for compressed
+ *  chunks) seen from this sender, it is kept between frames: with a steady sender all chunks but the last fill
+ *  their slot, the frame is contiguous as soon as it is complete and finish() moves nothing. When a bigger chunk
+ *  arrives (path aligned or compressed frames), slots are enlarged and the chunks already received moved to their
+ *  new offset; finish() then packs the chunks in place. The buffer only grows: once a sender reached its frame
+ *  size, assembling frames does not allocate. Chunks which would take it past kMaxFrameSize are rejected, so a
+ *  bogus chunk count or chunk number can't make a receiver allocate gigabytes.
+ *
+ *  Receiver usage (one buffer per sender):
+ *      assembly.start(header.chunkCount);                            // first chunk of a frame
+ *      if (assembly.received(header.chunkNumber)) continue;          // duplicate
+ *      compressed ? assembly.storeCompressedChunk(header.chunkNumber, payload, payloadSize)
+ *                 : assembly.storeChunk(header.chunkNumber, payload, payloadSize);
+ *      if (assembly.complete()) {
+ *          size_t size = 0;
+ *          const unsigned char* data = assembly.finish(size);     // valid until the next start()
+ *          ...
+ *      }
+ *
+ *  Frame window
+ *
+ *  Paced or multi-path senders can interleave frames: the first chunks of frame N+1 arrive before the last ones
+ *  of frame N. FrameAssemblyWindow assembles up to kFrameWindowSize frames of a sender at once, keyed by frame
+ *  number. Frames are released in order: when a frame completes, the older frames still assembling are
+ *  superseded and dropped (a receiver could show what it got of them first, with path aligned frames). Chunks of
+ *  released or dropped frames are then ignored. When a chunk of a new frame arrives with all assemblies in use,
+ *  the oldest frame is dropped.
+ *
+ *  Receiver usage (Assembly has an int64_t frameNumber, -1 when unused, and a reset() method):
+ *      auto dropFrame = [&](Assembly& assembly) { ... show partial frame ... };
+ *      Assembly* assembly = window.acquire(header.frameNumber, header.protocolVersion, dropFrame);
+ *      if (!assembly) continue;                                    // late chunk
+ *      if (assembly->frameNumber == -1) ... start the frame ...
+ *      ... store chunk, then once the frame is complete:
+ *      window.release(*assembly, dropFrame);                       // resets the assembly
+ */
+
+#include "PonkDefs.h"
+#include "PonkCompression.h"
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+namespace Ponk {
+
+// Largest frame a FrameAssemblyBuffer assembles (chunk count times slot size)
+const size_t kMaxFrameSize = 64 * 1024 * 1024;
+
+// Largest chunk payload, decompressed size of compressed chunks included
+const size_t kMaxChunkPayloadSize = kCompressionMaxBlockSize;
+
+class FrameAssemblyBuffer {
+public:
+    // Prepare a frame of chunkCount data chunks and drop the chunks of the previous frame
+    void start(unsigned int chunkCount) {
+        const size_t wordCount = (chunkCount + 63) / 64;
+        if (m_bitmap.size() < wordCount) {
+            m_bitmap.resize(wordCount, 0);
+        }
+        if (m_sizes.size() < chunkCount) {
+            m_sizes.resize(chunkCount, 0);
+        }
+        clear();
+        m_chunkCount = chunkCount;
+    }
+
+    // Drop received chunks (the slot size and buffer are kept for the next frame)
+    void clear() {
+        const size_t wordCount = (m_chunkCount + 63) / 64;
+        for (size_t i = 0; i < wordCount; i++) {
+            m_bitmap[i] = 0;
+        }
+        m_chunkCount = 0;
+        m_receivedCount = 0;
+        m_receivedBytes = 0;
+        m_packed = false;
+    }
+
+    unsigned int chunkCount() const {
+        return m_chunkCount;
+    }
+
+    unsigned int receivedCount() const {
+        return m_receivedCount;
+    }
+
+    // Sum of the (decompressed) sizes of received chunks
+    size_t receivedBytes() const {
+        return m_receivedBytes;
+    }
+
+    bool complete() const {
+        return m_chunkCount > 0 && m_receivedCount == m_chunkCount;
+    }
+
+    bool received(unsigned int chunkNumber) const {
+        return (m_bitmap[chunkNumber / 64] >> (chunkNumber % 64)) & 1;
+    }
+
+    // So the buffer can be passed where a std::vector<bool> of received chunks is expected (writeNack)
+    bool operator[](unsigned int chunkNumber) const {
+        return received(chunkNumber);
+    }
+
+    // Copy an uncompressed chunk payload to its slot. Returns false if the chunk number is out of range, the
+    // chunk was already received, the frame was finished, or it would be larger than kMaxFrameSize.
+    bool storeChunk(unsigned int chunkNumber, const unsigned char* payload, size_t size) {
+        unsigned char* slot = acquireSlot(chunkNumber, size);
+        if (slot == nullptr) {
+            return false;
+        }
+        if (size > 0) {
+            memcpy(slot, payload, size);
+        }
+        markReceived(chunkNumber, size);
+        return true;
+    }
+
+    // Decompress a PONK_FLAG_COMPRESSED chunk payload straight into its slot. Returns false in the same cases
+    // as storeChunk, and if the payload is corrupt (the chunk is then not received).
+    bool storeCompressedChunk(unsigned int chunkNumber, const unsigned char* payload, size_t size) {
+        if (size < 2) {
+            return false;
+        }
+        const size_t rawSize = payload[0] | (payload[1] << 8);
+        if ((rawSize == 0 && size != 2) || rawSize > kMaxChunkPayloadSize) {
+            return false;
+        }
+        unsigned char* slot = acquireSlot(chunkNumber, rawSize);
+        if (slot == nullptr) {
+            return false;
+        }
+        if (rawSize > 0 && !decompressBlock(payload + 2, size - 2, slot, rawSize)) {
+            return false;
+        }
+        markReceived(chunkNumber, rawSize);
+        return true;
+    }
+
+    // Received chunk data, until finish() is called
+    const unsigned char* chunk(unsigned int chunkNumber) const {
+        return m_data.data() + static_cast<size_t>(chunkNumber) * m_slotSize;
+    }
+
+    size_t chunkSize(unsigned int chunkNumber) const {
+        return m_sizes[chunkNumber];
+    }
+
+    // Pack the chunks of a complete frame next to each other (in place) and return the frame data, valid until
+    // the next start() (clear() keeps it). Returns nullptr if the frame is not complete.
+    const unsigned char* finish(size_t& size) {
+        if (!complete()) {
+            size = 0;
+            return nullptr;
+        }
+        if (!m_packed) {
+            unsigned char* data = m_data.data();
+            size_t offset = 0;
+            for (unsigned int i = 0; i < m_chunkCount; i++) {
+                const size_t slotOffset = static_cast<size_t>(i) * m_slotSize;
+                if (slotOffset != offset && m_sizes[i] > 0) {
+                    memmove(data + offset, data + slotOffset, m_sizes[i]);
+                }
+                offset += m_sizes[i];
+            }
+            m_packed = true;
+        }
+        size = m_receivedBytes;
+        return m_data.data();
+    }
+
+private:
+    unsigned char* acquireSlot(unsigned int chunkNumber, size_t size) {
+        if (chunkNumber >= m_chunkCount || received(chunkNumber) || m_packed || size > kMaxChunkPayloadSize) {
+            return nullptr;
+        }
+        if (size > m_slotSize) {
+            if (static_cast<size_t>(m_chunkCount) * size > kMaxFrameSize) {
+                return nullptr;
+            }
+            enlargeSlots(size);
+        }
+        if (static_cast<size_t>(chunkNumber + 1) * m_slotSize > kMaxFrameSize) {
+            return nullptr;
+        }
+        reserveSlots(chunkNumber + 1, m_slotSize);
+        return m_data.data() + static_cast<size_t>(chunkNumber) * m_slotSize;
+    }
+
+    void markReceived(unsigned int chunkNumber, size_t size) {
+        m_bitmap[chunkNumber / 64] |= 1ull << (chunkNumber % 64);
+        m_sizes[chunkNumber] = static_cast<unsigned int>(size);
+        m_receivedCount++;
+        m_receivedBytes += size;
+    }
+
+    // The buffer grows with the chunk numbers received, so the first chunks of a big frame don't allocate all of it
+    void reserveSlots(unsigned int slotCount, size_t slotSize) {
+        const size_t size = static_cast<size_t>(slotCount) * slotSize;
+        if (m_data.size() < size) {
+            m_data.resize(size);
+        }
+    }
+
+    // Move received chunks to their offset with bigger slots, last chunk first so none is overwritten. Only the
+    // slots of this frame's chunks are enlarged, the caller checked they fit in kMaxFrameSize.
+    void enlargeSlots(size_t slotSize) {
+        size_t slotCount = m_data.size() / m_slotSize;
+        if (slotCount > m_chunkCount) {
+            slotCount = m_chunkCount;
+        }
+        reserveSlots(static_cast<unsigned int>(slotCount), slotSize);
+        unsigned char* data = m_data.data();
+        for (unsigned int i = m_chunkCount; i-- > 0;) {
+            if (received(i) && m_sizes[i] > 0) {
+                memmove(data + static_cast<size_t>(i) * slotSize, data + static_cast<size_t>(i) * m_slotSize, m_sizes[i]);
+            }
+        }
+        m_slotSize = slotSize;
+    }
+
+    std::vector<unsigned char> m_data;
+    std::vector<unsigned long long> m_bitmap;   // Received chunks
+    std::vector<unsigned int> m_sizes;          // Size of each received chunk
+    size_t m_slotSize = PONK_MAX_CHUNK_SIZE;
+    unsigned int m_chunkCount = 0;
+    unsigned int m_receivedCount = 0;
+    size_t m_receivedBytes = 0;
+    bool m_packed = false;
+};
+
+const unsigned int kFrameWindowSize = 4;
+
+// Frames up to this far behind the last released one are late, further behind the sender restarted
+const unsigned int kMaxLateFrames = 64;
+
+// Frame numbers wrap: 8 bits before protocol version 2, 32 bits after
+inline unsigned int frameNumberMask(unsigned char protocolVersion) {
+    return protocolVersion < 2 ? 0xFFu : 0xFFFFFFFFu;
+}
+
+// Number of frames from 'from' to 'to', negative if 'to' is before 'from'
+inline int64_t frameNumberDistance(int64_t from, int64_t to, unsigned int mask) {
+    const unsigned int forward = static_cast<unsigned int>(to - from) & mask;
+    return forward <= mask / 2 ? static_cast<int64_t>(forward) : static_cast<int64_t>(forward) - mask - 1;
+}
+
+template <class Assembly>
+class FrameAssemblyWindow {
+public:
+    // Assembly of the frame, a free assembly (frameNumber -1) for a new frame, or nullptr for chunks of frames
+    // already released or dropped. dropFrame(Assembly&) is called before the oldest assembly is reused.
+    template <class DropFrame>
+    Assembly* acquire(unsigned int frameNumber, unsigned char protocolVersion, DropFrame dropFrame) {
+        m_mask = frameNumberMask(protocolVersion);
+        if (m_lastReleased != -1) {
+            const int64_t distance = frameNumberDistance(m_lastReleased, frameNumber, m_mask);
+            if (distance <= 0 && distance >= -static_cast<int64_t>(kMaxLateFrames)) {
+                return nullptr;
+            }
+            if (distance < 0) {
+                // Sender restarted: frames being assembled are from its previous run
+                for (unsigned int i = 0; i < kFrameWindowSize; i++) {
+                    m_assemblies[i].reset();
+                }
+                m_lastReleased = -1;
+            }
+        }
+
+        Assembly* available = nullptr;
+        Assembly* oldest = nullptr;
+        for (unsigned int i = 0; i < kFrameWindowSize; i++) {
+            Assembly& assembly = m_assemblies[i];
+            if (assembly.frameNumber == static_cast<int64_t>(frameNumber)) {
+                return &assembly;
+            }
+            if (assembly.frameNumber == -1) {
+                available = &assembly;
+            } else if (!oldest || frameNumberDistance(assembly.frameNumber, oldest->frameNumber, m_mask) > 0) {
+                oldest = &assembly;
+            }
+        }
+        if (available) {
+            return available;
+        }
+        drop(*oldest, dropFrame);
+        return oldest;
+    }
+
+    // Release a complete frame: older frames being assembled are dropped (oldest first), then the assembly is reset
+    template <class DropFrame>
+    void release(Assembly& released, DropFrame dropFrame) {
+        while (true) {
+            Assembly* oldest = nullptr;
+            for (unsigned int i = 0; i < kFrameWindowSize; i++) {
+                Assembly& assembly = m_assemblies[i];
+                if (assembly.frameNumber != -1 && frameNumberDistance(assembly.frameNumber, released.frameNumber, m_mask) > 0
+                    && (!oldest || frameNumberDistance(assembly.frameNumber, oldest->frameNumber, m_mask) > 0)) {
+                    oldest = &assembly;
+                }
+            }
+            if (!oldest) {
+                break;
+            }
+            drop(*oldest, dropFrame);
+        }
+        m_lastReleased = released.frameNumber;
+        released.reset();
+    }
+
+    // Assemblies in use have a frameNumber other than -1
+    Assembly& operator[](unsigned int i) {
+        return m_assemblies[i];
+    }
+
+    unsigned int size() const {
+        return kFrameWindowSize;
+    }
+
+private:
+    template <class DropFrame>
+    void drop(Assembly& assembly, DropFrame& dropFrame) {
+        dropFrame(assembly);
+        m_lastReleased = assembly.frameNumber;
+        assembly.reset();
+    }
+
+    Assembly m_assemblies[kFrameWindowSize];
+    int64_t m_lastReleased = -1;    // Last frame released or dropped
+    unsigned int m_mask = 0xFFFFFFFFu;
+};
+
+} // namespace Ponk
@@ -0,0 +1,229 @@
+#pragma once
+
+/*
+ *  Selective chunk retransmission ("PONK-NAK" messages)
+ *
+ *  Forward error correction (PonkFec.h) rebuilds a few lost chunks per frame without any round trip. On lossy
+ *  links, frames of many chunks can still miss more than that: receivers can then ask the sender for the
+ *  missing chunks only. Once no chunk of an incomplete frame arrived for a short delay (a few milliseconds,
+ *  the rest of the frame is lost rather than late), the receiver sends a NACK with a bitmap of the missing
+ *  chunks to the source address of the sender frames. Senders keep the packets of their last frames and resend
+ *  the requested chunks unchanged to the source address of the NACK (so in unicast even with multicast frames).
+ *
+ *  This trades a few milliseconds of latency on incomplete frames for complete frames. Retransmitted chunks
+ *  must arrive before the next frame starts, so senders should read NACKs before sending a new frame.
+ *
+ *  Sender usage:
+ *      // Poll the sending socket before sending a frame
+ *      while (socket.recvFrom(addr, buffer, size) && size > 0) {
+ *          if (retransmitBuffer.readNack(buffer, size, senderIdentifier, packets))
+ *              for (const auto* packet: packets) socket.sendTo(addr, packet->data(), packet->size());
+ *      }
+ *      ... send chunker packets ...
+ *      retransmitBuffer.storeFrame(chunker);
+ *
+ *  Receiver usage (one NackTimer per frame being assembled):
+ *      nackTimer.chunkReceived();    // each chunk of the frame
+ *      nackTimer.reset();            // frame completed or dropped
+ *      // When no packet is pending:
+ *      if (nackTimer.due() && Ponk::writeNack(senderIdentifier, frameNumber, received, chunkCount, packet))
+ *          socket.sendTo(senderAddr, packet.data(), packet.size());
+ */
+
+#include "PonkDefs.h"
+#include "PonkHeader.h"
+#include "PonkChunker.h"
+#include "PonkClock.h"
+#include <vector>
+#include <cstring>
+
+namespace Ponk {
+
+// Bitmap size limit, so a NACK always fits a standard chunk size
+const unsigned int kMaxNackChunkRange = 8 * 1024;
+
+// Write a NACK for the chunks of [0, chunkCount) not flagged in received (std::vector<bool>, FrameAssemblyBuffer or
+// anything with a bool operator[]). Returns false if no chunk is missing.
+// Only the first kMaxNackChunkRange chunks from the first missing one are requested, following NACKs ask for the rest.
+template <class ReceivedChunks>
+bool writeNack(unsigned int senderIdentifier, unsigned int frameNumber, const ReceivedChunks& received,
+               unsigned int chunkCount, std::vector<unsigned char>& packet) {
+    unsigned int first = 0;
+    while (first < chunkCount && received[first]) {
+        first++;
+    }
+    if (first == chunkCount) {
+        return false;
+    }
+    unsigned int last = chunkCount - 1;
+    while (received[last]) {
+        last--;
+    }
+    if (last - first >= kMaxNackChunkRange) {
+        last = first + kMaxNackChunkRange - 1;
+    }
+    const unsigned int range = last - first + 1;
+
+    GeomUdpNack message;
+    memcpy(message.headerString, PONK_NACK_STRING, sizeof(message.headerString));
+    message.protocolVersion = 3;
+    message.senderIdentifier = senderIdentifier;
+    message.frameNumber = frameNumber;
+    message.firstChunk = static_cast<unsigned short>(first);
+    message.chunkRange = static_cast<unsigned short>(range);
+    packet.assign(sizeof(message) + (range + 7) / 8, 0);
+    memcpy(packet.data(), &message, sizeof(message));
+    unsigned char* bitmap = packet.data() + sizeof(message);
+    for (unsigned int i = 0; i < range; i++) {
+        if (!received[first + i]) {
+            bitmap[i / 8] |= static_cast<unsigned char>(1 << (i % 8));
+        }
+    }
+    return true;
+}
+
+// Returns false if the buffer is not a valid NACK, otherwise fills missingChunks with the requested chunk numbers
+inline bool readNack(const unsigned char* buffer, size_t size, GeomUdpNack& message, std::vector<unsigned int>& missingChunks) {
+    if (size < sizeof(GeomUdpNack) || strncmp(reinterpret_cast<const char*>(buffer), PONK_NACK_STRING, 8) != 0) {
+        return false;
+    }
+    memcpy(&message, buffer, sizeof(message));
+    const size_t bitmapSize = (message.chunkRange + 7u) / 8;
+    if (size < sizeof(GeomUdpNack) + bitmapSize) {
+        return false;
+    }
+    const unsigned char* bitmap = buffer + sizeof(GeomUdpNack);
+    missingChunks.clear();
+    for (unsigned int i = 0; i < message.chunkRange; i++) {
+        if (bitmap[i / 8] & (1 << (i % 8))) {
+            missingChunks.push_back(message.firstChunk + i);
+        }
+    }
+    return true;
+}
+
+// Sender side: packets of the last frames sent, to answer NACKs
+class RetransmitBuffer {
+public:
+    // Number of frames kept (NACKs about older frames are ignored)
+    void setFrameCount(size_t count) {
+        m_frames.resize(count < 1 ? 1 : count);
+        m_nextFrame = 0;
+        clear();
+    }
+
+    void clear() {
+        for (auto& frame: m_frames) {
+            frame.valid = false;
+        }
+    }
+
+    // Keep a copy of the packets of the frame just sent (packet buffers are reused between frames)
+    void storeFrame(const FrameChunker& chunker) {
+        if (chunker.packetCount() == 0) {
+            return;
+        }
+        Frame& frame = m_frames[m_nextFrame];
+        m_nextFrame = (m_nextFrame + 1) % m_frames.size();
+        frame.valid = false;
+
+        ChunkHeader header;
+        for (size_t i = 0; i < chunker.packetCount(); i++) {
+            const std::vector<unsigned char>& packet = chunker.packet(i);
+            if (readChunkHeader(packet.data(), packet.size(), header) == 0) {
+                return;
+            }
+            if (i == 0) {
+                // Frame number as receivers read it (8 bits before protocol version 2)
+                frame.senderIdentifier = header.senderIdentifier;
+                frame.frameNumber = header.frameNumber;
+                frame.packets.resize(header.chunkCount + header.parityChunkCount);
+            }
+            if (header.chunkNumber < frame.packets.size()) {
+                frame.packets[header.chunkNumber].assign(packet.begin(), packet.end());
+            }
+        }
+        frame.valid = true;
+    }
+
+    // If the buffer is a NACK for this sender about a frame we still have, fill packets with the requested
+    // chunks (pointers valid until the next storeFrame) and return true
+    bool readNack(const unsigned char* buffer, size_t size, unsigned int senderIdentifier,
+                  std::vector<const std::vector<unsigned char>*>& packets) {
+        GeomUdpNack message;
+        if (!Ponk::readNack(buffer, size, message, m_missingChunks) || message.senderIdentifier != senderIdentifier) {
+            return false;
+        }
+        packets.clear();
+        for (const auto& frame: m_frames) {
+            if (!frame.valid || frame.senderIdentifier != senderIdentifier || frame.frameNumber != message.frameNumber) {
+                continue;
+            }
+            for (unsigned int chunkNumber: m_missingChunks) {
+                if (chunkNumber < frame.packets.size() && !frame.packets[chunkNumber].empty()) {
+                    packets.push_back(&frame.packets[chunkNumber]);
+                }
+            }
+            break;
+        }
+        return true;
+    }
+
+private:
+    struct Frame {
+        bool valid = false;
+        unsigned int senderIdentifier = 0;
+        unsigned int frameNumber = 0;
+        std::vector<std::vector<unsigned char>> packets;  // Indexed by chunk number
+    };
+
+    std::vector<Frame> m_frames = std::vector<Frame>(8);
+    size_t m_nextFrame = 0;
+    std::vector<unsigned int> m_missingChunks;
+};
+
+// Receiver side: decides when to send a NACK for a frame being assembled
+class NackTimer {
+public:
+    // Time without any chunk of the frame before asking for missing chunks, in microseconds
+    void setDelay(unsigned long long delay) {
+        m_delay = delay;
+    }
+
+    // NACKs sent at most per frame
+    void setMaxRequests(int count) {
+        m_maxRequests = count;
+    }
+
+    void reset() {
+        m_lastChunkTime = 0;
+        m_requestCount = 0;
+    }
+
+    void chunkReceived() {
+        m_lastChunkTime = clockMicroseconds();
+    }
+
+    // Returns true when a NACK should be sent. After a NACK, the next one waits twice the delay
+    // (retransmitted chunks need a round trip).
+    bool due() {
+        if (m_lastChunkTime == 0 || m_requestCount >= m_maxRequests) {
+            return false;
+        }
+        const unsigned long long now = clockMicroseconds();
+        if (now < m_lastChunkTime + m_delay) {
+            return false;
+        }
+        m_lastChunkTime = now + m_delay;
+        m_requestCount++;
+        return true;
+    }
+
+private:
+    unsigned long long m_delay = 3000;
+    int m_maxRequests = 2;
+    unsigned long long m_lastChunkTime = 0;
+    int m_requestCount = 0;
+};
+
+} // namespace Ponk
@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ *  Lock-free handoff of the latest frame from a receive thread to a consumer
+ *
+ *  A TripleBuffer holds three values: the producer writes the next one in back() while the consumer reads front(),
+ *  and the third one (middle) is the latest published value. publish() and update() swap a buffer with the middle
+ *  one in a single atomic exchange, so neither thread ever waits for the other: the producer can publish as often
+ *  as it wants (values the consumer did not take are overwritten), and the consumer always gets the latest one.
+ *
+ *  Only one thread may call back() and publish(), and only one other thread update() and front().
+ *
+ *  Usage:
+ *      // Receive thread
+ *      buffer.back() = std::move(frame);
+ *      buffer.publish();
+ *
+ *      // Consumer
+ *      if (buffer.update())
+ *          ... buffer.front() is a newer frame
+ *      use(buffer.front());
+ */
+
+#include <atomic>
+
+namespace Ponk {
+
+template <class T>
+class TripleBuffer {
+public:
+    // Producer: value to fill before publishing it
+    T& back() {
+        return m_buffers[m_back];
+    }
+
+    // Producer: makes back() the latest value. The new back() holds an older value (overwritten or already used).
+    void publish() {
+        const unsigned int previous = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel);
+        m_back = previous & kIndexMask;
+    }
+
+    // Consumer: takes the latest value if one was published since the last update. Returns true if front() changed.
+    bool update() {
+        if ((m_middle.load(std::memory_order_relaxed) & kFresh) == 0) {
+            return false;
+        }
+        const unsigned int previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & kIndexMask;
+        return true;
+    }
+
+    // Consumer: latest value taken by update()
+    T& front() {
+        return m_buffers[m_front];
+    }
+
+    const T& front() const {
+        return m_buffers[m_front];
+    }
+
+private:
+    static const unsigned int kIndexMask = 3;
+    static const unsigned int kFresh = 4;     // Middle buffer published and not taken yet
+
+    T m_buffers[3];
+    unsigned int m_back = 0;
+    std::atomic<unsigned int> m_middle{1};
+    unsigned int m_front = 2;
+};
+
+} // namespace Ponk
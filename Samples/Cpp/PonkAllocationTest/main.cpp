@@ -0,0 +1,193 @@
+// Checks that the Common/Cpp receive components do not allocate once warmed up, on a steady stream of frames:
+// FrameAssemblyWindow and FrameAssemblyBuffer, PathCacheDecoder, FrameView decoding into FramePoints, PathMetaData
+// with a MetaDataKeyTable, FramePool and TripleBuffer. The global operator new counts allocations, the test returns
+// 1 if any happens after the first frames.
+// PonkReceiver itself (parseAndStoreFrame, SenderFrame, the scheduling of frames) is not built here: the frame
+// below only mirrors the arrays of SenderFrame, so changes to the plugin must be checked in TouchDesigner.
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "PonkDefs.h"
+#include "PonkHeader.h"
+#include "PonkChunker.h"
+#include "PonkReassembly.h"
+#include "PonkPathCache.h"
+#include "PonkFrameCodec.h"
+#include "PonkFramePoints.h"
+#include "PonkMetaDataKeys.h"
+#include "PonkFramePool.h"
+#include "PonkTripleBuffer.h"
+
+static bool g_countAllocations = false;
+static unsigned long g_allocationCount = 0;
+
+void* operator new(size_t size) {
+    if (g_countAllocations) {
+        g_allocationCount++;
+    }
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+// Stand-in for SenderFrame of PonkReceiver: only the arrays it reuses between frames
+struct ReceivedFrame {
+    unsigned int frameNumber = 0;
+    Ponk::FramePoints points;
+    std::vector<Ponk::PathMetaData> pathMetaData;
+
+    void clear() {
+        frameNumber = 0;
+        points.clear();
+        pathMetaData.clear();
+    }
+};
+
+struct FrameAssembly {
+    int64_t frameNumber = -1;
+    unsigned int dataCrc = 0;
+    Ponk::FrameAssemblyBuffer chunks;
+
+    void reset() {
+        chunks.clear();
+        frameNumber = -1;
+        dataCrc = 0;
+    }
+};
+
+int main()
+{
+    const unsigned int kFrameCount = 300;
+    const unsigned int kWarmupFrameCount = 70;  // Past the first path cache keyframe interval (60 frames)
+
+    // Sender side, before counting: the same frame of 200 paths of 40 points (about 90 KB, 65 chunks), with path
+    // numbers so the path cache sends references to unchanged paths between keyframes
+    std::vector<unsigned char> frameData;
+    Ponk::PathWriter writer;
+    for (int path = 0; path < 200; path++) {
+        writer.beginPath(frameData, PONK_DATA_FORMAT_XY_F32_RGB_U8);
+        writer.addMetaData("PATHNUMB", static_cast<float>(path + 1));
+        writer.addMetaData("MAXSPEED", 1.f);
+        for (int i = 0; i < 40; i++) {
+            writer.addPoint(-1.f + i / 20.f, -1.f + path / 100.f, 1.f, 0.5f, 0.f);
+        }
+        writer.endPath();
+    }
+
+    Ponk::PathCacheEncoder pathCacheEncoder;
+    Ponk::FrameChunker chunker;
+    std::vector<unsigned char> encodedData;
+    std::vector<std::vector<unsigned char>> packets;
+    for (unsigned int frameNumber = 0; frameNumber < kFrameCount; frameNumber++) {
+        pathCacheEncoder.encodeFrame(frameData, static_cast<unsigned char>(frameNumber), encodedData);
+        Ponk::ChunkHeader header;
+        header.senderIdentifier = 123123;
+        strncpy(header.senderName, "Allocation Test", sizeof(header.senderName));
+        header.frameNumber = frameNumber;
+        if (!chunker.buildPackets(encodedData, header, PONK_MAX_CHUNK_SIZE)) {
+            std::cout << "Error: " << chunker.error() << std::endl;
+            return 1;
+        }
+        for (size_t i = 0; i < chunker.packetCount(); i++) {
+            packets.push_back(chunker.packet(i));
+        }
+    }
+
+    // Receive side
+    Ponk::FrameAssemblyWindow<FrameAssembly> assemblies;
+    auto dropFrame = [](FrameAssembly&) {};
+    Ponk::PathCacheDecoder pathCache;
+    std::vector<unsigned char> decodedData;
+    Ponk::MetaDataKeyTable metaDataKeys;
+    Ponk::FramePool<ReceivedFrame> framePool;
+    Ponk::TripleBuffer<ReceivedFrame> latestFrame;
+    unsigned int receivedFrameCount = 0;
+    unsigned int consumedFrameCount = 0;
+
+    for (const std::vector<unsigned char>& packet : packets) {
+        Ponk::ChunkHeader header;
+        const size_t headerSize = Ponk::readChunkHeader(packet.data(), packet.size(), header);
+        if (headerSize == 0) {
+            std::cout << "Error: invalid header" << std::endl;
+            return 1;
+        }
+        FrameAssembly* assembly = assemblies.acquire(header.frameNumber, header.protocolVersion, dropFrame);
+        if (!assembly) {
+            continue;
+        }
+        if (assembly->frameNumber == -1) {
+            assembly->chunks.start(header.chunkCount);
+        }
+        assembly->frameNumber = header.frameNumber;
+        assembly->dataCrc = header.dataCrc;
+        if (!assembly->chunks.storeChunk(header.chunkNumber, &packet[headerSize], packet.size() - headerSize)
+            || !assembly->chunks.complete()) {
+            continue;
+        }
+
+        size_t dataSize = 0;
+        const unsigned char* data = assembly->chunks.finish(dataSize);
+        assemblies.release(*assembly, dropFrame);
+        unsigned int crc = 0;
+        for (size_t i = 0; i < dataSize; i++) {
+            crc += data[i];
+        }
+        if (crc != header.dataCrc
+            || !pathCache.decodeFrame(data, dataSize, static_cast<unsigned char>(header.frameNumber), decodedData)) {
+            std::cout << "Error: could not decode frame " << header.frameNumber << std::endl;
+            return 1;
+        }
+
+        std::unique_ptr<ReceivedFrame> frame = framePool.acquire();
+        frame->frameNumber = header.frameNumber;
+        Ponk::FrameView frameView(decodedData.data(), decodedData.size());
+        Ponk::PathView pathView;
+        while (frameView.next(pathView)) {
+            if (!pathView.decodePoints(frame->points.addPath(pathView.pointCount()))) {
+                std::cout << "Error: invalid path points" << std::endl;
+                return 1;
+            }
+            frame->pathMetaData.emplace_back();
+            for (unsigned int m = 0; m < pathView.metaDataCount(); m++) {
+                frame->pathMetaData.back().add(metaDataKeys.intern(Ponk::packMetaDataKey(pathView.metaDataKey(m))),
+                                               pathView.metaDataValue(m));
+            }
+        }
+        if (frame->points.pathCount() != 200) {
+            std::cout << "Error: frame " << header.frameNumber << " has " << frame->points.pathCount() << " paths" << std::endl;
+            return 1;
+        }
+        std::swap(latestFrame.back(), *frame);
+        latestFrame.publish();
+        framePool.recycle(std::move(frame));
+
+        // The consumer misses some frames, as a cook slower than the sender would
+        if (receivedFrameCount % 3 != 0 && latestFrame.update()) {
+            consumedFrameCount++;
+        }
+
+        receivedFrameCount++;
+        if (receivedFrameCount == kWarmupFrameCount) {
+            g_countAllocations = true;
+        }
+    }
+    g_countAllocations = false;
+
+    std::cout << "Received " << receivedFrameCount << " frames (" << consumedFrameCount << " consumed), "
+              << g_allocationCount << " allocations after the first " << kWarmupFrameCount << std::endl;
+    if (receivedFrameCount != kFrameCount || g_allocationCount != 0) {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,10 +1,57 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <map>
 #include <cmath>
 #include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <random>
 #include "DatagramSocket/DatagramSocket.h"
 #include "PonkDefs.h"
+#include "PonkFrameCodec.h"
+#include "PonkHeader.h"
+#include "PonkCompression.h"
+#include "PonkReassembly.h"
+#include "PonkPathCache.h"
+#include "PonkMetaDataTable.h"
+#include "PonkPathInstancing.h"
+#include "PonkCurveTessellation.h"
+#include "PonkFec.h"
+#include "PonkPathAlignment.h"
+#include "PonkAnnouncement.h"
+#include "PonkClock.h"
+#include "PonkFeedback.h"
+#include "PonkRetransmit.h"
+
+// A frame being received
+struct FrameAssembly {
+    int64_t frameNumber = -1;
+    int chunkCount = -1;
+    unsigned int dataCrc = 0;
+    unsigned char flags = 0;
+
+    // We'll write chunks data at their place in a frame buffer until we get all chunks
+    // Protocol supports up to 255 chunks (65535 from protocol version 2), the buffer grows with frames and is kept
+    // We'll accept received data chunks in the wrong order though I doubt it should happen
+    Ponk::FrameAssemblyBuffer chunksData;
+
+    // Forward error correction: rebuild lost chunks from parity chunks when the sender sends them
+    Ponk::FecDecoder fec;
+
+    // Selective retransmission: ask the sender for missing chunks once the frame stops receiving chunks
+    // (senders not keeping their last frames just ignore it)
+    Ponk::NackTimer nackTimer;
+    unsigned int senderIdentifier = 0;
+    GenericAddr sourceAddr;
+
+    void reset() {
+        chunksData.clear();
+        frameNumber = -1;
+        chunkCount = -1;
+        nackTimer.reset();
+    }
+};
 
 int main()
 {
@@ -17,17 +64,69 @@ int main()
     // Zero means first active network adapter if I'm not wrong
     const int networkInterfaceIp = 0; //((192<<24) + (168<<16) + (1<<8) + 3);
 
-    int currentFrameNumber = -1;
+    // Frames being received: the first chunks of a frame can arrive before the last chunks of the previous one
+    // (paced or multi-path senders), so we assemble a few frames at once. Frames are used in order: once a frame
+    // is complete, older ones still missing chunks are dropped
+    Ponk::FrameAssemblyWindow<FrameAssembly> assemblies;
+    auto dropFrame = [&](FrameAssembly& assembly) {
+        std::cout << "Error: we have not received all chunks from frame number " << std::to_string(assembly.frameNumber)
+                  << " before a newer frame, dropping it" << std::endl;
+        if (assembly.flags & PONK_FLAG_PATH_ALIGNED) {
+            // Each chunk of a path-aligned frame holds complete paths: a receiver can display the received
+            // ones, merging them with Ponk::PathPieceMerger (previousChunkReceived = false after a gap)
+            std::cout << "Frame was path aligned, received chunks could still be displayed" << std::endl;
+        }
+    };
+    std::vector<unsigned char> recoveredChunk;
+    std::vector<unsigned char> nack;
+
+    // Store a data chunk payload at its place in the frame buffer, decompressing it if needed
+    auto storeChunk = [&](FrameAssembly& assembly, const Ponk::ChunkHeader& header, unsigned int chunkNumber, const unsigned char* payload, size_t payloadSize) {
+        if (header.flags & PONK_FLAG_COMPRESSED) {
+            // Each chunk is an independent compressed block, decompress it now
+            if (!assembly.chunksData.storeCompressedChunk(chunkNumber, payload, payloadSize)) {
+                std::cout << "Error in frame, could not decompress chunk " << std::to_string(chunkNumber) << std::endl;
+                return false;
+            }
+            return true;
+        }
+        return assembly.chunksData.storeChunk(chunkNumber, payload, payloadSize);
+    };
+
+    // Frame data through the decoding steps, and decoded points (kept between frames, so they don't allocate once
+    // big enough)
+    std::vector<unsigned char> allData;
+    Ponk::FramePoints framePoints;
 
-    // We'll keep all chunks data in a vector until we get all chunks
-    // Protocol supports up to 255 chunks
-    // We'll accept received data chunks in the wrong order though I doubt it should happen
-    int currentFrameChunkCount = -1;
-    int currentFrameDataCrc = -1;
-    std::vector<bool> chunksDataHasBeenReceived;
-    std::vector<std::vector<unsigned char>> chunksData;
-    chunksDataHasBeenReceived.resize(255);
-    chunksData.resize(255);
+    // Last version of each path carrying PATHNUMB meta data, to rebuild frames using path references
+    Ponk::PathCacheDecoder pathCache;
+    std::vector<unsigned char> decodedData;
+
+    // Path-aligned frames: long paths are split in pieces that must be merged back
+    Ponk::PathPieceMerger merger;
+
+    // Frames starting with a meta data table: paths only carry meta data that differ from the table
+    Ponk::MetaDataTableDecoder metaDataTable;
+
+    // Instances of template paths (shape sent once, then a transform per copy) are expanded to regular paths
+    Ponk::PathInstanceExpander instanceExpander;
+
+    // Curve paths (line, Bezier and arc segments) are sampled to points, at most 0.0005 away from the curve
+    Ponk::CurveTessellator curveTessellator;
+    curveTessellator.setTolerance(0.0005f);
+
+    // Names of senders using the compact header (protocol version 3), received in announcements
+    Ponk::SenderNameCache senderNames;
+
+    // Clock offset with senders stamping their frames, to measure latency
+    std::map<unsigned int, Ponk::ClockSync> clockSyncs;
+    std::map<unsigned int, GenericAddr> clockSyncAddresses;
+    std::vector<unsigned char> clockSyncRequest;
+
+    // Feedback sent to senders, so they can adapt their send rate to ours
+    const unsigned int receiverIdentifier = std::random_device()();
+    Ponk::OutputRateMeter outputRate;
+    std::vector<unsigned char> feedback;
 
     while (true) {
         unsigned char buffer[65536];
@@ -40,251 +139,251 @@ int main()
         }
 
         if (bufferSize == 0) {
+            // Nothing to read: good time to send clock sync requests (not in phase with sender frames)
+            for (auto& kv: clockSyncs) {
+                if (kv.second.requestDue(kv.first, clockSyncRequest)) {
+                    socket.sendTo(clockSyncAddresses[kv.first], clockSyncRequest.data(), static_cast<unsigned int>(clockSyncRequest.size()));
+                }
+            }
+            // and NACKs (all pending chunks have been read)
+            for (unsigned int i=0; i<assemblies.size(); i++) {
+                FrameAssembly& assembly = assemblies[i];
+                if (assembly.frameNumber != -1 && assembly.nackTimer.due()
+                    && Ponk::writeNack(assembly.senderIdentifier, static_cast<unsigned int>(assembly.frameNumber), assembly.chunksData,
+                                       static_cast<unsigned int>(assembly.chunkCount), nack)) {
+                    std::cout << "Asking for missing chunks of frame " << std::to_string(assembly.frameNumber) << std::endl;
+                    socket.sendTo(assembly.sourceAddr, nack.data(), static_cast<unsigned int>(nack.size()));
+                }
+            }
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
         }
 
         //std::cout << "Received packet of " << std::to_string(bufferSize) << " bytes" << std::endl;
 
-        // Parse buffer
-        if (bufferSize < sizeof(GeomUdpHeader)) {
-            std::cout << "Error in frame, frame size " << std::to_string(bufferSize) << " is lower than header size" << std::endl;
+        // Sender announcement: not a frame chunk, just update the name cache
+        if (senderNames.readAnnouncement(buffer, bufferSize)) {
             continue;
         }
 
-        const GeomUdpHeader* header = reinterpret_cast<const GeomUdpHeader*>(buffer);
-
-        // Check protocol header string
-        if (strncmp(header->headerString,PONK_HEADER_STRING,8) != 0) {
-            std::cout << "Error in frame, invalid header" << std::endl;
+        // Clock sync response from a sender
+        GeomUdpClockSync clockSync;
+        if (Ponk::readClockSync(buffer, bufferSize, clockSync)) {
+            auto it = clockSyncs.find(clockSync.senderIdentifier);
+            if (it != clockSyncs.end()) {
+                it->second.addResponse(clockSync);
+            }
             continue;
         }
 
-        // Check protocol version
-        if (header->protocolVersion > 0) {
-            std::cout << "Source protocol version is " << std::to_string(header->protocolVersion)
-                      << " but this sample code only support protocol version 0" << std::endl;
+        // Parse buffer
+        Ponk::ChunkHeader header;
+        const size_t headerSize = Ponk::readChunkHeader(buffer, bufferSize, header);
+        if (headerSize == 0) {
+            if (header.protocolVersion > PONK_PROTOCOL_VERSION) {
+                std::cout << "Source protocol version is " << std::to_string(header.protocolVersion)
+                          << " but this sample code only support protocol version up to " << std::to_string(PONK_PROTOCOL_VERSION) << std::endl;
+            } else {
+                std::cout << "Error in frame, invalid header" << std::endl;
+            }
             continue;
         }
 
-        // Read Sender Name string (32 bytes null terminated UTF8 string)
-        //std::cout << "Sender name " << senderName << std::endl;
+        // Read Sender Name string (32 bytes null terminated UTF8 string), from announcements with the compact header
+        senderNames.fillName(header);
+        //std::cout << "Sender name " << header.senderName << std::endl;
 
-        // Read Frame Number
-        // If we actually received part of a frame, we shouldn't received a different frame number
-        if (currentFrameNumber != -1 && header->frameNumber != currentFrameNumber) {
-            std::cout << "Error: frame number has changed to " << std::to_string(header->frameNumber)
-                      << " but we have not received all chunks from frame number " << std::to_string(currentFrameNumber)
-                      << ". Resetting chunks data" << std::endl;
-            assert(false);
-            // Reset state. Note that ideally we shouldn't skip all chunks from a frame if we receive the first chunk
-            // of next frame before last chunk of previous frame, but keep the sample code simple (we should keep received chunks
-            // for the 256 possible frame number) - a frame will generally fit a single chunk / UDP packet and this case should rarely happen
-            for (auto& chunkData: chunksData) {
-                chunkData.clear();
-            }
-            for (int i=0; i<255; i++) {
-                chunksDataHasBeenReceived[i] = false;
-            }
-            currentFrameNumber = -1;
+        // Senders stamping their frames will be asked for their clock, to measure latency
+        if (header.flags & PONK_FLAG_TIMESTAMP) {
+            clockSyncs[header.senderIdentifier];
+            clockSyncAddresses[header.senderIdentifier] = sourceAddr;
+        }
+
+        // Find the frame this chunk belongs to, or start a new one. Chunks of frames we already completed
+        // or dropped are not needed anymore (parity chunks, late chunks)
+        FrameAssembly* assembly = assemblies.acquire(header.frameNumber, header.protocolVersion, dropFrame);
+        if (!assembly) {
+            continue;
         }
 
-        // If we're actually reading a frame, ensure chunkCount doesn't change accross same frame headers (buggy sender)
-        if (currentFrameNumber != -1 && currentFrameChunkCount != header->chunkCount) {
+        // If we're actually reading this frame, ensure chunkCount doesn't change accross same frame headers (buggy sender)
+        if (assembly->frameNumber != -1 && assembly->chunkCount != static_cast<int>(header.chunkCount)) {
             std::cout << "Error: received a new chunk for a frame with a different chunk count" << std::endl;
             assert(false);
         }
 
-        // If we're actually reading a frame, ensure dataCrc doesn't change (buggy sender)
-        if (currentFrameNumber != -1 && currentFrameDataCrc != header->dataCrc) {
+        // If we're actually reading this frame, ensure dataCrc doesn't change (buggy sender)
+        if (assembly->frameNumber != -1 && assembly->dataCrc != header.dataCrc) {
             std::cout << "Error: received a new chunk for a frame with a different data CRC" << std::endl;
             assert(false);
         }
 
-        currentFrameNumber = header->frameNumber;
-        currentFrameChunkCount = header->chunkCount;
-        currentFrameDataCrc = header->dataCrc;
+        if (assembly->frameNumber == -1) {
+            assembly->chunksData.start(header.chunkCount);
+            assembly->fec.reset(header.chunkCount, header.parityChunkCount);
+        }
+        assembly->frameNumber = header.frameNumber;
+        assembly->chunkCount = header.chunkCount;
+        assembly->dataCrc = header.dataCrc;
+        assembly->flags = header.flags;
 
         // Check Chunk Count
-        if (header->chunkCount == 0) {
+        if (header.chunkCount == 0) {
             std::cout << "Error in frame, chunk count is zero" << std::endl;
             assert(false);
         }
 
-        // Check Chunk number
-        if (header->chunkNumber >= header->chunkCount) {
+        // Check Chunk number (parity chunks are numbered after data chunks)
+        if (header.chunkNumber >= header.chunkCount + header.parityChunkCount) {
             // Sender is buggy
-            std::cout << "Error in frame, chunk number (" << std::to_string(header->chunkNumber) << ") is over chunk count (" << std::to_string(header->chunkCount) << ")" << std::endl;
+            std::cout << "Error in frame, chunk number (" << std::to_string(header.chunkNumber) << ") is over chunk count (" << std::to_string(header.chunkCount) << ")" << std::endl;
             assert(false);
             continue;
         }
-        if (!chunksData[header->chunkNumber].empty()) {
-            // Buggy sender or dying network
-            std::cout << "Error in frame, we already received data for chunk " << std::to_string(header->chunkNumber) << std::endl;
-            assert(false);
-        }
+        assembly->nackTimer.chunkReceived();
+        assembly->senderIdentifier = header.senderIdentifier;
+        assembly->sourceAddr = sourceAddr;
 
         // Now read data
-        const auto dataLength = bufferSize - sizeof(GeomUdpHeader);
-        unsigned int bufferOffset = sizeof(GeomUdpHeader);
-        for (unsigned int i=0; i<dataLength; i++) {
-            chunksData[header->chunkNumber].push_back(buffer[bufferOffset++]);
+        const unsigned char* payload = &buffer[headerSize];
+        const size_t dataLength = bufferSize - headerSize;
+        if (header.chunkNumber < header.chunkCount) {
+            if (assembly->chunksData.received(header.chunkNumber)) {
+                // Buggy sender, dying network, or chunk already rebuilt from parity
+                std::cout << "Error in frame, we already received data for chunk " << std::to_string(header.chunkNumber) << std::endl;
+                continue;
+            }
+            if (!storeChunk(*assembly, header, header.chunkNumber, payload, dataLength)) {
+                continue;
+            }
         }
-        chunksDataHasBeenReceived[header->chunkNumber] = true;
-
-        //std::cout << "Received chunk " << std::to_string(chunkNumber) << "/" << std::to_string(chunkCount) << " for frame " << std::to_string(frameNumber) << std::endl;
 
-        // If we received all frame chunks, log the frame
-        bool receivedAllChunksYet = true;
-        for (int i=0; i<header->chunkCount; i++) {
-            if (!chunksDataHasBeenReceived[i]) {
-                receivedAllChunksYet = false;
-                break;
+        // Forward error correction: once all other chunks of a parity group are in, rebuild its missing chunk
+        if (assembly->fec.enabled() && assembly->fec.addChunk(header.chunkNumber, payload, dataLength)) {
+            unsigned int recoveredChunkNumber = 0;
+            if (assembly->fec.recoverChunk(header.chunkNumber, recoveredChunkNumber, recoveredChunk)
+                && !assembly->chunksData.received(recoveredChunkNumber)) {
+                std::cout << "Rebuilt lost chunk " << std::to_string(recoveredChunkNumber) << " from parity" << std::endl;
+                storeChunk(*assembly, header, recoveredChunkNumber, recoveredChunk.data(), recoveredChunk.size());
             }
         }
 
-        if (receivedAllChunksYet) {
-            // Put all frame data together in a single buffer
-            std::vector<unsigned char> allData;
-            allData.reserve(255*PONK_MAX_CHUNK_SIZE);
-            for (int i=0; i<header->chunkCount; i++) {
-                allData.insert(allData.end(),chunksData[i].begin(),chunksData[i].end());
-            }
+        //std::cout << "Received chunk " << std::to_string(chunkNumber) << "/" << std::to_string(chunkCount) << " for frame " << std::to_string(frameNumber) << std::endl;
 
-            // Seems we're all good, we know have complete frame data
-            std::cout << "Received frame " << std::to_string(currentFrameNumber) << std::endl;
+        // If we received all frame chunks, log the frame
+        if (assembly->chunksData.complete()) {
+            // Chunks are packed in place: frame data is contiguous in the frame buffer, until it starts another frame
+            size_t frameDataSize = 0;
+            const unsigned char* frameData = assembly->chunksData.finish(frameDataSize);
 
-            // Reset state
-            for (int i=0; i<header->chunkCount; i++) {
-                chunksData[i].clear();
-                chunksDataHasBeenReceived[i] = false;
+            // Seems we're all good, we know have complete frame data
+            std::cout << "Received frame " << std::to_string(header.frameNumber);
+            if (header.flags & PONK_FLAG_TIMESTAMP && clockSyncs[header.senderIdentifier].synchronized()) {
+                const unsigned long long captureTime = clockSyncs[header.senderIdentifier].toLocalTime(header.timestamp);
+                std::cout << " - latency " << std::to_string(static_cast<int64_t>(Ponk::clockMicroseconds() - captureTime) / 1000.0) << " ms";
             }
-            currentFrameNumber = -1;
+            std::cout << std::endl;
 
-            // Parse Frame Data
-            const auto dataSize = allData.size();
-            if (dataSize < 1) {
-                std::cout << "Error: frame data is empty" << std::endl;
-                continue;
-            }
+            // Tell the sender which frame we used, and at which rate (a receiver showing frames at a fixed
+            // rate would report the frames it shows and its display rate instead)
+            outputRate.frameConsumed();
+            Ponk::writeFeedback(header.senderIdentifier, receiverIdentifier, header.frameNumber, 0, outputRate.rate(), feedback);
+            socket.sendTo(sourceAddr, feedback.data(), static_cast<unsigned int>(feedback.size()));
+
+            // Older frames we're still receiving are dropped, and this one is ready for a next frame
+            assemblies.release(*assembly, dropFrame);
 
             // Check Data CRC
-            int computedCrc = 0;
-            for (auto v: allData) {
-                computedCrc += v;
+            unsigned int computedCrc = 0;
+            for (size_t i=0; i<frameDataSize; i++) {
+                computedCrc += frameData[i];
             }
-            if (computedCrc != header->dataCrc) {
+            if (computedCrc != header.dataCrc) {
                 std::cout << "Error: invalid data CRC, ignoring frame" << std::endl;
                 assert(false);
                 continue;
             }
 
-            unsigned int dataOffset = 0;
-
-            // Read Pathes
-            struct Path {
-                struct Point {
-                    float x,y,r,g,b;
-                };
-                std::vector<Point> points;
-            };
-
-            // Loop over pathes until there's no more data to read
-            std::vector<Path> pathes;
-            while (dataOffset < dataSize) {
-                // Read data format
-                const auto dataFormat = allData[dataOffset];
-                dataOffset++;
-
-                // Read Meta Data Count
-                if (dataSize < dataOffset+1) {
-                    std::cout << "Error: not enough data to read path meta data count" << std::endl;
-                    break;
+            // Merge back paths the sender split in pieces to fit chunks
+            if (header.flags & PONK_FLAG_PATH_ALIGNED) {
+                merger.clear();
+                merger.addChunk(frameData,frameDataSize,true);
+                const std::vector<unsigned char>& mergedData = merger.finish();
+                frameData = mergedData.data();
+                frameDataSize = mergedData.size();
+            }
+
+            // Expand paths using the frame meta data table back to regular paths
+            if (Ponk::usesMetaDataTable(frameData,frameDataSize)) {
+                if (!metaDataTable.decodeFrame(frameData,frameDataSize,allData)) {
+                    std::cout << "Error: invalid meta data table" << std::endl;
+                    continue;
                 }
-                const unsigned short metaDataCount = allData[dataOffset];
-                dataOffset++;
+                frameData = allData.data();
+                frameDataSize = allData.size();
+            }
 
-                // Read Meta Data
-                if (dataSize < dataOffset+12 * metaDataCount) {
-                    std::cout << "Error: not enough data to read path meta data" << std::endl;
-                    break;
+            // Rebuild paths the sender replaced by a reference to a previous frame (inter-frame path caching)
+            if (!pathCache.decodeFrame(frameData,frameDataSize,static_cast<unsigned char>(header.frameNumber),decodedData)) {
+                std::cout << "Error: frame references a path we don't have, waiting for next keyframe" << std::endl;
+                continue;
+            }
+            allData.swap(decodedData);
+
+            // Expand instances of template paths
+            if (Ponk::hasPathInstances(allData.data(),allData.size())) {
+                if (!instanceExpander.expandFrame(allData.data(),allData.size(),decodedData)) {
+                    std::cout << "Error: invalid path instances" << std::endl;
+                    continue;
                 }
-                for (int idx=0; idx<metaDataCount; idx++) {
+                allData.swap(decodedData);
+            }
+
+            // Sample curve paths to regular paths
+            if (Ponk::hasCurvePaths(allData.data(),allData.size())) {
+                if (!curveTessellator.tessellateFrame(allData.data(),allData.size(),decodedData)) {
+                    std::cout << "Error: invalid curve path" << std::endl;
+                    continue;
+                }
+                allData.swap(decodedData);
+            }
+
+            // Parse Frame Data
+            if (allData.empty()) {
+                std::cout << "Error: frame data is empty" << std::endl;
+                continue;
+            }
+
+            // Loop over pathes until there's no more data to read. Paths are read in place,
+            // points are decoded straight into framePoints (one array per component, paths as point ranges)
+            framePoints.clear();
+            Ponk::FrameView frameView(allData.data(),allData.size());
+            Ponk::PathView pathView;
+            while (frameView.next(pathView)) {
+                for (unsigned int idx=0; idx<pathView.metaDataCount(); idx++) {
                     // Not that we don't know what value type is carried. Sender and Receiver
                     // should know what value type to transfer for a meta. Receiver
                     // should check meta value is in acceptable range
-                    std::string metaName((char*)&allData[dataOffset],8);
-                    dataOffset += 8;
-                    const auto floatValue = *reinterpret_cast<float*>(&allData[dataOffset]);
-                    dataOffset += 4;
-                    std::cout << "Path Meta " << metaName << " = " << floatValue << std::endl;
+                    std::string metaName(pathView.metaDataKey(idx),pathView.metaDataKeyLength(idx));
+                    std::cout << "Path Meta " << metaName << " = " << pathView.metaDataValue(idx) << std::endl;
                 }
 
-                // Read Point Count
-                if (dataSize < dataOffset+2) {
-                    std::cout << "Error: not enough data to read path point count" << std::endl;
-                    break;
-                }
-                const unsigned short pointCount = allData[dataOffset] + (allData[dataOffset+1]<<8);
-                std::cout << "  -> Path " << std::to_string(pathes.size()) << " / Point Count = " << std::to_string(pointCount) << std::endl;
-                dataOffset += 2;
-
-                unsigned char bytesPerPoint;
-                if (dataFormat == PONK_DATA_FORMAT_XYRGB_U16) {
-                    bytesPerPoint = 5 * sizeof(unsigned short);
-                } else if (dataFormat == PONK_DATA_FORMAT_XY_F32_RGB_U8) {
-                    bytesPerPoint = 2 * sizeof(float) + 3 * sizeof(unsigned char);
-                } else {
-                    std::cout << "Error: unhandled data format: " << dataFormat << std::endl;
-                    break;
+                std::cout << "  -> Path " << std::to_string(framePoints.pathCount()) << " / Point Count = " << std::to_string(pathView.pointCount());
+                float minX, minY, maxX, maxY;
+                if (pathView.bounds(minX,minY,maxX,maxY)) {
+                    std::cout << " / Bounds = (" << minX << "," << minY << ") - (" << maxX << "," << maxY << ")";
                 }
+                std::cout << std::endl;
 
-                if (dataSize < dataOffset + pointCount * bytesPerPoint) {
-                    std::cout << "Error: not enough data to read path points" << std::endl;
+                if (!pathView.decodePoints(framePoints.addPath(pathView.pointCount()))) {
+                    std::cout << "Error: invalid path points" << std::endl;
+                    framePoints.removeLastPath();
                     break;
                 }
-
-                Path path;
-                for (int i=0; i<pointCount; i++) {
-                    Path::Point point;
-
-                    if (dataFormat == PONK_DATA_FORMAT_XYRGB_U16) {
-                        unsigned short x16bits = allData[dataOffset] + (allData[dataOffset+1]<<8);
-                        dataOffset += 2;
-                        unsigned short y16bits = allData[dataOffset] + (allData[dataOffset+1]<<8);
-                        dataOffset += 2;
-                        unsigned short r16bits = allData[dataOffset] + (allData[dataOffset+1]<<8);
-                        dataOffset += 2;
-                        unsigned short g16bits = allData[dataOffset] + (allData[dataOffset+1]<<8);
-                        dataOffset += 2;
-                        unsigned short b16bits = allData[dataOffset] + (allData[dataOffset+1]<<8);
-                        dataOffset += 2;
-
-                        point.x = -1+2*(x16bits/65535.f);
-                        point.y = -1+2*(y16bits/65535.f);
-                        point.r = r16bits/65535.f;
-                        point.g = g16bits/65535.f;
-                        point.b = b16bits/65535.f;
-                    } else if (dataFormat == PONK_DATA_FORMAT_XY_F32_RGB_U8) {
-                        point.x = *reinterpret_cast<float*>(&allData[dataOffset]);
-                        dataOffset += sizeof(float);
-                        point.y = *reinterpret_cast<float*>(&allData[dataOffset]);
-                        dataOffset += sizeof(float);
-                        point.r = allData[dataOffset];
-                        dataOffset++;
-                        point.g = allData[dataOffset];
-                        dataOffset++;
-                        point.b = allData[dataOffset];
-                        dataOffset++;
-                    }
-
-                    path.points.push_back(point);
-                }
-
-                pathes.push_back(path); // Note that this is very inefficient
             }
-
-            assert(dataOffset == dataSize);
+            if (frameView.error()) {
+                std::cout << "Error: truncated frame or unhandled data format" << std::endl;
+            }
         }
     }
 
@@ -3,16 +3,23 @@
 #include <vector>
 #include <cmath>
 #include <cassert>
+#include <cstring>
 #include "DatagramSocket/DatagramSocket.h"
 #include "PonkDefs.h"
+#include "PonkFrameCodec.h"
+#include "PonkCurveFormat.h"
+#include "PonkPathInstancing.h"
+#include "PonkChunker.h"
+#include "PonkAnnouncement.h"
+#include "PonkClock.h"
+#include "PonkFeedback.h"
+#include "PonkRetransmit.h"
+#include "PonkPathCache.h"
+#include "PonkMetaDataTable.h"
 #ifndef M_PI // M_PI not defined on Windows
     #define M_PI 3.14159265358979323846
 #endif
 
-void push8bits(std::vector<unsigned char>& fullData, unsigned char value) {
-    fullData.push_back(value);
-}
-
 void push16bits(std::vector<unsigned char>& fullData, unsigned short value) {
     fullData.push_back(static_cast<unsigned char>((value>>0) & 0xFF));
     fullData.push_back(static_cast<unsigned char>((value>>8) & 0xFF));
@@ -25,10 +32,6 @@ void push32bits(std::vector<unsigned char>& fullData, int value) {
     fullData.push_back(static_cast<unsigned char>((value>>24) & 0xFF));
 }
 
-void push32bits(std::vector<unsigned char>& fullData, float value) {
-    push32bits(fullData,*reinterpret_cast<int*>(&value));
-}
-
 void pushMetaData(std::vector<unsigned char>& fullData, const char (&eightCC)[9],float value) {
     for (int i=0; i<8; i++) {
         fullData.push_back(eightCC[i]);
@@ -36,9 +39,10 @@ void pushMetaData(std::vector<unsigned char>& fullData, const char (&eightCC)[9]
     push32bits(fullData,*(int*)&value);
 }
 
-void generateDataForCircleAndTriangleXYRGBU16(std::vector<unsigned char>& fullData, const double animTime);
-void generateDataForCircleAndTriangleFloat(std::vector<unsigned char>& fullData, const double animTime);
+void generateDataForCircleAndTriangle(std::vector<unsigned char>& fullData, const double animTime, const unsigned char dataFormat);
 void generateDataFor1000TrianglesFloat(std::vector<unsigned char>& fullData, const double animTime);
+void generateDataFor1000TrianglesInstanced(std::vector<unsigned char>& fullData, const double animTime);
+void generateDataForCircleAndTriangleCurves(std::vector<unsigned char>& fullData, const double animTime);
 
 int main()
 {
@@ -49,56 +53,84 @@ int main()
     // send a moving circle and a triangle in loop
     double animTime = 0;
     auto nextFrametime = std::chrono::system_clock::now();
-    unsigned char frameNumber = 0;
+    unsigned int frameNumber = 0; // Only 8 bits are sent unless the frame needs protocol version 2
+    Ponk::FrameChunker chunker;
+    Ponk::PathCacheEncoder pathCache;
+    std::vector<unsigned char> encodedData;
+    Ponk::MetaDataTableEncoder metaDataTable;
+    Ponk::SenderAnnouncer announcer;
+    std::vector<unsigned char> clockSyncResponse;
+    Ponk::SendRateController rateController;
+    Ponk::RetransmitBuffer retransmitBuffer;
+    std::vector<const std::vector<unsigned char>*> retransmitPackets;
+    const unsigned int senderIdentifier = 123123; // Unique ID (so when changing name in sender, the receiver can just rename existing stream)
     while (true) {
-        std::vector<unsigned char> fullData;
-        fullData.reserve(65536);
-
-        //generateDataForCircleAndTriangleXYRGBU16(fullData,animTime);
-        generateDataForCircleAndTriangleFloat(fullData,animTime);
-        //generateDataFor1000TrianglesFloat(fullData,animTime);
-
-        // Compute necessary chunk count
-        size_t chunksCount64 = 1 + fullData.size() / (PONK_MAX_CHUNK_SIZE-sizeof(GeomUdpHeader));
-        if (chunksCount64 > 255) {
-            throw std::runtime_error("Protocol doesn't accept sending "
-                                     "a packet that would be splitted "
-                                     "in more than 255 chunks");
-        }
-
-        // Compute data CRC
-        unsigned int dataCrc = 0;
-        for (auto v: fullData) {
-            dataCrc += v;
+        // Answer clock sync requests and NACKs, and read feedback of receivers (sent to the address we send from).
+        // Done before sending, so resent chunks of the previous frame arrive before the new one.
+        while (true) {
+            unsigned char buffer[2048];
+            unsigned int bufferSize = static_cast<unsigned int>(sizeof(buffer));
+            GenericAddr sourceAddr;
+            if (!socket.recvFrom(sourceAddr, buffer, bufferSize) || bufferSize == 0) {
+                break;
+            }
+            if (Ponk::answerClockSync(buffer, bufferSize, senderIdentifier, clockSyncResponse)) {
+                socket.sendTo(sourceAddr, clockSyncResponse.data(), static_cast<unsigned int>(clockSyncResponse.size()));
+            } else if (retransmitBuffer.readNack(buffer, bufferSize, senderIdentifier, retransmitPackets)) {
+                for (const auto* packet: retransmitPackets) {
+                    socket.sendTo(sourceAddr, packet->data(), static_cast<unsigned int>(packet->size()));
+                }
+            } else {
+                rateController.readFeedback(buffer, bufferSize, senderIdentifier);
+            }
         }
 
-        // Send all chunks to the desired IP address
-        size_t written = 0;
-        unsigned char chunkNumber = 0;
-        unsigned char chunksCount = static_cast<unsigned char>(chunksCount64);
-        while (written < fullData.size()) {
-            // Write packet header - 8 bytes
-            GeomUdpHeader header;
-            strncpy(header.headerString,PONK_HEADER_STRING,sizeof(header.headerString));
-            header.protocolVersion = 0;
-            header.senderIdentifier = 123123; // Unique ID (so when changing name in sender, the receiver can just rename existing stream)
+        // Skip frames receivers would not use, according to their feedback (all frames are sent without feedback)
+        if (rateController.shouldSendFrame()) {
+            std::vector<unsigned char> fullData;
+            fullData.reserve(65536);
+
+            //generateDataForCircleAndTriangle(fullData,animTime,PONK_DATA_FORMAT_XYRGB_U16);
+            generateDataForCircleAndTriangle(fullData,animTime,PONK_DATA_FORMAT_XY_F32_RGB_U8);
+            // Compressed format: the 4096 points circle takes about 8 KB instead of 45 KB
+            //generateDataForCircleAndTriangle(fullData,animTime,PONK_DATA_FORMAT_XY_DELTA_RGB_RLE);
+            // Half floats: 7 bytes per point instead of 11, the 4096 points circle takes 28 KB instead of 45 KB
+            //generateDataForCircleAndTriangle(fullData,animTime,PONK_DATA_FORMAT_XY_F16_RGB_U8);
+            //generateDataFor1000TrianglesFloat(fullData,animTime);
+            //generateDataFor1000TrianglesInstanced(fullData,animTime);
+            //generateDataForCircleAndTriangleCurves(fullData,animTime);
+
+            // Inter-frame path caching: replace paths (with PATHNUMB meta data) unchanged since a previous frame
+            // by a reference to it. All paths are sent in full on keyframes, every 60 frames by default
+            //pathCache.encodeFrame(fullData,static_cast<unsigned char>(frameNumber),encodedData);
+            //fullData.swap(encodedData);
+
+            // Meta data table: send meta data keys and their most frequent value once per frame, paths then only
+            // carry values that differ (ie PATHNUMB of generateDataFor1000TrianglesFloat goes from 12 to 5 bytes per path)
+            //metaDataTable.encodeFrame(fullData,encodedData);
+            //fullData.swap(encodedData);
+
+            // Cut frame data in chunks
+            Ponk::ChunkHeader header;
+            header.senderIdentifier = senderIdentifier;
             strncpy(header.senderName,"Sample Sender",sizeof(header.senderName));
             header.frameNumber = frameNumber;
-            header.chunkCount = chunksCount;
-            header.chunkNumber = chunkNumber;
-            header.dataCrc = dataCrc;
-
-            // Prepare buffer
-            std::vector<unsigned char> packet;
-            size_t dataBytesForThisChunk = std::min<size_t>(fullData.size()-written,PONK_MAX_CHUNK_SIZE-sizeof(GeomUdpHeader));
-            packet.resize(sizeof(GeomUdpHeader) + dataBytesForThisChunk);
-            // Write header
-            memcpy(&packet[0],&header,sizeof(GeomUdpHeader));
-            // Write data
-            memcpy(&packet[sizeof(GeomUdpHeader)],&fullData[written],dataBytesForThisChunk);
-            written += dataBytesForThisChunk;
-
-            // Now send chunk packet
+            // Compress frame data before chunking: each chunk can still be decompressed on its own
+            // (frame is then sent with protocol version 1, not supported by receivers only handling version 0)
+            //header.flags |= PONK_FLAG_COMPRESSED;
+            // Forward error correction: send one parity chunk every 4 data chunks, so receivers can rebuild
+            // lost chunks (frame is then sent with protocol version 1)
+            //chunker.setParityRatio(0.25f);
+            // Cut chunks on path boundaries (long paths are split in pieces), so receivers can parse each chunk
+            // on its own and use the rest of a frame when a chunk is lost
+            //chunker.setPathAligned(true);
+            // Compact header: sender name is not sent in each chunk but in announcements (protocol version 3)
+            //header.protocolVersion = 3;
+            // Capture time, so receivers can measure latency and show frames of multiple senders in sync
+            //header.flags |= PONK_FLAG_TIMESTAMP;
+            header.timestamp = Ponk::clockMicroseconds();
+
+            // Send all chunks to the desired IP address
             GenericAddr destAddr;
             destAddr.family = AF_INET;
             // Unicast on localhost 127.0.0.1
@@ -106,15 +138,33 @@ int main()
             // Multicast
             destAddr.ip = PONK_MULTICAST_IP;
             destAddr.port = PONK_PORT;
-            socket.sendTo(destAddr, &packet.front(), static_cast<unsigned int>(packet.size()));
 
-            chunkNumber++;
+            // Chunk size: default fits any network. Bigger chunks mean less packets per frame:
+            // - Unicast: use the path MTU known by the OS
+            //size_t chunkSize = Ponk::chunkSizeForMtu(DatagramSocket::pathMtu(destAddr));
+            // - Network configured with jumbo frames (all switches and receivers)
+            //size_t chunkSize = PONK_JUMBO_CHUNK_SIZE;
+            size_t chunkSize = PONK_MAX_CHUNK_SIZE;
+            if (!chunker.buildPackets(fullData,header,chunkSize)) {
+                throw std::runtime_error(chunker.error());
+            }
+            // Senders using the compact header announce their name once per second
+            if (Ponk::chunkHeaderVersion(header) >= 3 && announcer.update(header)) {
+                socket.sendTo(destAddr, announcer.packet().data(), static_cast<unsigned int>(announcer.packet().size()));
+            }
+            for (size_t i=0; i<chunker.packetCount(); i++) {
+                const auto& packet = chunker.packet(i);
+                socket.sendTo(destAddr, &packet.front(), static_cast<unsigned int>(packet.size()));
+            }
+
+            // Keep the last frames to resend the chunks receivers ask for
+            retransmitBuffer.storeFrame(chunker);
+
+            std::cout << "Sent frame " << std::to_string(frameNumber) << std::endl;
+            frameNumber++;
         }
 
-        std::cout << "Sent frame " << std::to_string(frameNumber) << std::endl;
-
         animTime += 1/60.;
-        frameNumber++;
 
         nextFrametime += std::chrono::microseconds(1000000/60);
         std::this_thread::sleep_until(nextFrametime);
@@ -123,93 +173,20 @@ int main()
     return 0;
 }
 
-void generateDataForCircleAndTriangleXYRGBU16(std::vector<unsigned char>& fullData, const double animTime)
-{
-    // Generate circle data with 1024 points
-    fullData.push_back(PONK_DATA_FORMAT_XYRGB_U16); // Write Format Data
-
-    // Meta Data
-    fullData.push_back(2); // Write meta data count
-    pushMetaData(fullData,"PATHNUMB",1.f);
-    pushMetaData(fullData,"MAXSPEED",0.1f);
-
-    // Write point count - LSB first
-    constexpr int kCirclePointCount = 1024;
-    constexpr float kCircleMoveSize = 0.2;
-    constexpr float kCircleSize = 0.5;
-
-    push16bits(fullData,kCirclePointCount);
-    // Write 1024 points
-    const auto circleCenterX = kCircleMoveSize * cos(animTime*3);
-    const auto circleCenterY = kCircleMoveSize * sin(animTime*3);
-    for (int i=0; i<1024; i++) {
-        // Be sure to close circle
-        const auto normalizedPosInCircle = double(i)/(kCirclePointCount-1);
-        const auto x = circleCenterX + kCircleSize * cos(normalizedPosInCircle*2*M_PI);
-        const auto y = circleCenterY + kCircleSize * sin(normalizedPosInCircle*2*M_PI);
-        assert(x>=-1 && x<=1 && y>=-1 && y<=1);
-        const auto x16Bits = static_cast<unsigned short>(((x+1)/2) * 65535);
-        const auto y16Bits = static_cast<unsigned short>(((y+1)/2) * 65535);
-        // Push X - LSB first
-        push16bits(fullData,x16Bits);
-        // Push Y - LSB first
-        push16bits(fullData,y16Bits);
-        // Push R - LSB first
-        push16bits(fullData,0xFFFF);
-        // Push G - LSB first
-        push16bits(fullData,0xFFFF);
-        // Push B - LSB first
-        push16bits(fullData,0xFFFF);
-    }
-
-    // Generate a triangle with 4 points (to close it)
-    fullData.push_back(PONK_DATA_FORMAT_XYRGB_U16); // Write Format Data
-
-    // Meta Data
-    fullData.push_back(1); // Write meta data count
-    pushMetaData(fullData,"PATHNUMB",2.f);
-
-    // Write point count - LSB first
-    constexpr int kTrianglePointCount = 4;
-    constexpr float kTriangleSize = 0.5;
-    fullData.push_back((kTrianglePointCount>>0) & 0xFF);
-    fullData.push_back((kTrianglePointCount>>8) & 0xFF);
-    for (int i=0; i<kTrianglePointCount; i++) {
-        const auto normalizedPosInTriangle = double(i)/(kTrianglePointCount-1);
-        const auto x = kTriangleSize * cos(normalizedPosInTriangle*2*M_PI);
-        const auto y = kTriangleSize * sin(normalizedPosInTriangle*2*M_PI);
-        assert(x>=-1 && x<=1 && y>=-1 && y<=1);
-        const auto x16Bits = static_cast<unsigned short>(((x+1)/2) * 65535);
-        const auto y16Bits = static_cast<unsigned short>(((y+1)/2) * 65535);
-        // Push X - LSB first
-        push16bits(fullData,x16Bits);
-        // Push Y - LSB first
-        push16bits(fullData,y16Bits);
-        // Push R - LSB first
-        push16bits(fullData,0xFFFF);
-        // Push G - LSB first
-        push16bits(fullData,0);
-        // Push B - LSB first
-        push16bits(fullData,0);
-    }
-}
-
-void generateDataForCircleAndTriangleFloat(std::vector<unsigned char>& fullData, const double animTime)
+void generateDataForCircleAndTriangle(std::vector<unsigned char>& fullData, const double animTime, const unsigned char dataFormat)
 {
-    // Generate circle data with  points
-    fullData.push_back(PONK_DATA_FORMAT_XY_F32_RGB_U8); // Write Format Data
+    // The path writer gives the layout of each point format, points are given as floats:
+    // X,Y in [-1,+1], R,G,B in [0,1]
+    Ponk::PathWriter writer;
 
-    // Meta Data
-    fullData.push_back(2); // Write meta data count
-    pushMetaData(fullData,"PATHNUMB",1.f);
-    pushMetaData(fullData,"MAXSPEED",1.0f);
+    // Generate circle data with 4096 points
+    writer.beginPath(fullData,dataFormat);
+    writer.addMetaData("PATHNUMB",1.f);
+    writer.addMetaData("MAXSPEED",1.0f);
 
-    // Write point count - LSB first
     constexpr int kCirclePointCount = 4096;
     constexpr float kCircleMoveSize = 0.2f;
     constexpr float kCircleSize = 0.5f;
-    push16bits(fullData,kCirclePointCount);
-    // Write CIRCLE_POINT_COUNT points
     const auto circleCenterX = kCircleMoveSize * cos(animTime*3);
     const auto circleCenterY = kCircleMoveSize * sin(animTime*3);
     for (int i=0; i<kCirclePointCount; i++) {
@@ -218,80 +195,121 @@ void generateDataForCircleAndTriangleFloat(std::vector<unsigned char>& fullData,
         const auto x = static_cast<float>(circleCenterX + kCircleSize * cos(normalizedPosInCircle*2*M_PI));
         const auto y = static_cast<float>(circleCenterY + kCircleSize * sin(normalizedPosInCircle*2*M_PI));
         assert(x>=-1 && x<=1 && y>=-1 && y<=1);
-        // Push X - LSB first
-        push32bits(fullData,x);
-        // Push Y - LSB first
-        push32bits(fullData,y);
-        // Push R - LSB first
-        push8bits(fullData,0xFF);
-        // Push G - LSB first
-        push8bits(fullData,0xFF);
-        // Push B - LSB first
-        push8bits(fullData,0xFF);
+        writer.addPoint(x,y,1,1,1);
     }
+    writer.endPath(); // Writes point count, and points for formats encoding the whole path
 
     // Generate a triangle with 4 points (to close it)
-    fullData.push_back(PONK_DATA_FORMAT_XY_F32_RGB_U8); // Write Format Data
-
-    // Meta Data
-    fullData.push_back(1); // Write meta data count
-    pushMetaData(fullData,"PATHNUMB",2.f);
+    writer.beginPath(fullData,dataFormat);
+    writer.addMetaData("PATHNUMB",2.f);
 
-    // Write point count - LSB first
     constexpr int kTriangePointCount = 4;
     constexpr float kTriangleSize = 0.5f;
-    push16bits(fullData,kTriangePointCount);
     for (int i=0; i<kTriangePointCount; i++) {
         const auto normalizedPosInTriangle = double(i)/(kTriangePointCount-1);
         const auto x = static_cast<float>(kTriangleSize * cos(normalizedPosInTriangle*2*M_PI));
         const auto y = static_cast<float>(kTriangleSize * sin(normalizedPosInTriangle*2*M_PI));
         assert(x>=-1 && x<=1 && y>=-1 && y<=1);
-        // Push X - LSB first
-        push32bits(fullData,x);
-        // Push Y - LSB first
-        push32bits(fullData,y);
-        // Push R - LSB first
-        push8bits(fullData,0xFF);
-        // Push G - LSB first
-        push8bits(fullData,0);
-        // Push B - LSB first
-        push8bits(fullData,0);
+        writer.addPoint(x,y,1,0,0);
     }
+    writer.endPath();
 }
 
 void generateDataFor1000TrianglesFloat(std::vector<unsigned char>& fullData, const double animTime)
 {
+    Ponk::PathWriter writer;
     for (int triangleNumber = 0; triangleNumber < 1000; triangleNumber++) {
         // Generate a triangle with 4 points (to close it)
-        fullData.push_back(PONK_DATA_FORMAT_XY_F32_RGB_U8); // Write Format Data
-
-        // Meta Data
-        fullData.push_back(1); // Write meta data count
-        pushMetaData(fullData,"PATHNUMB",2.f + triangleNumber);
+        writer.beginPath(fullData,PONK_DATA_FORMAT_XY_F32_RGB_U8);
+        writer.addMetaData("PATHNUMB",2.f + triangleNumber);
 
         constexpr float kMoveSize = 0.2f;
         const float centerX = kMoveSize * cos(animTime*3 + triangleNumber);
         const float centerY = kMoveSize * sin(animTime*3 + triangleNumber);
 
-        // Write point count - LSB first
         constexpr int kTriangePointCount = 4;
         constexpr float kTriangleSize = 0.5f;
-        push16bits(fullData,kTriangePointCount);
         for (int i=0; i<kTriangePointCount; i++) {
             const auto normalizedPosInTriangle = double(i)/(kTriangePointCount-1);
             const auto x = static_cast<float>(kTriangleSize * cos(normalizedPosInTriangle*2*M_PI)) + centerX;
             const auto y = static_cast<float>(kTriangleSize * sin(normalizedPosInTriangle*2*M_PI)) + centerY;
             assert(x>=-1 && x<=1 && y>=-1 && y<=1);
-            // Push X - LSB first
-            push32bits(fullData,x);
-            // Push Y - LSB first
-            push32bits(fullData,y);
-            // Push R - LSB first
-            push8bits(fullData,0xFF);
-            // Push G - LSB first
-            push8bits(fullData,0);
-            // Push B - LSB first
-            push8bits(fullData,0);
+            writer.addPoint(x,y,1,0,0);
         }
+        writer.endPath();
+    }
+}
+
+void generateDataFor1000TrianglesInstanced(std::vector<unsigned char>& fullData, const double animTime)
+{
+    // Same triangles as generateDataFor1000TrianglesFloat: the triangle is sent once as a template, then each
+    // triangle as a translation (24 KB instead of 60 KB, and the template becomes a reference with the path cache)
+    std::vector<unsigned char> trianglePath;
+    Ponk::PathWriter writer;
+    writer.beginPath(trianglePath,PONK_DATA_FORMAT_XY_F32_RGB_U8);
+
+    // Meta Data: PATHNUMB is the template number
+    writer.addMetaData("PATHNUMB",1.f);
+
+    constexpr int kTriangePointCount = 4;
+    constexpr float kTriangleSize = 0.5f;
+    for (int i=0; i<kTriangePointCount; i++) {
+        const auto normalizedPosInTriangle = double(i)/(kTriangePointCount-1);
+        writer.addPoint(static_cast<float>(kTriangleSize * cos(normalizedPosInTriangle*2*M_PI)),
+                        static_cast<float>(kTriangleSize * sin(normalizedPosInTriangle*2*M_PI)),1,0,0);
+    }
+    writer.endPath();
+    Ponk::writePathTemplate(trianglePath,fullData);
+
+    // Instances get PATHNUMB 2, 3... as in generateDataFor1000TrianglesFloat
+    Ponk::PathInstanceEncoder instances;
+    instances.setFirstPathNumber(2);
+    for (int triangleNumber = 0; triangleNumber < 1000; triangleNumber++) {
+        constexpr float kMoveSize = 0.2f;
+        const float centerX = kMoveSize * cos(animTime*3 + triangleNumber);
+        const float centerY = kMoveSize * sin(animTime*3 + triangleNumber);
+        instances.addInstance(1,0,0,1,centerX,centerY);
+    }
+    instances.write(1,fullData);
+}
+
+void generateDataForCircleAndTriangleCurves(std::vector<unsigned char>& fullData, const double animTime)
+{
+    // Same shapes as generateDataForCircleAndTriangle, described by segments: the circle is a single
+    // arc (27 bytes instead of 45 KB), receivers sample it with as many points as they need
+    Ponk::CurvePathEncoder encoder;
+
+    // Circle
+    fullData.push_back(PONK_DATA_FORMAT_CURVES); // Write Format Data
+
+    // Meta Data
+    fullData.push_back(2); // Write meta data count
+    pushMetaData(fullData,"PATHNUMB",1.f);
+    pushMetaData(fullData,"MAXSPEED",1.0f);
+
+    constexpr float kCircleMoveSize = 0.2f;
+    constexpr float kCircleSize = 0.5f;
+    const auto circleCenterX = static_cast<float>(kCircleMoveSize * cos(animTime*3));
+    const auto circleCenterY = static_cast<float>(kCircleMoveSize * sin(animTime*3));
+    encoder.moveTo(circleCenterX + kCircleSize,circleCenterY,0xFF,0xFF,0xFF);
+    encoder.arcTo(circleCenterX,circleCenterY,static_cast<float>(2*M_PI),0xFF,0xFF,0xFF);
+    // Write segment count - LSB first
+    push16bits(fullData,encoder.segmentCount());
+    encoder.write(fullData);
+
+    // Triangle with 3 lines
+    fullData.push_back(PONK_DATA_FORMAT_CURVES); // Write Format Data
+
+    // Meta Data
+    fullData.push_back(1); // Write meta data count
+    pushMetaData(fullData,"PATHNUMB",2.f);
+
+    constexpr float kTriangleSize = 0.5f;
+    encoder.moveTo(kTriangleSize,0,0xFF,0,0);
+    for (int i=1; i<=3; i++) {
+        const auto angle = i*2*M_PI/3;
+        encoder.lineTo(static_cast<float>(kTriangleSize * cos(angle)),static_cast<float>(kTriangleSize * sin(angle)),0xFF,0,0);
     }
+    push16bits(fullData,encoder.segmentCount());
+    encoder.write(fullData);
 }
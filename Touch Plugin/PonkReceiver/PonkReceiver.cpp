@@ -6,6 +6,7 @@
 #include <string.h>
 #include <assert.h>
 #include <chrono>
+#include <random>
 
 extern "C"
 {
@@ -56,6 +57,8 @@ DestroySOPInstance(SOP_CPlusPlusBase* instance)
 
 PonkReceiver::PonkReceiver(const OP_NodeInfo* info)
 {
+	m_receiverIdentifier = std::random_device()();
+
 	m_socket = new DatagramSocket(INADDR_ANY, PONK_PORT);
 	m_socket->joinMulticastGroup(PONK_MULTICAST_IP, INADDR_ANY);
 
@@ -99,6 +102,8 @@ PonkReceiver::receiveThreadFunc()
 
 	while (m_running)
 	{
+		publishScheduledFrames();
+
 		unsigned int bufferSize = static_cast<unsigned int>(sizeof(buffer));
 		GenericAddr sourceAddr;
 
@@ -114,114 +119,341 @@ PonkReceiver::receiveThreadFunc()
 		if (bufferSize == 0)
 		{
 			// No data available yet, yield and try again.
+			sendBackChannelMessages();
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 			continue;
 		}
 
-		// Packet must be at least large enough to hold a full header.
-		if (bufferSize < sizeof(GeomUdpHeader))
+		// Sender announcements carry the name of senders using the compact header.
+		if (m_senderNames.readAnnouncement(buffer, bufferSize))
 			continue;
 
-		const GeomUdpHeader* header = reinterpret_cast<const GeomUdpHeader*>(buffer);
-
-		// Validate the magic string to confirm this is a PONK packet.
-		if (strncmp(header->headerString, PONK_HEADER_STRING, 8) != 0)
+		// Clock sync responses from senders we asked for their clock.
+		GeomUdpClockSync clockSync;
+		if (Ponk::readClockSync(buffer, bufferSize, clockSync))
+		{
+			auto it = m_senderLinks.find(clockSync.senderIdentifier);
+			if (it != m_senderLinks.end())
+				it->second.clockSync.addResponse(clockSync);
 			continue;
+		}
 
-		// Reject packets from a protocol version we don't support.
-		// Version 0 is the only one defined; newer breaking versions will have a higher number.
-		if (header->protocolVersion > 0)
+		// Validate the magic string and size, and reject packets from a protocol version
+		// we don't support (newer breaking versions will have a higher number).
+		Ponk::ChunkHeader header;
+		const size_t headerSize = Ponk::readChunkHeader(buffer, bufferSize, header);
+		if (headerSize == 0)
 			continue;
+		m_senderNames.fillName(header);
 
 		// Each sender is tracked independently, identified by its 32-bit sender ID.
-		const unsigned int senderId = header->senderIdentifier;
-
-		// Look up (or create) the chunk assembly state for this sender.
-		ChunkAssembly& asm_ = m_assemblies[senderId];
+		const unsigned int senderId = header.senderIdentifier;
+
+		// Clock sync requests (for senders stamping their frames) and feedback are sent back to the
+		// address senders send from.
+		SenderLink& link = m_senderLinks[senderId];
+		link.address = sourceAddr;
+		if (header.flags & PONK_FLAG_TIMESTAMP)
+			link.clockSyncEnabled = true;
+		link.frameNumberMask = Ponk::frameNumberMask(header.protocolVersion);
+
+		// Look up (or start) the assembly of this frame. A few frames of each sender are assembled at once,
+		// so frames interleaved by paced or multi-path senders all complete. Late chunks of frames already
+		// completed or superseded (parity chunks not needed, duplicates) are ignored, they would otherwise
+		// start assembling that frame again.
+		Ponk::FrameAssemblyWindow<ChunkAssembly>& window = m_assemblies[senderId];
+		auto dropFrame = [&](ChunkAssembly& dropped)
+		{
+			// Chunks of path-aligned frames can be parsed alone: show what we got of the lost frame.
+			if (m_partialFrames && (dropped.flags & PONK_FLAG_PATH_ALIGNED))
+				storePartialFrame(senderId, dropped);
+		};
+		ChunkAssembly* assembly = window.acquire(header.frameNumber, header.protocolVersion, dropFrame);
+		if (!assembly)
+			continue;
+		ChunkAssembly& asm_ = *assembly;
 
-		// If we have an in-progress assembly for this sender, check whether the
-		// incoming packet belongs to the same frame. Any mismatch (new frame number,
-		// different chunk count, or different CRC) means the previous frame was
-		// either lost or superseded — discard it and start fresh.
-		if (asm_.frameNumber != -1 && header->frameNumber != asm_.frameNumber)
+		// Any mismatch with the assembly of this frame (different chunk count, CRC or parity chunk count)
+		// means a buggy sender: discard it and start fresh.
+		if (asm_.frameNumber != -1 && asm_.chunkCount != static_cast<int>(header.chunkCount))
 			asm_.reset();
 
-		if (asm_.frameNumber != -1 && asm_.chunkCount != header->chunkCount)
+		if (asm_.frameNumber != -1 && asm_.dataCrc != header.dataCrc)
 			asm_.reset();
 
-		if (asm_.frameNumber != -1 && asm_.dataCrc != header->dataCrc)
+		if (asm_.frameNumber != -1 && asm_.parityChunkCount != header.parityChunkCount)
 			asm_.reset();
 
-		// Record the frame metadata from this packet's header.
-		asm_.frameNumber = header->frameNumber;
-		asm_.chunkCount = header->chunkCount;
-		asm_.dataCrc = header->dataCrc;
-		memcpy(asm_.senderName, header->senderName, sizeof(asm_.senderName));
+		// Start of a new frame (up to 65535 chunks with protocol version 2): chunks are written in place in the
+		// assembly frame buffer. Prepare parity groups if the sender uses forward error correction.
+		if (asm_.frameNumber == -1)
+		{
+			asm_.chunks.start(header.chunkCount);
+			asm_.fec.reset(header.chunkCount, header.parityChunkCount);
+		}
 
-		// Sanity checks on chunk indices before storing.
-		if (header->chunkCount == 0)
+		// Record the frame metadata from this packet's header.
+		asm_.frameNumber = header.frameNumber;
+		asm_.chunkCount = header.chunkCount;
+		asm_.dataCrc = header.dataCrc;
+		asm_.parityChunkCount = header.parityChunkCount;
+		asm_.flags = header.flags;
+		asm_.timestamp = header.timestamp;
+		memcpy(asm_.senderName, header.senderName, sizeof(asm_.senderName));
+
+		// Sanity checks on chunk indices before storing. Parity chunks are numbered after data chunks.
+		if (header.chunkCount == 0)
 			continue;
 
-		if (header->chunkNumber >= header->chunkCount)
+		if (header.chunkNumber >= header.chunkCount + header.parityChunkCount)
 			continue;
 
-		// Skip duplicate chunks (can happen with multicast retransmission).
-		if (asm_.received[header->chunkNumber])
-			continue;
+		asm_.nack.chunkReceived();
 
-		// Copy this chunk's payload (everything after the header) into the assembly buffer.
-		const unsigned int dataLength = bufferSize - sizeof(GeomUdpHeader);
-		const unsigned int dataStart = sizeof(GeomUdpHeader);
-		asm_.chunks[header->chunkNumber].assign(
-			buffer + dataStart,
-			buffer + dataStart + dataLength);
-		asm_.received[header->chunkNumber] = true;
-
-		// Check if all chunks have arrived.
-		bool complete = true;
-		for (int i = 0; i < header->chunkCount; i++)
+		const unsigned char* payload = buffer + headerSize;
+		const size_t payloadSize = bufferSize - headerSize;
+		const bool compressed = (header.flags & PONK_FLAG_COMPRESSED) != 0;
+		if (header.chunkNumber < header.chunkCount)
 		{
-			if (!asm_.received[i])
+			// Skip duplicate chunks (can happen with multicast retransmission, or when a chunk
+			// arrives after being rebuilt from parity).
+			if (asm_.chunks.received(header.chunkNumber))
+				continue;
+
+			// Compressed chunks are independent blocks, so they are decompressed right away, in place.
+			const bool stored = compressed ? asm_.chunks.storeCompressedChunk(header.chunkNumber, payload, payloadSize)
+										   : asm_.chunks.storeChunk(header.chunkNumber, payload, payloadSize);
+			if (!stored)
+				continue;
+		}
+
+		// Forward error correction: accumulate the chunk in its parity group, and rebuild the missing
+		// data chunk of the group once all its other chunks are in.
+		if (asm_.fec.enabled() && asm_.fec.addChunk(header.chunkNumber, payload, payloadSize))
+		{
+			unsigned int recoveredChunkNumber = 0;
+			if (asm_.fec.recoverChunk(header.chunkNumber, recoveredChunkNumber, m_recoveredChunk)
+				&& !asm_.chunks.received(recoveredChunkNumber))
 			{
-				complete = false;
-				break;
+				if (compressed)
+					asm_.chunks.storeCompressedChunk(recoveredChunkNumber, m_recoveredChunk.data(), m_recoveredChunk.size());
+				else
+					asm_.chunks.storeChunk(recoveredChunkNumber, m_recoveredChunk.data(), m_recoveredChunk.size());
 			}
 		}
 
-		if (!complete)
+		// Check if all chunks have arrived (counted as they are stored, no scan of the chunk slots).
+		if (!asm_.chunks.complete())
 			continue;
 
-		// All chunks are in — concatenate them in order to rebuild the full frame payload.
-		std::vector<unsigned char> allData;
-		allData.reserve(static_cast<size_t>(header->chunkCount) * PONK_MAX_CHUNK_SIZE);
-		for (int i = 0; i < header->chunkCount; i++)
-			allData.insert(allData.end(), asm_.chunks[i].begin(), asm_.chunks[i].end());
+		// All chunks are in: they are packed in place in the assembly frame buffer, which stays valid until
+		// the assembly starts another frame.
+		size_t allDataSize = 0;
+		const unsigned char* allData = asm_.chunks.finish(allDataSize);
 
-		// Release the assembly slot so it's ready for the next frame from this sender.
-		asm_.reset();
+		// Frames are used in order: older frames still being assembled are dropped. Release the assembly
+		// so it's ready for a next frame from this sender.
+		window.release(asm_, dropFrame);
 
 		// Validate integrity: the CRC is a simple byte sum over the entire payload.
 		// If it doesn't match, the frame was corrupted in transit — discard it.
 		unsigned int computedCrc = 0;
-		for (auto v : allData)
-			computedCrc += v;
+		for (size_t i = 0; i < allDataSize; i++)
+			computedCrc += allData[i];
+
+		if (computedCrc != header.dataCrc)
+			continue;
+
+		// Path-aligned frames: merge back paths the sender split in pieces to fit chunks.
+		const unsigned char* frameData = allData;
+		size_t frameDataSize = allDataSize;
+		if (header.flags & PONK_FLAG_PATH_ALIGNED)
+		{
+			m_merger.clear();
+			m_merger.addChunk(allData, allDataSize, true);
+			const std::vector<unsigned char>& mergedData = m_merger.finish();
+			frameData = mergedData.data();
+			frameDataSize = mergedData.size();
+		}
+
+		// Expand paths using the frame meta data table back to regular paths.
+		if (Ponk::usesMetaDataTable(frameData, frameDataSize))
+		{
+			if (!m_metaDataTable.decodeFrame(frameData, frameDataSize, m_expandedData))
+				continue;
+			frameData = m_expandedData.data();
+			frameDataSize = m_expandedData.size();
+		}
 
-		if (computedCrc != header->dataCrc)
+		// Rebuild paths the sender replaced by references to previous frames (inter-frame path
+		// caching). If a referenced path was never received, drop the frame until the next keyframe,
+		// or only leave that path out when partial frames are accepted.
+		Ponk::PathCacheDecoder& pathCache = m_pathCaches[senderId];
+		const Ponk::PathCacheDecodeMode decodeMode = m_partialFrames ? Ponk::PathCacheDecodeMode::SkipMissingPaths
+																	 : Ponk::PathCacheDecodeMode::Strict;
+		if (!pathCache.decodeFrame(frameData, frameDataSize, static_cast<unsigned char>(header.frameNumber),
+								   m_decodedData, decodeMode))
 			continue;
 
 		// Frame is complete and valid — parse paths and store for the main thread to consume.
-		parseAndStoreFrame(senderId, header->senderName, allData);
+		parseAndStoreFrame(senderId, header.senderName, header.frameNumber, header.timestamp, m_decodedData);
 	}
 }
 
 
+void
+PonkReceiver::sendBackChannelMessages()
+{
+	const unsigned long long now = Ponk::clockMicroseconds();
+	for (auto& kv : m_senderLinks)
+	{
+		SenderLink& link = kv.second;
+		if (link.clockSyncEnabled && link.clockSync.requestDue(kv.first, m_backChannelPacket))
+			m_socket->sendTo(link.address, m_backChannelPacket.data(), static_cast<unsigned int>(m_backChannelPacket.size()));
+
+		// Feedback 4 times per second, once we used frames of this sender
+		if (!m_sendFeedback || now < link.nextFeedbackTime)
+			continue;
+		link.nextFeedbackTime = now + 250000;
+		const auto slotIndex = m_senderSlotIndices.find(kv.first);
+		if (slotIndex == m_senderSlotIndices.end())
+			continue;
+		const SenderSlot& slot = m_senderSlots[slotIndex->second];
+		if (!slot.consumed)
+			continue;
+		// Backlog: frames handed to execute after the one it used. Frames waiting for their present time are not
+		// late, senders would otherwise skip frames whenever the playout delay is longer than a few frames.
+		const unsigned int queueDepth = slot.publishedFrames - slot.lastConsumedPublishNumber;
+		Ponk::writeFeedback(kv.first, m_receiverIdentifier, slot.lastConsumedFrameNumber,
+							queueDepth, m_outputFrameRate, m_backChannelPacket);
+		m_socket->sendTo(link.address, m_backChannelPacket.data(), static_cast<unsigned int>(m_backChannelPacket.size()));
+	}
+
+	// Frames that stopped receiving chunks: ask their sender for the missing ones only
+	if (!m_requestRetransmit)
+		return;
+	for (auto& kv : m_assemblies)
+	{
+		const auto link = m_senderLinks.find(kv.first);
+		if (link == m_senderLinks.end())
+			continue;
+		for (unsigned int i = 0; i < kv.second.size(); i++)
+		{
+			ChunkAssembly& assembly = kv.second[i];
+			if (assembly.frameNumber == -1 || assembly.chunkCount <= 0 || !assembly.nack.due())
+				continue;
+			if (Ponk::writeNack(kv.first, static_cast<unsigned int>(assembly.frameNumber), assembly.chunks,
+								static_cast<unsigned int>(assembly.chunkCount), m_backChannelPacket))
+				m_socket->sendTo(link->second.address, m_backChannelPacket.data(), static_cast<unsigned int>(m_backChannelPacket.size()));
+		}
+	}
+}
+
+
+void
+PonkReceiver::storePartialFrame(unsigned int senderIdentifier, const ChunkAssembly& assembly)
+{
+	// Merge the paths of received chunks in order. A path piece following a missing chunk
+	// starts a new path.
+	m_merger.clear();
+	bool previousChunkReceived = false;
+	bool anyChunkReceived = false;
+	for (int i = 0; i < assembly.chunkCount; i++)
+	{
+		const bool received = assembly.chunks.received(i);
+		if (received)
+		{
+			m_merger.addChunk(assembly.chunks.chunk(i), assembly.chunks.chunkSize(i), previousChunkReceived);
+			anyChunkReceived = true;
+		}
+		previousChunkReceived = received;
+	}
+	if (!anyChunkReceived)
+		return;
+
+	// The CRC can't be checked on a partial frame, and paths may be incomplete so the path
+	// cache is left untouched.
+	const std::vector<unsigned char>* frameData = &m_merger.finish();
+	if (Ponk::usesMetaDataTable(frameData->data(), frameData->size()))
+	{
+		if (!m_metaDataTable.decodeFrame(frameData->data(), frameData->size(), m_expandedData))
+			return;
+		frameData = &m_expandedData;
+	}
+	if (!m_pathCaches[senderIdentifier].decodeFrame(frameData->data(), frameData->size(),
+													static_cast<unsigned char>(assembly.frameNumber), m_decodedData,
+													Ponk::PathCacheDecodeMode::PartialFrame))
+		return;
+
+	parseAndStoreFrame(senderIdentifier, assembly.senderName, static_cast<unsigned int>(assembly.frameNumber),
+					   assembly.timestamp, m_decodedData);
+}
+
+
 void
 PonkReceiver::parseAndStoreFrame(unsigned int senderIdentifier,
 							  const char* senderNameRaw,
-							  const std::vector<unsigned char>& data)
+							  unsigned int frameNumber,
+							  unsigned long long timestamp,
+							  const std::vector<unsigned char>& frameData)
 {
-	SenderFrame frame;
+	// Instances of template paths are expanded to regular paths first
+	const std::vector<unsigned char>* instancedData = &frameData;
+	if (Ponk::hasPathInstances(frameData.data(), frameData.size()))
+	{
+		if (!m_instanceExpander.expandFrame(frameData.data(), frameData.size(), m_instancedData))
+			return;
+		instancedData = &m_instancedData;
+	}
+
+	// Then curve paths are sampled to points, at our tolerance and point budget
+	const bool hasCurves = Ponk::hasCurvePaths(instancedData->data(), instancedData->size());
+	if (hasCurves)
+	{
+		m_curveTessellator.setTolerance(m_curveTolerance);
+		m_curveTessellator.setPointBudget(static_cast<unsigned int>(m_curvePointBudget));
+		if (!m_curveTessellator.tessellateFrame(instancedData->data(), instancedData->size(), m_tessellatedData))
+			return;
+	}
+	const std::vector<unsigned char>& data = hasCurves ? m_tessellatedData : *instancedData;
+
+	// A recycled frame: its arrays are already sized for the frames of this sender
+	std::unique_ptr<SenderFrame> pooledFrame = m_framePools[senderIdentifier].acquire();
+	SenderFrame& frame = *pooledFrame;
 	frame.senderIdentifier = senderIdentifier;
+	frame.frameNumber = frameNumber;
+
+	// Frames stamped by senders we are synchronized with: measure latency, and schedule them
+	// at capture time + playout delay so all receivers synchronized to this sender show them together.
+	const auto link = m_senderLinks.find(senderIdentifier);
+	if (timestamp != 0 && link != m_senderLinks.end() && link->second.clockSync.synchronized())
+	{
+		const unsigned long long captureTime = link->second.clockSync.toLocalTime(timestamp);
+		frame.latency = static_cast<float>(static_cast<int64_t>(Ponk::clockMicroseconds() - captureTime) / 1000.0);
+		if (m_playoutDelay > 0)
+			frame.presentTime = captureTime + m_playoutDelay;
+	}
+
+	// With the jitter buffer, frames of any sender are scheduled at a steady cadence instead, the playout
+	// delay (or more if the network jitters more) after their expected arrival.
+	Ponk::JitterBuffer* jitterBuffer = nullptr;
+	if (link != m_senderLinks.end())
+	{
+		if (m_jitterBuffer)
+		{
+			jitterBuffer = &link->second.jitterBuffer;
+			jitterBuffer->setTargetDelay(static_cast<unsigned int>(m_playoutDelay.load()));
+			if (!jitterBuffer->schedule(frameNumber, link->second.frameNumberMask, Ponk::clockMicroseconds(), frame.presentTime))
+			{
+				m_framePools[senderIdentifier].recycle(std::move(pooledFrame));
+				return;
+			}
+		}
+		else
+		{
+			link->second.jitterBuffer.reset();
+		}
+	}
 
 	// The sender name is a fixed 32-byte field, not necessarily null-terminated within
 	// those 32 bytes, so we copy into a 33-byte buffer and force a terminator.
@@ -230,123 +462,150 @@ PonkReceiver::parseAndStoreFrame(unsigned int senderIdentifier,
 	nameBuf[32] = '\0';
 	frame.senderName = nameBuf;
 
-	const size_t dataSize = data.size();
-	unsigned int offset = 0;
-
-	// Each iteration of this loop parses one path from the payload.
-	// The binary layout per path is:
-	//   [1 byte] data format
-	//   [1 byte] metadata count
-	//   [N x 12 bytes] metadata entries (8-byte key + 4-byte float value)
-	//   [2 bytes LE] point count
-	//   [pointCount x bytesPerPoint] point data
-	// We break out early if the remaining data is too short (truncated/corrupt frame).
-	while (offset < dataSize)
-	{
-		// Data format selects how each point is encoded.
-		if (dataSize < offset + 1)
-			break;
-		const unsigned char dataFormat = data[offset++];
-
-		// Number of metadata key-value pairs attached to this path.
-		if (dataSize < offset + 1)
+	// Paths are read in place; a truncated or unsupported path ends the frame.
+	Ponk::FrameView frameView(data.data(), data.size());
+	Ponk::PathView pathView;
+	frame.pathMetadata.reserve(frameView.pathCount());
+	while (frameView.next(pathView))
+	{
+		// X,Y in [-1, +1], R,G,B in [0, 1] whatever the data format, decoded straight into the frame arrays.
+		if (!pathView.decodePoints(frame.points.addPath(pathView.pointCount())))
+		{
+			frame.points.removeLastPath();
 			break;
-		const unsigned char metaCount = data[offset++];
+		}
 
-		ReceivedPath path;
+		// Keys are compared as 8 bytes integers and stored as small ids; keys past the table capacity are dropped.
+		frame.pathMetadata.emplace_back();
+		for (unsigned int m = 0; m < pathView.metaDataCount(); m++)
+		{
+			const unsigned int keyId = m_metaDataKeys.intern(Ponk::packMetaDataKey(pathView.metaDataKey(m)));
+			if (keyId != Ponk::kInvalidMetaDataKeyId)
+				frame.pathMetadata.back().add(keyId, pathView.metaDataValue(m));
+		}
+	}
 
-		// Each metadata entry is 12 bytes: an 8-character EightCC key and a 4-byte float.
-		// Keys shorter than 8 characters are padded with null bytes on the sender side;
-		// we trim trailing nulls so the stored key matches its natural length.
-		if (dataSize < offset + 12u * metaCount)
-			break;
-		for (int m = 0; m < metaCount; m++)
+	if (jitterBuffer)
+	{
+		SenderSlot* slot = senderSlot(senderIdentifier);
+		if (slot)
 		{
-			const char* keyPtr = reinterpret_cast<const char*>(&data[offset]);
-			int keyLen = 8;
-			while (keyLen > 0 && keyPtr[keyLen - 1] == '\0') --keyLen;
-			std::string key(keyPtr, keyLen);
-			offset += 8;
-			float value;
-			memcpy(&value, &data[offset], sizeof(float));
-			offset += 4;
-			path.metadata[key] = value;
+			slot->underruns = jitterBuffer->underruns();
+			slot->overruns = jitterBuffer->overruns();
+			slot->jitterDelay = static_cast<float>(jitterBuffer->delay() / 1000.0);
 		}
+	}
 
-		// Point count is a 16-bit little-endian unsigned integer.
-		if (dataSize < offset + 2)
-			break;
-		const unsigned short pointCount =
-			static_cast<unsigned short>(data[offset]) |
-			(static_cast<unsigned short>(data[offset + 1]) << 8);
-		offset += 2;
-
-		// Determine the stride (bytes per point) based on the data format.
-		// Unknown formats are not supported — skip the rest of this frame.
-		unsigned int bytesPerPoint = 0;
-		if (dataFormat == PONK_DATA_FORMAT_XYRGB_U16)
-			bytesPerPoint = 5 * sizeof(unsigned short);  // X, Y, R, G, B — each 16 bits
-		else if (dataFormat == PONK_DATA_FORMAT_XY_F32_RGB_U8)
-			bytesPerPoint = 2 * sizeof(float) + 3;       // X, Y as float32; R, G, B as uint8
-		else
-			break;
+	// Frames with a present time wait in the schedule queue, others replace the sender's latest frame.
+	if (frame.presentTime > Ponk::clockMicroseconds())
+	{
+		std::vector<std::unique_ptr<SenderFrame>>& scheduled = m_scheduledFrames[senderIdentifier];
+		// Bound the queue if the playout delay is far too long for the frame rate
+		if (scheduled.size() >= 256)
+		{
+			if (jitterBuffer)
+				jitterBuffer->countOverrun();
+			publishFrame(senderIdentifier, std::move(scheduled.front()));
+			scheduled.erase(scheduled.begin());
+		}
+		scheduled.push_back(std::move(pooledFrame));
+		return;
+	}
+	publishFrame(senderIdentifier, std::move(pooledFrame));
+}
 
-		// Guard against a point count that would read past the end of the buffer.
-		if (dataSize < offset + static_cast<size_t>(pointCount) * bytesPerPoint)
-			break;
+PonkReceiver::SenderSlot*
+PonkReceiver::senderSlot(unsigned int senderIdentifier)
+{
+	const auto it = m_senderSlotIndices.find(senderIdentifier);
+	if (it != m_senderSlotIndices.end())
+		return &m_senderSlots[it->second];
 
-		path.points.reserve(pointCount);
+	// Slots are given out in order, not when first published: a sender whose first frames are scheduled
+	// gets its own slot, which execute doesn't see until its first frame is published.
+	if (m_allocatedSenderSlots == kMaxSenders)
+	{
+		m_senderSlotsFull = true;
+		return nullptr;
+	}
+	const unsigned int index = m_allocatedSenderSlots++;
+	m_senderSlotIndices[senderIdentifier] = index;
+	m_senderSlots[index].senderIdentifier = senderIdentifier;
+	return &m_senderSlots[index];
+}
 
-		for (int i = 0; i < pointCount; i++)
-		{
-			ReceivedPoint pt;
+void
+PonkReceiver::publishFrame(unsigned int senderIdentifier, std::unique_ptr<SenderFrame> frame)
+{
+	SenderSlot* slot = senderSlot(senderIdentifier);
+	if (!slot)
+	{
+		m_framePools[senderIdentifier].recycle(std::move(frame));
+		return;
+	}
 
-			if (dataFormat == PONK_DATA_FORMAT_XYRGB_U16)
-			{
-				// All five components are 16-bit unsigned integers in little-endian order.
-				// X and Y are mapped from [0, 65535] to [-1, +1].
-				// R, G, B are mapped from [0, 65535] to [0, 1].
-				auto read16 = [&]() -> unsigned short {
-					unsigned short v = static_cast<unsigned short>(data[offset]) |
-									   (static_cast<unsigned short>(data[offset + 1]) << 8);
-					offset += 2;
-					return v;
-				};
-				unsigned short x16 = read16();
-				unsigned short y16 = read16();
-				unsigned short r16 = read16();
-				unsigned short g16 = read16();
-				unsigned short b16 = read16();
-
-				pt.x = -1.0f + 2.0f * (x16 / 65535.0f);
-				pt.y = -1.0f + 2.0f * (y16 / 65535.0f);
-				pt.r = r16 / 65535.0f;
-				pt.g = g16 / 65535.0f;
-				pt.b = b16 / 65535.0f;
-			}
-			else if (dataFormat == PONK_DATA_FORMAT_XY_F32_RGB_U8)
-			{
-				// X and Y are 32-bit floats (already in [-1, +1] or any float range).
-				// R, G, B are single bytes mapped from [0, 255] to [0, 1].
-				memcpy(&pt.x, &data[offset], sizeof(float));
-				offset += sizeof(float);
-				memcpy(&pt.y, &data[offset], sizeof(float));
-				offset += sizeof(float);
-				pt.r = data[offset++] / 255.0f;
-				pt.g = data[offset++] / 255.0f;
-				pt.b = data[offset++] / 255.0f;
-			}
+	// The frame replaced in the back buffer goes back to the pool with its storage
+	frame->publishNumber = ++slot->publishedFrames;
+	std::swap(slot->frames.back(), *frame);
+	slot->frames.publish();
+	m_framePools[senderIdentifier].recycle(std::move(frame));
+
+	// A new slot is visible to execute once it holds a frame. Earlier slots made visible with it that hold
+	// none yet stay hidden in execute until their first frame.
+	const unsigned int index = static_cast<unsigned int>(slot - m_senderSlots.get());
+	if (index >= m_senderSlotCount.load(std::memory_order_relaxed))
+		m_senderSlotCount.store(index + 1, std::memory_order_release);
+}
 
-			path.points.push_back(pt);
-		}
+void
+PonkReceiver::publishScheduledFrames()
+{
+	if (m_resetSenderSlots.load(std::memory_order_acquire))
+		resetSenderSlots();
 
-		frame.paths.push_back(std::move(path));
+	// Publish the latest frame whose present time has come, earlier ones would be overwritten anyway
+	unsigned long long now = 0;
+	for (auto& kv : m_scheduledFrames)
+	{
+		std::vector<std::unique_ptr<SenderFrame>>& scheduled = kv.second;
+		if (scheduled.empty())
+			continue;
+		if (now == 0)
+			now = Ponk::clockMicroseconds();
+		size_t due = 0;
+		while (due < scheduled.size() && scheduled[due]->presentTime <= now)
+			due++;
+		if (due == 0)
+			continue;
+		Ponk::FramePool<SenderFrame>& pool = m_framePools[kv.first];
+		for (size_t i = 0; i + 1 < due; i++)
+			pool.recycle(std::move(scheduled[i]));
+		publishFrame(kv.first, std::move(scheduled[due - 1]));
+		scheduled.erase(scheduled.begin(), scheduled.begin() + due);
 	}
+}
 
-	// Publish the parsed frame under the lock so execute() on the main thread
-	// can safely read it. Replaces any previously stored frame for this sender.
-	std::lock_guard<std::mutex> lock(m_mutex);
-	m_latestFrames[senderIdentifier] = std::move(frame);
+void
+PonkReceiver::resetSenderSlots()
+{
+	m_senderSlotIndices.clear();
+	m_scheduledFrames.clear();
+	m_framePools.clear();
+	for (unsigned int i = 0; i < m_allocatedSenderSlots; i++)
+	{
+		SenderSlot& slot = m_senderSlots[i];
+		slot.consumed = false;
+		slot.lastConsumedFrameNumber = 0;
+		slot.lastConsumedPublishNumber = 0;
+		slot.publishedFrames = 0;
+		slot.underruns = 0;
+		slot.overruns = 0;
+		slot.jitterDelay = 0;
+	}
+	m_allocatedSenderSlots = 0;
+	m_senderSlotCount.store(0, std::memory_order_relaxed);
+	m_senderSlotsFull = false;
+	m_resetSenderSlots.store(false, std::memory_order_release);
 }
 
 
@@ -362,6 +621,14 @@ PonkReceiver::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserve
 	if (!inputs->getParInt("Active"))
 		return;
 
+	m_partialFrames = inputs->getParInt("Partialframes") != 0;
+	m_playoutDelay = static_cast<int>(inputs->getParDouble("Playoutdelay") * 1000);
+	m_jitterBuffer = inputs->getParInt("Jitterbuffer") != 0;
+	m_curveTolerance = static_cast<float>(inputs->getParDouble("Curvetolerance"));
+	m_curvePointBudget = inputs->getParInt("Curvepointbudget");
+	m_sendFeedback = inputs->getParInt("Feedback") != 0;
+	m_requestRetransmit = inputs->getParInt("Retransmit") != 0;
+
 	// The Sender parameter is either "*" (all senders) or the string representation
 	// of a specific sender's 32-bit identifier. We parse it once here and use
 	// filterAll / filterSenderId throughout to decide which frames to output.
@@ -371,47 +638,80 @@ PonkReceiver::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserve
 	if (!filterAll && senderParVal)
 		filterSenderId = static_cast<unsigned int>(std::strtoul(senderParVal, nullptr, 10));
 
-	// Hold the mutex for the entire cook so the receive thread cannot overwrite
-	// m_latestFrames while we are reading it.
-	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_senderSlotsFull)
+		m_errorMessage = "More than " + std::to_string(kMaxSenders) + " senders: frames of new senders are ignored, pulse Refresh to forget senders";
+
+	// Take the latest frame of each sender: the receive thread keeps publishing newer ones while we cook,
+	// without waiting for us. Slots below the count hold at least one frame.
+	const unsigned int senderSlotCount = visibleSenderSlotCount();
+	for (unsigned int i = 0; i < senderSlotCount; i++)
+	{
+		if (m_senderSlots[i].frames.update())
+			m_senderSlots[i].hidden = false;
+	}
 
 	// Reset per-cook stats; they will be repopulated below.
 	m_numSenders = 0;
 	m_numPaths = 0;
 	m_numPoints = 0;
+	m_maxLatency = -1;
+	m_underruns = 0;
+	m_overruns = 0;
+	m_maxJitterDelay = 0;
 	m_senderList.clear();
+	m_outputRate.frameConsumed();
+	m_outputFrameRate = m_outputRate.rate();
 
-	if (m_latestFrames.empty())
+	if (senderSlotCount == 0)
 		return;
 
 	// --- Pass 1: build the sender list (used by Info DAT and the dynamic menu)
 	// and, for senders that pass the filter, tally the total point count and
 	// collect the union of all metadata keys across all paths.
 	//
-	// metaKeyIndex maps each unique metadata key to a dense integer index so we
-	// can address the flat metaArrays storage below without a string lookup per point.
-	std::unordered_map<std::string, int> metaKeyIndex;
+	// Metadata keys are interned ids: m_metaKeyIds lists the ones used, and
+	// m_metaArrays is indexed by id, so there is no string lookup per path or point.
+	m_metaKeyIds.clear();
+	m_metaKeyUsed.assign(m_metaDataKeys.size(), 0);
 	int totalPoints = 0;
 
-	for (auto& kv : m_latestFrames)
+	for (unsigned int i = 0; i < senderSlotCount; i++)
 	{
+		SenderSlot& slot = m_senderSlots[i];
+		if (slot.hidden)
+			continue;
+		const SenderFrame& frame = slot.frames.front();
+
 		// Always add every known sender to the list regardless of the filter,
 		// so the Info DAT and the Sender drop-down stay up to date.
-		m_senderList.push_back({kv.second.senderName, kv.second.senderIdentifier});
+		m_senderList.push_back({frame.senderName, frame.senderIdentifier, frame.latency});
 
-		if (!filterAll && kv.first != filterSenderId)
+		if (!filterAll && slot.senderIdentifier != filterSenderId)
 			continue;
 
-		const SenderFrame& frame = kv.second;
+		m_maxLatency = std::max(m_maxLatency, frame.latency);
+		m_underruns += static_cast<int>(slot.underruns.load());
+		m_overruns += static_cast<int>(slot.overruns.load());
+		m_maxJitterDelay = std::max(m_maxJitterDelay, slot.jitterDelay.load());
 
-		for (auto& path : frame.paths)
-		{
-			totalPoints += static_cast<int>(path.points.size());
+		// Frames we output are reported to their sender in feedback
+		slot.lastConsumedFrameNumber = frame.frameNumber;
+		slot.lastConsumedPublishNumber = frame.publishNumber;
+		slot.consumed = true;
+
+		totalPoints += static_cast<int>(frame.points.pointCount());
 
-			// try_emplace does nothing if the key already exists, so each unique
-			// metadata key gets a stable index assigned on its first occurrence.
-			for (auto& meta : path.metadata)
-				metaKeyIndex.try_emplace(meta.first, static_cast<int>(metaKeyIndex.size()));
+		for (const Ponk::PathMetaData& metadata : frame.pathMetadata)
+		{
+			for (unsigned int m = 0; m < metadata.count(); m++)
+			{
+				const unsigned int keyId = metadata.id(m);
+				if (!m_metaKeyUsed[keyId])
+				{
+					m_metaKeyUsed[keyId] = 1;
+					m_metaKeyIds.push_back(keyId);
+				}
+			}
 		}
 	}
 
@@ -419,83 +719,90 @@ PonkReceiver::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserve
 		return;
 
 	// --- Allocate metadata storage ---
-	// One flat float array per metadata key, sized to totalPoints.
+	// One flat float array per used metadata key, sized to totalPoints and kept between cooks.
 	// Points belonging to paths that don't carry a given key default to 0.
-	std::vector<std::vector<float>> metaArrays(metaKeyIndex.size());
-	for (auto& arr : metaArrays)
-		arr.resize(totalPoints, 0.0f);
-
-	// indices is reused for every path to avoid a per-path heap allocation.
+	if (m_metaArrays.size() < m_metaKeyUsed.size())
+		m_metaArrays.resize(m_metaKeyUsed.size());
+	for (unsigned int keyId : m_metaKeyIds)
+		m_metaArrays[keyId].assign(totalPoints, 0.0f);
+
+	// Position, color and line arrays are kept between cooks to avoid per-cook heap allocations.
+	m_positions.resize(totalPoints);
+	m_colors.resize(totalPoints);
+	m_lineIndices.resize(totalPoints);
+	m_lineSizes.clear();
 	int pointIndex = 0;
-	std::vector<int32_t> indices;
 
 	// --- Pass 2: emit geometry ---
-	// For each matching sender and each of its paths, we:
-	//   1. Add all points and their colors to the SOP output.
-	//   2. Write this path's metadata values into the correct rows of metaArrays.
-	//   3. Register a line primitive connecting all the path's points in order.
-	for (auto& kv : m_latestFrames)
+	// For each matching sender, we:
+	//   1. Gather its points and colors from the frame arrays, after the previous senders' points.
+	//   2. Write each path's metadata values into the correct rows of metaArrays.
+	//   3. Register a line primitive per path, connecting its points in order.
+	// Points, colors and lines of all senders are then added to the SOP output at once.
+	for (unsigned int i = 0; i < senderSlotCount; i++)
 	{
-		if (!filterAll && kv.first != filterSenderId)
+		const SenderSlot& slot = m_senderSlots[i];
+		if (slot.hidden || (!filterAll && slot.senderIdentifier != filterSenderId))
 			continue;
 
-		const SenderFrame& frame = kv.second;
+		const SenderFrame& frame = slot.frames.front();
+		const Ponk::FramePoints& points = frame.points;
 		m_numSenders++;
 
-		for (auto& path : frame.paths)
+		// Z is always 0 — PONK is a 2D protocol. Alpha is always 1; the protocol carries RGB only.
+		const int firstPtIdx = pointIndex;
+		const float* x = points.x();
+		const float* y = points.y();
+		const float* r = points.r();
+		const float* g = points.g();
+		const float* b = points.b();
+		for (unsigned int i = 0; i < points.pointCount(); i++)
+		{
+			m_positions[pointIndex] = Position(x[i], y[i], 0.0f);
+			m_colors[pointIndex] = Color(r[i], g[i], b[i], 1.0f);
+			m_lineIndices[pointIndex] = pointIndex;
+			pointIndex++;
+		}
+		m_numPoints += static_cast<int>(points.pointCount());
+
+		for (unsigned int p = 0; p < points.pathCount(); p++)
 		{
-			if (path.points.empty())
+			const unsigned int pathPointCount = points.pathPointCount(p);
+			if (pathPointCount == 0)
 				continue;
 
 			m_numPaths++;
 
-			// Remember where this path's points start in the global point list
-			// so we can build the line index array and fill metadata correctly.
-			int firstPtIdx = pointIndex;
-
-			for (auto& pt : path.points)
-			{
-				// Z is always 0 — PONK is a 2D protocol.
-				Position pos(pt.x, pt.y, 0.0f);
-				output->addPoint(pos);
-
-				// Alpha is always 1; the protocol carries RGB only.
-				Color col(pt.r, pt.g, pt.b, 1.0f);
-				output->setColor(col, pointIndex);
-
-				pointIndex++;
-			}
-
-			m_numPoints += static_cast<int>(path.points.size());
-
 			// Each metadata key has a single float value for the whole path,
 			// so we broadcast it to every point in this path's range.
-			for (auto& meta : path.metadata)
+			const int pathFirstPtIdx = firstPtIdx + static_cast<int>(points.pathFirstPoint(p));
+			const Ponk::PathMetaData& metadata = frame.pathMetadata[p];
+			for (unsigned int m = 0; m < metadata.count(); m++)
 			{
-				int idx = metaKeyIndex[meta.first];
-				for (int p = firstPtIdx; p < pointIndex; p++)
-					metaArrays[idx][p] = meta.second;
+				std::vector<float>& values = m_metaArrays[metadata.id(m)];
+				std::fill(values.begin() + pathFirstPtIdx, values.begin() + pathFirstPtIdx + pathPointCount, metadata.value(m));
 			}
 
-			// Connect this path's points as an open polyline.
-			indices.resize(path.points.size());
-			for (size_t i = 0; i < path.points.size(); i++)
-				indices[i] = firstPtIdx + static_cast<int32_t>(i);
-
-			output->addLine(indices.data(), static_cast<int32_t>(indices.size()));
+			// Paths are consecutive point ranges: each line takes the next pathPointCount indices.
+			m_lineSizes.push_back(static_cast<int32_t>(pathPointCount));
 		}
 	}
 
+	output->addPoints(m_positions.data(), totalPoints);
+	output->setColors(m_colors.data(), totalPoints, 0);
+	if (!m_lineSizes.empty())
+		output->addLines(m_lineIndices.data(), m_lineSizes.data(), static_cast<int32_t>(m_lineSizes.size()));
+
 	// --- Publish metadata as custom SOP float attributes ---
 	// Each key becomes a per-point float attribute named after the metadata key.
 	// TD can then access these via the Attribute SOP or CHOP-based workflows.
-	for (auto& kv : metaKeyIndex)
+	for (unsigned int keyId : m_metaKeyIds)
 	{
 		SOP_CustomAttribData attrib;
-		attrib.name = kv.first.c_str();
+		attrib.name = m_metaDataKeys.name(keyId);
 		attrib.numComponents = 1;
 		attrib.attribType = AttribType::Float;
-		attrib.floatData = metaArrays[kv.second].data();
+		attrib.floatData = m_metaArrays[keyId].data();
 		attrib.intData = nullptr;
 		output->setCustomAttribute(&attrib, totalPoints);
 	}
@@ -521,7 +828,7 @@ PonkReceiver::executeVBO(SOP_VBOOutput* output, const OP_Inputs* inputs, void* r
 int32_t
 PonkReceiver::getNumInfoCHOPChans(void* reserved)
 {
-	return 3;
+	return 7;
 }
 
 void
@@ -541,6 +848,26 @@ PonkReceiver::getInfoCHOPChan(int32_t index, OP_InfoCHOPChan* chan, void* reserv
 		chan->name->setString("points");
 		chan->value = static_cast<float>(m_numPoints);
 		break;
+	case 3:
+		// Highest capture to receive latency of output senders in ms (-1 if unknown)
+		chan->name->setString("latency");
+		chan->value = m_maxLatency;
+		break;
+	case 4:
+		// Jitter buffer: frames of output senders that arrived after their playout time
+		chan->name->setString("underruns");
+		chan->value = static_cast<float>(m_underruns);
+		break;
+	case 5:
+		// Jitter buffer: frames of output senders dropped because too many were waiting
+		chan->name->setString("overruns");
+		chan->value = static_cast<float>(m_overruns);
+		break;
+	case 6:
+		// Jitter buffer: highest delay between expected arrival and playout of output senders in ms
+		chan->name->setString("jitter_delay");
+		chan->value = m_maxJitterDelay;
+		break;
 	}
 }
 
@@ -553,7 +880,7 @@ bool
 PonkReceiver::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved)
 {
 	infoSize->rows = 1 + static_cast<int32_t>(m_senderList.size());
-	infoSize->cols = 2;
+	infoSize->cols = 3;
 	infoSize->byColumn = false;
 	return true;
 }
@@ -566,14 +893,17 @@ PonkReceiver::getInfoDATEntries(int32_t index, int32_t nEntries,
 	{
 		entries->values[0]->setString("name");
 		entries->values[1]->setString("id");
+		entries->values[2]->setString("latency");
 		return;
 	}
 
 	int senderIdx = index - 1;
 	if (senderIdx >= 0 && senderIdx < static_cast<int>(m_senderList.size()))
 	{
-		entries->values[0]->setString(m_senderList[senderIdx].first.c_str());
-		entries->values[1]->setString(std::to_string(m_senderList[senderIdx].second).c_str());
+		const SenderInfo& sender = m_senderList[senderIdx];
+		entries->values[0]->setString(sender.name.c_str());
+		entries->values[1]->setString(std::to_string(sender.identifier).c_str());
+		entries->values[2]->setString(sender.latency < 0 ? "" : std::to_string(sender.latency).c_str());
 	}
 }
 
@@ -605,6 +935,94 @@ PonkReceiver::setupParameters(OP_ParameterManager* manager, void* reserved)
 		assert(res == OP_ParAppendResult::Success);
 	}
 
+	// Show the received part of frames with lost chunks (senders using path-aligned chunks)
+	{
+		OP_NumericParameter np;
+		np.name = "Partialframes";
+		np.label = "Partial Frames";
+		np.defaultValues[0] = 0;
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Playout delay in ms: frames of senders sending timestamps are shown at capture time + delay
+	// (0 = as soon as received). Receivers using the same delay show frames of a sender at the same time.
+	// With the jitter buffer, it is the least delay between the expected arrival of frames and their playout.
+	{
+		OP_NumericParameter np;
+		np.name = "Playoutdelay";
+		np.label = "Playout Delay (ms)";
+		np.defaultValues[0] = 0;
+		np.minValues[0] = 0;
+		np.maxValues[0] = 1000;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 200;
+		np.clampMins[0] = true;
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Show frames of each sender at a steady cadence, from frame numbers and arrival times (no clock sync
+	// needed), buffering them for the playout delay or more when the network jitters more
+	{
+		OP_NumericParameter np;
+		np.name = "Jitterbuffer";
+		np.label = "Jitter Buffer";
+		np.defaultValues[0] = 0;
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Largest distance between curves sent as segments and the points we sample them with
+	{
+		OP_NumericParameter np;
+		np.name = "Curvetolerance";
+		np.label = "Curve Tolerance";
+		np.defaultValues[0] = 0.0005;
+		np.minValues[0] = 0.00001;
+		np.maxValues[0] = 0.1;
+		np.minSliders[0] = 0.0001;
+		np.maxSliders[0] = 0.01;
+		np.clampMins[0] = true;
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Most points curves of a frame are sampled with, whatever the tolerance (0 = no limit)
+	{
+		OP_NumericParameter np;
+		np.name = "Curvepointbudget";
+		np.label = "Curve Point Budget";
+		np.defaultValues[0] = 0;
+		np.minValues[0] = 0;
+		np.maxValues[0] = 1000000;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 100000;
+		np.clampMins[0] = true;
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Tell senders which frames we use and at which rate, so they can adapt their send rate
+	{
+		OP_NumericParameter np;
+		np.name = "Feedback";
+		np.label = "Send Feedback";
+		np.defaultValues[0] = 1;
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Ask senders to resend missing chunks of incomplete frames (senders keeping their last frames)
+	{
+		OP_NumericParameter np;
+		np.name = "Retransmit";
+		np.label = "Request Retransmit";
+		np.defaultValues[0] = 1;
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
 	// Clear all received sender data
 	{
 		OP_NumericParameter np;
@@ -620,8 +1038,11 @@ PonkReceiver::pulsePressed(const char* name, void* reserved)
 {
 	if (strcmp(name, "Refresh") == 0)
 	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-		m_latestFrames.clear();
+		// Senders get a slot again when they send a new frame, so senders which stopped free theirs
+		const unsigned int senderSlotCount = visibleSenderSlotCount();
+		for (unsigned int i = 0; i < senderSlotCount; i++)
+			m_senderSlots[i].hidden = true;
+		m_resetSenderSlots.store(true, std::memory_order_release);
 	}
 }
 
@@ -633,10 +1054,12 @@ PonkReceiver::buildDynamicMenu(const OP_Inputs* inputs, OP_BuildDynamicMenuInfo*
 
 	info->addMenuEntry("*", "All Senders");
 
-	std::lock_guard<std::mutex> lock(m_mutex);
-	for (auto& kv : m_latestFrames)
+	const unsigned int senderSlotCount = visibleSenderSlotCount();
+	for (unsigned int i = 0; i < senderSlotCount; i++)
 	{
-		const SenderFrame& frame = kv.second;
+		if (m_senderSlots[i].hidden)
+			continue;
+		const SenderFrame& frame = m_senderSlots[i].frames.front();
 		std::string idStr = std::to_string(frame.senderIdentifier);
 		info->addMenuEntry(idStr.c_str(), frame.senderName.c_str());
 	}
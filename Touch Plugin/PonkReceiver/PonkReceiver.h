@@ -2,6 +2,24 @@
 
 #include "DatagramSocket/DatagramSocket.h"
 #include "PonkDefs.h"
+#include "PonkFrameCodec.h"
+#include "PonkHeader.h"
+#include "PonkCompression.h"
+#include "PonkReassembly.h"
+#include "PonkPathCache.h"
+#include "PonkFec.h"
+#include "PonkPathAlignment.h"
+#include "PonkAnnouncement.h"
+#include "PonkClock.h"
+#include "PonkFeedback.h"
+#include "PonkRetransmit.h"
+#include "PonkMetaDataTable.h"
+#include "PonkMetaDataKeys.h"
+#include "PonkPathInstancing.h"
+#include "PonkCurveTessellation.h"
+#include "PonkTripleBuffer.h"
+#include "PonkFramePool.h"
+#include "PonkJitterBuffer.h"
 #include "SOP_CPlusPlusBase.h"
 
 #include <string>
@@ -9,28 +27,35 @@
 #include <map>
 #include <unordered_map>
 #include <thread>
-#include <mutex>
 #include <atomic>
+#include <cstdint>
+#include <memory>
 
 using namespace TD;
 
-struct ReceivedPoint
-{
-	float x, y;
-	float r, g, b;
-};
-
-struct ReceivedPath
-{
-	std::vector<ReceivedPoint> points;
-	std::unordered_map<std::string, float> metadata;
-};
-
 struct SenderFrame
 {
 	std::string senderName;
 	unsigned int senderIdentifier = 0;
-	std::vector<ReceivedPath> paths;
+	unsigned int frameNumber = 0;
+	Ponk::FramePoints points;	// Points of all paths, one array per component
+	std::vector<Ponk::PathMetaData> pathMetadata;	// Per path, keys interned in PonkReceiver::m_metaDataKeys
+	float latency = -1;						// Capture to receive time in ms, -1 if unknown (no timestamp or clock sync yet)
+	unsigned long long presentTime = 0;		// Receiver clock time to show the frame at (playout delay), 0 = when received
+	unsigned int publishNumber = 0;			// Frames of the sender handed to execute up to this one
+
+	// Keeps storage, for frames recycled by Ponk::FramePool
+	void clear()
+	{
+		senderName.clear();
+		senderIdentifier = 0;
+		frameNumber = 0;
+		points.clear();
+		pathMetadata.clear();
+		latency = -1;
+		presentTime = 0;
+		publishNumber = 0;
+	}
 };
 
 class PonkReceiver : public SOP_CPlusPlusBase
@@ -61,51 +86,158 @@ private:
 
 	void receiveThreadFunc();
 
-	/// Parse a complete frame's data bytes into paths and store under m_mutex.
+	/// Parse a complete frame's data bytes into paths and hand it to execute (or schedule it).
 	void parseAndStoreFrame(unsigned int senderIdentifier,
 							const char* senderName,
-							const std::vector<unsigned char>& data);
+							unsigned int frameNumber,
+							unsigned long long timestamp,
+							const std::vector<unsigned char>& frameData);
 
 	DatagramSocket* m_socket;
 
 	std::thread m_receiveThread;
 	std::atomic<bool> m_running{false};
 
-	// Per-sender chunk assembly (only accessed from receive thread)
+	// Chunk assembly of a frame (only accessed from receive thread)
 	struct ChunkAssembly
 	{
-		int frameNumber = -1;
+		int64_t frameNumber = -1;
 		int chunkCount = -1;
 		unsigned int dataCrc = 0;
-		std::vector<bool> received;
-		std::vector<std::vector<unsigned char>> chunks;
+		unsigned int parityChunkCount = 0;
+		unsigned char flags = 0;
+		unsigned long long timestamp = 0;		// Capture time (sender clock) with PONK_FLAG_TIMESTAMP
+		Ponk::FrameAssemblyBuffer chunks;		// Chunk payloads written in place, kept between frames
 		char senderName[32] = {};
-
-		ChunkAssembly()
-		{
-			received.resize(255, false);
-			chunks.resize(255);
-		}
+		Ponk::FecDecoder fec;
+		Ponk::NackTimer nack;	// Asks the sender for missing chunks once the frame stalls
 
 		void reset()
 		{
-			int count = (chunkCount > 0) ? chunkCount : 0;
-			for (int i = 0; i < count; i++)
-			{
-				received[i] = false;
-				chunks[i].clear();
-			}
+			chunks.clear();
 			frameNumber = -1;
 			chunkCount = -1;
 			dataCrc = 0;
+			parityChunkCount = 0;
+			flags = 0;
+			timestamp = 0;
+			nack.reset();
 		}
 	};
 
-	std::unordered_map<unsigned int, ChunkAssembly> m_assemblies;
+	/// Parse and store the received chunks of a path-aligned frame that will not complete.
+	void storePartialFrame(unsigned int senderIdentifier, const ChunkAssembly& assembly);
+
+	// Per-sender window of frames being assembled
+	std::unordered_map<unsigned int, Ponk::FrameAssemblyWindow<ChunkAssembly>> m_assemblies;
+	std::vector<unsigned char> m_recoveredChunk;
+	Ponk::PathPieceMerger m_merger;
+	Ponk::MetaDataTableDecoder m_metaDataTable;
+	std::vector<unsigned char> m_expandedData;
+
+	// Meta data keys met in frames: interned by the receive thread, names read by execute
+	Ponk::MetaDataKeyTable m_metaDataKeys;
+
+	// Set from the Partial Frames parameter in execute, read by the receive thread
+	std::atomic<bool> m_partialFrames{false};
+
+	// Per-sender path cache used to rebuild frames with path references (only accessed from receive thread)
+	std::unordered_map<unsigned int, Ponk::PathCacheDecoder> m_pathCaches;
+	std::vector<unsigned char> m_decodedData;
+
+	// Instances of template paths are expanded in parseAndStoreFrame (only accessed from receive thread)
+	Ponk::PathInstanceExpander m_instanceExpander;
+	std::vector<unsigned char> m_instancedData;
+
+	// Curve paths are sampled to points in parseAndStoreFrame (only accessed from receive thread),
+	// with the Curve Tolerance and Curve Point Budget parameters set in execute
+	Ponk::CurveTessellator m_curveTessellator;
+	std::vector<unsigned char> m_tessellatedData;
+	std::atomic<float> m_curveTolerance{0.0005f};
+	std::atomic<int> m_curvePointBudget{0};
+
+	// Names of senders using the compact header, from their announcements (only accessed from receive thread)
+	Ponk::SenderNameCache m_senderNames;
+
+	// Per-sender back channel: clock offset estimation for senders stamping their frames, and
+	// feedback about frames we use (only accessed from receive thread)
+	struct SenderLink
+	{
+		GenericAddr address;	// Source address of the sender frames, where we send messages
+		bool clockSyncEnabled = false;
+		Ponk::ClockSync clockSync;
+		unsigned long long nextFeedbackTime = 0;
+		unsigned int frameNumberMask = 0xFFFFFFFF;	// Of the protocol version the sender uses
+		Ponk::JitterBuffer jitterBuffer;
+	};
+	std::unordered_map<unsigned int, SenderLink> m_senderLinks;
+	std::vector<unsigned char> m_backChannelPacket;
+
+	/// Send due clock sync requests, feedback and NACKs, called when no packet is pending so requests go at random
+	/// times and NACKs only once pending chunks have been read.
+	void sendBackChannelMessages();
+
+	// Random identifier sent in feedback, so senders can tell receivers sharing an address apart
+	unsigned int m_receiverIdentifier = 0;
+	// Set from the Feedback parameter in execute
+	std::atomic<bool> m_sendFeedback{true};
+	// Set from the Request Retransmit parameter in execute
+	std::atomic<bool> m_requestRetransmit{true};
+
+	// Set from the Playout Delay parameter in execute (microseconds, 0 = show frames when received)
+	std::atomic<int> m_playoutDelay{0};
+	// Set from the Jitter Buffer parameter in execute
+	std::atomic<bool> m_jitterBuffer{false};
+
+	// Latest complete frame per sender, handed from the receive thread to execute without locking.
+	// Slots are added by the receive thread up to kMaxSenders, and never removed.
+	struct SenderSlot
+	{
+		unsigned int senderIdentifier = 0;
+		Ponk::TripleBuffer<SenderFrame> frames;		// back() written by the receive thread, front() read by execute
+		// Frames used by execute, reported to the sender in feedback
+		std::atomic<bool> consumed{false};
+		std::atomic<unsigned int> lastConsumedFrameNumber{0};
+		std::atomic<unsigned int> lastConsumedPublishNumber{0};
+		unsigned int publishedFrames = 0;			// Only accessed from receive thread
+		// Jitter buffer stats, updated by the receive thread
+		std::atomic<unsigned int> underruns{0};
+		std::atomic<unsigned int> overruns{0};
+		std::atomic<float> jitterDelay{0};			// ms
+		bool hidden = true;							// Only accessed from execute: until its first frame since the slot was given
+	};
+	static const unsigned int kMaxSenders = 64;
+	std::unique_ptr<SenderSlot[]> m_senderSlots{new SenderSlot[kMaxSenders]};
+	std::atomic<unsigned int> m_senderSlotCount{0};		// Slots visible to execute, up to the last published one
+	unsigned int m_allocatedSenderSlots = 0;			// Only accessed from receive thread: slots given to senders
+	std::atomic<bool> m_senderSlotsFull{false};			// Frames of a sender were dropped for lack of a slot
+
+	/// Slots execute and the menu may read (main thread): none while a reset of the slots is pending.
+	unsigned int visibleSenderSlotCount() const
+	{
+		if (m_resetSenderSlots.load(std::memory_order_acquire))
+			return 0;
+		return m_senderSlotCount.load(std::memory_order_acquire);
+	}
+	/// Slot of a sender, added on first use (receive thread). Returns nullptr past kMaxSenders.
+	SenderSlot* senderSlot(unsigned int senderIdentifier);
+	/// Hand the frame to execute (receive thread).
+	void publishFrame(unsigned int senderIdentifier, std::unique_ptr<SenderFrame> frame);
+	/// Publish scheduled frames whose present time has come (receive thread).
+	void publishScheduledFrames();
+	/// Forget all senders and free their slots, once Refresh asked for it (receive thread).
+	void resetSenderSlots();
 
-	// Protected by m_mutex: latest complete frame per sender
-	std::mutex m_mutex;
-	std::unordered_map<unsigned int, SenderFrame> m_latestFrames;
+	// Only accessed from receive thread: slot index per sender, frames waiting for their present time (oldest first),
+	// and frames to reuse once replaced, so a steady stream is received without allocating
+	std::unordered_map<unsigned int, unsigned int> m_senderSlotIndices;
+	std::unordered_map<unsigned int, std::vector<std::unique_ptr<SenderFrame>>> m_scheduledFrames;
+	std::unordered_map<unsigned int, Ponk::FramePool<SenderFrame>> m_framePools;
+	// Set by Refresh, the receive thread then frees the slots and drops scheduled frames. Until it did,
+	// execute sees no slot.
+	std::atomic<bool> m_resetSenderSlots{false};
+	Ponk::OutputRateMeter m_outputRate;			// Only accessed from execute
+	std::atomic<float> m_outputFrameRate{0};	// Rate of m_outputRate, reported in feedback
 
 	std::string m_errorMessage;
 
@@ -113,5 +245,24 @@ private:
 	int m_numSenders = 0;
 	int m_numPaths = 0;
 	int m_numPoints = 0;
-	std::vector<std::pair<std::string, unsigned int>> m_senderList;
+	float m_maxLatency = -1;
+	int m_underruns = 0;
+	int m_overruns = 0;
+	float m_maxJitterDelay = 0;
+	struct SenderInfo
+	{
+		std::string name;
+		unsigned int identifier;
+		float latency;
+	};
+	std::vector<SenderInfo> m_senderList;
+
+	// Geometry gathered from frame arrays in execute, kept between cooks
+	std::vector<Position> m_positions;
+	std::vector<Color> m_colors;
+	std::vector<int32_t> m_lineIndices;
+	std::vector<int32_t> m_lineSizes;
+	std::vector<unsigned int> m_metaKeyIds;			// Keys used by the output paths
+	std::vector<char> m_metaKeyUsed;				// Per key id
+	std::vector<std::vector<float>> m_metaArrays;	// Per key id, one value per point
 };
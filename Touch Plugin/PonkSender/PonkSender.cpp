@@ -101,43 +101,37 @@ PonkSender::getGeneralInfo(SOP_GeneralInfo* ginfo, const OP_Inputs* inputs, void
 
 }
 
-void PonkSender::push16bits(std::vector<unsigned char>& fullData, unsigned short value) {
-	fullData.push_back(static_cast<unsigned char>((value >> 0) & 0xFF));
-	fullData.push_back(static_cast<unsigned char>((value >> 8) & 0xFF));
+void PonkSender::pushPoint(const Position& pointPosition, const Color& pointColor) {
+	m_pathWriter.addPoint(pointPosition.x, pointPosition.y, pointColor.r, pointColor.g, pointColor.b);
 }
 
-void PonkSender::push32bits(std::vector<unsigned char>& fullData, int value) {
-	fullData.push_back(static_cast<unsigned char>((value >> 0) & 0xFF));
-	fullData.push_back(static_cast<unsigned char>((value >> 8) & 0xFF));
-	fullData.push_back(static_cast<unsigned char>((value >> 16) & 0xFF));
-	fullData.push_back(static_cast<unsigned char>((value >> 24) & 0xFF));
-}
-
-void PonkSender::pushFloat32(std::vector<unsigned char>& fullData, float value) {
-    push32bits(fullData,*reinterpret_cast<int*>(&value));
-}
-
-void PonkSender::pushMetaData(std::vector<unsigned char>& fullData, const char(&eightCC)[9], int value) {
-	for (int i = 0; i < 8; i++) {
-		fullData.push_back(eightCC[i]);
-	}
-	push32bits(fullData, value);
-}
-void PonkSender::pushMetaData(std::vector<unsigned char>& fullData, const char(&eightCC)[9], float value) {
-	for (int i = 0; i < 8; i++) {
-		fullData.push_back(eightCC[i]);
+void PonkSender::readBackChannel(unsigned int senderIdentifier) {
+	unsigned char buffer[2048];
+	while (true) {
+		unsigned int bufferSize = static_cast<unsigned int>(sizeof(buffer));
+		GenericAddr sourceAddr;
+		if (!socket->recvFrom(sourceAddr, buffer, bufferSize) || bufferSize == 0)
+			break;
+		if (Ponk::answerClockSync(buffer, bufferSize, senderIdentifier, m_clockSyncResponse)) {
+			socket->sendTo(sourceAddr, m_clockSyncResponse.data(), static_cast<unsigned int>(m_clockSyncResponse.size()));
+		} else if (m_retransmitBuffer.readNack(buffer, bufferSize, senderIdentifier, m_retransmitPackets)) {
+			for (const std::vector<unsigned char>* packet : m_retransmitPackets)
+				socket->sendTo(sourceAddr, packet->data(), static_cast<unsigned int>(packet->size()));
+		} else {
+			m_rateController.readFeedback(buffer, bufferSize, senderIdentifier);
+		}
 	}
-	push32bits(fullData, *(int*)&value);
 }
 
-#define CLAMP_IN_ZERO_ONE(x) ((x) < 0 ? 0 : ((x) > 1 ? 1 : (x)))
-
-void PonkSender::pushPoint_XY_F32_RGB_U8(std::vector<unsigned char>& fullData, const Position& pointPosition, const Color& pointColor) {
-    pushFloat32(fullData, pointPosition.x);
-    pushFloat32(fullData, pointPosition.y);
-    fullData.push_back(static_cast<unsigned char>(CLAMP_IN_ZERO_ONE(pointColor.r) * 255));
-    fullData.push_back(static_cast<unsigned char>(CLAMP_IN_ZERO_ONE(pointColor.g) * 255));
-    fullData.push_back(static_cast<unsigned char>(CLAMP_IN_ZERO_ONE(pointColor.b) * 255));
+int PonkSender::getPathMtu(const GenericAddr& destAddr) {
+	// Query the OS when the destination changes, then once per second to follow path MTU updates
+	const auto now = std::chrono::steady_clock::now();
+	if (destAddr.ip != m_pathMtuIp || now - m_pathMtuTime > std::chrono::seconds(1)) {
+		m_pathMtu = DatagramSocket::pathMtu(destAddr);
+		m_pathMtuIp = destAddr.ip;
+		m_pathMtuTime = now;
+	}
+	return m_pathMtu;
 }
 
 std::map<std::string, float*> PonkSender::getMetadata(const OP_SOPInput* sinput) {
@@ -239,6 +233,8 @@ PonkSender::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserved)
 		}
 	}
 
+	inputs->enablePar("Keyframeinterval", inputs->getParInt("Pathcache") != 0);
+
 	// Disable the netaddress parameter if multicast is enabled
 	if (inputs->getParInt("Multicast")) {
 		inputs->enablePar("Netaddress", false);
@@ -294,6 +290,10 @@ PonkSender::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserved)
 		// get the metadata
 		std::map<std::string, float*> metadata = getMetadata(sinput);
 
+		static const unsigned char s_dataFormats[] = { PONK_DATA_FORMAT_XY_F32_RGB_U8, PONK_DATA_FORMAT_XY_DELTA_RGB_RLE, PONK_DATA_FORMAT_XY_F16_RGB_U8 };
+		const int dataFormatIndex = inputs->getParInt("Dataformat");
+		m_dataFormat = s_dataFormats[dataFormatIndex >= 0 && dataFormatIndex < 3 ? dataFormatIndex : 0];
+
 		static const Color s_white(1.0f, 1.0f, 1.0f, 1.0f);
 
 		for (int primitiveNumber = 0; primitiveNumber < sinput->getNumPrimitives(); primitiveNumber++)
@@ -318,68 +318,36 @@ PonkSender::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserved)
 			if (isPoints) {
 				// Send each point as a separate single-point path
 				for (int pointNumber = 0; pointNumber < numPoints; pointNumber++) {
-					fullData.push_back(PONK_DATA_FORMAT_XY_F32_RGB_U8);
-					fullData.push_back((unsigned char)metadata.size());
-
+					m_pathWriter.beginPath(fullData, m_dataFormat);
 					for (const auto& kv : metadata) {
-						char charMetadata[9];
-						memset(charMetadata, 0, sizeof(charMetadata));
-						size_t copyLen = std::min<size_t>(kv.first.size(), 8u);
-						std::copy(kv.first.begin(), kv.first.begin() + copyLen, charMetadata);
-						pushMetaData(fullData, charMetadata, kv.second[primVert[pointNumber]]);
+						m_pathWriter.addMetaData(kv.first.c_str(), kv.second[primVert[pointNumber]]);
 					}
 
-					push16bits(fullData, 1);
-
 					Position pointPosition = cameraTransProj * ptArr[primVert[pointNumber]];
-					pushPoint_XY_F32_RGB_U8(fullData, pointPosition, sinput->hasColors()?colors[primVert[pointNumber]]:s_white);
+					pushPoint(pointPosition, sinput->hasColors()?colors[primVert[pointNumber]]:s_white);
+					m_pathWriter.endPath();
 				}
 			} else {
-	            // Write Format Data
-	            fullData.push_back(PONK_DATA_FORMAT_XY_F32_RGB_U8);
-
-				// Write meta data count
-				fullData.push_back(metadata.size());
-
+				m_pathWriter.beginPath(fullData, m_dataFormat);
 				for (const auto& kv : metadata) {
-					char charMetadata[9];
-					memset(charMetadata, 0, sizeof(charMetadata));
-					size_t copyLen = std::min<size_t>(kv.first.size(), 8u);
-					std::copy(kv.first.begin(), kv.first.begin() + copyLen, charMetadata);
-
-					pushMetaData(fullData, charMetadata, kv.second[primVert[0]]);
+					m_pathWriter.addMetaData(kv.first.c_str(), kv.second[primVert[0]]);
 				}
 
-				// check if the primitve is closed
-				if (primInfo.isClosed) {
-	                // Write point count
-	                push16bits(fullData, numPoints+1);
-	            } else {
-	                push16bits(fullData, numPoints);
-	            }
-
 				for (int pointNumber = 0; pointNumber < numPoints; pointNumber++) {
 					Position pointPosition = cameraTransProj * ptArr[primVert[pointNumber]];
-					pushPoint_XY_F32_RGB_U8(fullData, pointPosition, sinput->hasColors()?colors[primVert[pointNumber]]:s_white);
+					pushPoint(pointPosition, sinput->hasColors()?colors[primVert[pointNumber]]:s_white);
 				}
 
 				// If the primitive is close add the first point at the end
 				if (primInfo.isClosed) {
 					Position pointPosition = cameraTransProj * ptArr[primVert[0]];
-	                pushPoint_XY_F32_RGB_U8(fullData, pointPosition, sinput->hasColors()?colors[primVert[0]]:s_white);
+					pushPoint(pointPosition, sinput->hasColors()?colors[primVert[0]]:s_white);
 				}
+				m_pathWriter.endPath();
 			}
 		}
 
 
-		// Check if we don't reach the maximum number of chunck
-        size_t chunksCount64 = 1 + fullData.size() / (PONK_MAX_CHUNK_SIZE-sizeof(GeomUdpHeader));
-		if (chunksCount64 > 255) {
-			m_errorMessage = "Protocol doesn't accept sending a packet "
-			                 "that would be splitted in more than 255 chunks";
-			return;
-		}
-
 		// Get the Unique identifier from the attribute
 		int uid = inputs->getParInt("Uid");
 
@@ -399,15 +367,53 @@ PonkSender::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserved)
 			m_uidJustChanged = false;
 		}
 
-        // Compute packet CRC
-        unsigned int dataCrc = 0;
-        for (auto v: fullData) {
-            dataCrc += v;
-        }
+		// Answer clock sync requests and NACKs, and read feedback of receivers (sent back to the address we
+		// send from). Done before sending, so resent chunks of the previous frame arrive before this one.
+		readBackChannel(uid);
+
+		// Skip frames receivers would not use (they output at a lower rate, or their queues grow)
+		if (inputs->getParInt("Adaptrate") && !m_rateController.shouldSendFrame())
+			return;
+
+		// Cut the frame in chunks (computes chunk count and CRC, and compresses if asked)
+		Ponk::ChunkHeader header;
+		header.senderIdentifier = uid;
+		strncpy(header.senderName, senderName, sizeof(header.senderName));
+		header.frameNumber = frameNumber;
+		if (inputs->getParInt("Compress"))
+			header.flags |= PONK_FLAG_COMPRESSED;
+		// Compact header: the sender name is sent in announcements instead of each chunk
+		if (inputs->getParInt("Compactheader"))
+			header.protocolVersion = 3;
+		// Capture time, so receivers can measure latency and show frames in sync
+		if (inputs->getParInt("Timestamps"))
+		{
+			header.flags |= PONK_FLAG_TIMESTAMP;
+			header.timestamp = Ponk::clockMicroseconds();
+		}
+
+		// Replace paths unchanged since a previous frame by references (paths need a PATHNUMB attribute)
+		const std::vector<unsigned char>* frameData = &fullData;
+		if (inputs->getParInt("Pathcache")) {
+			m_pathCache.setKeyframeInterval(inputs->getParInt("Keyframeinterval"));
+			m_pathCache.encodeFrame(fullData, static_cast<unsigned char>(frameNumber), m_encodedData);
+			frameData = &m_encodedData;
+		} else {
+			m_pathCache.clear();
+			m_pathCache.forceKeyframe();
+		}
+
+		// Send meta data keys and their most frequent value once per frame, paths only carry the values that differ
+		if (inputs->getParInt("Metadatatable")) {
+			m_metaDataTable.encodeFrame(*frameData, m_tableData);
+			frameData = &m_tableData;
+		}
+
+		// Forward error correction: parity chunks let receivers rebuild lost chunks without retransmit
+		m_chunker.setParityRatio(static_cast<float>(inputs->getParDouble("Parityratio")));
+		// Cut chunks on path boundaries so receivers can use each chunk on its own
+		m_chunker.setPathAligned(inputs->getParInt("Pathaligned") != 0);
 
-		size_t written = 0;
-		unsigned char chunkNumber = 0;
-		unsigned char chunksCount = static_cast<unsigned char>(chunksCount64);
 		GenericAddr destAddr;
 
 		// Multicast UDP
@@ -426,35 +432,35 @@ PonkSender::execute(SOP_Output* output, const OP_Inputs* inputs, void* reserved)
 			destAddr.port = PONK_PORT;
 		}
 
+		size_t chunkSize = PONK_MAX_CHUNK_SIZE;
+		const int chunkSizeMode = inputs->getParInt("Chunksize");
+		if (chunkSizeMode == 2) {
+			chunkSize = PONK_JUMBO_CHUNK_SIZE;
+		} else if (chunkSizeMode == 1 && !inputs->getParInt("Multicast")) {
+			chunkSize = Ponk::chunkSizeForMtu(getPathMtu(destAddr));
+		}
+
+		if (!m_chunker.buildPackets(*frameData, header, chunkSize)) {
+			m_errorMessage = m_chunker.error();
+			return;
+		}
+
+		if (Ponk::chunkHeaderVersion(header) >= 3 && m_announcer.update(header)) {
+			const std::vector<unsigned char>& announcement = m_announcer.packet();
+			socket->sendTo(destAddr, &announcement[0], static_cast<unsigned int>(announcement.size()));
+		}
+
 		// Always send at least one packet — even with empty fullData (no shapes = empty frame)
-		do {
-			// Write packet header
-			GeomUdpHeader header;
-			strncpy(header.headerString, PONK_HEADER_STRING, sizeof(header.headerString));
-			header.protocolVersion = 0;
-			header.senderIdentifier = uid;
-			strncpy(header.senderName, senderName, sizeof(header.senderName));
-			header.frameNumber = frameNumber;
-			header.chunkCount = chunksCount;
-			header.chunkNumber = chunkNumber;
-            header.dataCrc = dataCrc;
-
-			// Prepare buffer
-			packet.clear();
-            size_t dataBytesForThisChunk = std::min<size_t>(fullData.size() - written, PONK_MAX_CHUNK_SIZE-sizeof(GeomUdpHeader));
-			packet.resize(sizeof(GeomUdpHeader) + dataBytesForThisChunk);
-			// Write header
-			memcpy(&packet[0], &header, sizeof(GeomUdpHeader));
-			// Write data
-			if (dataBytesForThisChunk > 0)
-				memcpy(&packet[sizeof(GeomUdpHeader)], &fullData[written], dataBytesForThisChunk);
-			written += dataBytesForThisChunk;
-
-			// Send the packet
+		for (size_t i = 0; i < m_chunker.packetCount(); i++) {
+			const std::vector<unsigned char>& packet = m_chunker.packet(i);
 			socket->sendTo(destAddr, &packet[0], static_cast<unsigned int>(packet.size()));
+		}
 
-			chunkNumber++;
-		} while (written < fullData.size());
+		// Keep the last frames to resend chunks receivers missed
+		if (inputs->getParInt("Retransmit"))
+			m_retransmitBuffer.storeFrame(m_chunker);
+		else
+			m_retransmitBuffer.clear();
 
 		frameNumber++;
 	}
@@ -565,6 +571,177 @@ PonkSender::setupParameters(OP_ParameterManager* manager, void* reserved)
         assert(res == OP_ParAppendResult::Success);
 	}
 
+	// Data Format
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Dataformat";
+		sp.label = "Data Format";
+		sp.page = "Parameters";
+		sp.defaultValue = "Float";
+
+		const char* names[] = { "Float", "Compressed", "Half" };
+		const char* labels[] = { "XY Float 32 / RGB 8 bits", "Compressed (Delta XY / RLE RGB)", "XY Float 16 / RGB 8 bits" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Compress
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Compress";
+		np.label = "Compress";
+		np.page = "Parameters";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Path Cache
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Pathcache";
+		np.label = "Path Cache";
+		np.page = "Parameters";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Keyframe Interval (frames between two full frames when path cache is on)
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Keyframeinterval";
+		np.label = "Keyframe Interval";
+		np.page = "Parameters";
+
+		np.minValues[0] = 1;
+		np.maxValues[0] = 255;
+		np.defaultValues[0] = 60;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 255;
+
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+
+		OP_ParAppendResult res = manager->appendInt(np, 1);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Meta Data Table (meta data keys and default values sent once per frame instead of in each path)
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Metadatatable";
+		np.label = "Meta Data Table";
+		np.page = "Parameters";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Path Aligned Chunks
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Pathaligned";
+		np.label = "Path Aligned Chunks";
+		np.page = "Parameters";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Parity Ratio (forward error correction parity chunks per data chunk, 0 = off)
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Parityratio";
+		np.label = "Parity Ratio";
+		np.page = "Parameters";
+
+		np.minValues[0] = 0;
+		np.maxValues[0] = 1;
+		np.defaultValues[0] = 0;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 1;
+
+		np.clampMins[0] = true;
+		np.clampMaxes[0] = true;
+
+		OP_ParAppendResult res = manager->appendFloat(np, 1);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Timestamps (capture time in frames, lets receivers measure latency and synchronize playout)
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Timestamps";
+		np.label = "Timestamps";
+		np.page = "Parameters";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Compact Header (protocol version 3, receivers get the sender name from announcements)
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Compactheader";
+		np.label = "Compact Header";
+		np.page = "Parameters";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Adapt Rate (skip frames according to receivers feedback, all frames are sent without feedback)
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Adaptrate";
+		np.label = "Adapt Rate";
+		np.page = "Parameters";
+		np.defaultValues[0] = 1;
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Retransmit (keep the last frames to resend the chunks receivers ask for, mostly useful in unicast)
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Retransmit";
+		np.label = "Retransmit";
+		np.page = "Parameters";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Chunk Size (standard fits any network, path MTU is only discovered in unicast)
+	{
+		OP_StringParameter sp;
+
+		sp.name = "Chunksize";
+		sp.label = "Chunk Size";
+		sp.page = "Parameters";
+		sp.defaultValue = "Standard";
+
+		const char* names[] = { "Standard", "Pathmtu", "Jumbo" };
+		const char* labels[] = { "Standard (1472 bytes)", "Path MTU (unicast)", "Jumbo Frames (8972 bytes)" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
 	// Unique ID (matches GeomUdpHeader.senderIdentifier: 32-bit; max 2147483647 because getParInt is int32_t)
 	{
 		OP_NumericParameter	np;
@@ -16,6 +16,14 @@
 
 #include "DatagramSocket/DatagramSocket.h"
 #include "PonkDefs.h"
+#include "PonkFrameCodec.h"
+#include "PonkChunker.h"
+#include "PonkPathCache.h"
+#include "PonkMetaDataTable.h"
+#include "PonkAnnouncement.h"
+#include "PonkClock.h"
+#include "PonkFeedback.h"
+#include "PonkRetransmit.h"
 
 #include "SOP_CPlusPlusBase.h"
 #include <string>
@@ -63,13 +71,12 @@ public:
 	virtual void getErrorString(OP_String* error, void* reserved) override;
 
 private:
-	void push16bits(std::vector<unsigned char>& fullData, unsigned short value);
-    void push32bits(std::vector<unsigned char>& fullData, int value);
-    void pushFloat32(std::vector<unsigned char>& fullData, float value);
-	void pushMetaData(std::vector<unsigned char>& fullData, const char(&eightCC)[9], int value);
-	void pushMetaData(std::vector<unsigned char>& fullData, const char(&eightCC)[9], float value);
-    //void pushPoint_XYRGB_U16(std::vector<unsigned char>& fullData, const Position& pointPosition, const Color& pointColor);
-    void pushPoint_XY_F32_RGB_U8(std::vector<unsigned char>& fullData, const Position& pointPosition, const Color& pointColor);
+	/// Add a point to the current path, in the selected data format.
+	void pushPoint(const Position& pointPosition, const Color& pointColor);
+	/// Path MTU to destAddr (0 if unknown), cached to avoid querying the OS on each frame.
+	int getPathMtu(const GenericAddr& destAddr);
+	/// Read pending packets on the sending socket: answer receivers clock sync requests and NACKs, and read their feedback.
+	void readBackChannel(unsigned int senderIdentifier);
 	std::map<std::string, float*> getMetadata(const OP_SOPInput* sinput);
 
 	Matrix44<double> buildCameraTransProjMatrix(const OP_Inputs* inputs);
@@ -77,10 +84,28 @@ private:
 	DatagramSocket* socket;
 
 	std::vector<unsigned char> fullData;
-	std::vector<unsigned char> packet;
-
-	/// PONK frame counter; wraps at 256 (protocol uses 8-bit field).
-	unsigned char frameNumber = 0;
+	Ponk::FrameChunker m_chunker;
+	Ponk::PathCacheEncoder m_pathCache;
+	std::vector<unsigned char> m_encodedData;
+	Ponk::MetaDataTableEncoder m_metaDataTable;
+	std::vector<unsigned char> m_tableData;
+	Ponk::SenderAnnouncer m_announcer;
+	std::vector<unsigned char> m_clockSyncResponse;
+	Ponk::SendRateController m_rateController;
+	Ponk::RetransmitBuffer m_retransmitBuffer;
+	std::vector<const std::vector<unsigned char>*> m_retransmitPackets;
+
+	/// Data format used for all pathes of the frame (PONK_DATA_FORMAT_XY_F32_RGB_U8, PONK_DATA_FORMAT_XY_DELTA_RGB_RLE
+	/// or PONK_DATA_FORMAT_XY_F16_RGB_U8).
+	unsigned char m_dataFormat = PONK_DATA_FORMAT_XY_F32_RGB_U8;
+	Ponk::PathWriter m_pathWriter;
+
+	/// PONK frame counter; only 8 bits are sent unless the frame needs protocol version 2.
+	unsigned int frameNumber = 0;
+
+	int m_pathMtu = 0;
+	unsigned int m_pathMtuIp = 0;
+	std::chrono::steady_clock::time_point m_pathMtuTime;
 
 	/// Current error message; when non-empty, the node is in error state.
 	std::string m_errorMessage;